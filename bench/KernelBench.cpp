@@ -0,0 +1,317 @@
+// Microbenchmarks for the per-frame particle and analysis kernels.
+//
+//   KernelBench [--filter=NAME] [--min-ms=N] [--max-particles=N] [--max-samples=N]
+//               [--output=FILE] [--baseline=FILE] [--threshold=PERCENT]
+//
+// Each kernel is run over a sweep of sizes until at least --min-ms (default 200)
+// has elapsed, and the fastest run is reported in nanoseconds per item. Results
+// can be saved with --output and compared against a saved file with --baseline;
+// anything slower than the baseline by more than --threshold percent (default 5)
+// is flagged and makes the exit code non-zero.
+
+#include "cinder/Rand.h"
+#include "cinder/Timer.h"
+
+#include "AudioAnalyzer.h"
+#include "Emission.h"
+#include "Options.h"
+#include "Palette.h"
+#include "ParticleController.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Result
+	{
+		std::string kernel;
+		size_t size;
+		double nsPerItem;
+	};
+
+	// Fills 'particles' with 'count' particles that stay alive and on screen for a long time.
+	void populate(ParticleController& particles, size_t count)
+	{
+		particles.particles.clear();
+		particles.screenWidth = 1 << 30;
+		particles.screenHeight = 1 << 30;
+		particles.maxAge = 0xffffffff;
+		particles.entropy = 0.5f;
+
+		ci::randSeed(1);
+
+		for(size_t i = 0; i < count; i++)
+		{
+			std::array<float, 3> rgb = {ci::randFloat(), ci::randFloat(), ci::randFloat()};
+			particles.addParticle(ci::randFloat(0.0f, 1920.0f), ci::randFloat(0.0f, 1080.0f), ci::randFloat(-3.0f, 3.0f), rgb);
+		}
+
+		std::for_each(std::begin(particles.particles), std::end(particles.particles),
+			[](Particle& p)
+			{
+				p.position.set(p.position.x + (1 << 20), p.position.y + (1 << 20), 0);
+			});
+	}
+
+	// Runs 'setup' then times 'kernel' repeatedly until 'minSeconds' of kernel time has passed.
+	// Returns the fastest single run in seconds.
+	double measure(double minSeconds, const std::function<void()>& setup, const std::function<void()>& kernel)
+	{
+		ci::Timer timer(true);
+		auto best = 1e30;
+		auto total = 0.0;
+		auto runs = 0;
+
+		while(total < minSeconds || runs < 3)
+		{
+			setup();
+
+			auto start = timer.getSeconds();
+			kernel();
+			auto elapsed = timer.getSeconds() - start;
+
+			best = std::min(best, elapsed);
+			total += elapsed;
+			runs++;
+		}
+
+		return best;
+	}
+
+	std::vector<Result> loadResults(const std::string& fileName)
+	{
+		std::vector<Result> results;
+		std::ifstream is(fileName.c_str());
+		std::string line;
+
+		while(std::getline(is, line))
+		{
+			std::replace(std::begin(line), std::end(line), ',', ' ');
+			std::istringstream fields(line);
+			Result result;
+
+			if(fields >> result.kernel >> result.size >> result.nsPerItem)
+			{
+				results.push_back(result);
+			}
+		}
+
+		return results;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	options.parse(std::vector<std::string>(argv, argv + argc));
+
+	auto filter = options.getString("filter", "");
+	auto minSeconds = std::max(options.getInt("min-ms", 200), 1) / 1000.0;
+	auto maxParticles = static_cast<size_t>(std::max(options.getInt("max-particles", 10000000), 1));
+	auto maxSamples = static_cast<size_t>(std::max(options.getInt("max-samples", 65536), 1));
+	auto threshold = options.getFloat("threshold", 5.0f);
+
+	std::vector<size_t> particleCounts;
+	std::vector<size_t> sampleSizes;
+
+	for(size_t count = 10000; count <= maxParticles; count *= 10)
+	{
+		particleCounts.push_back(count);
+	}
+
+	for(size_t size = 256; size <= maxSamples; size *= 4)
+	{
+		sampleSizes.push_back(size);
+	}
+
+	std::vector<Result> results;
+
+	auto report = [&results](const std::string& kernel, size_t size, double seconds)
+	{
+		Result result;
+		result.kernel = kernel;
+		result.size = size;
+		result.nsPerItem = seconds * 1e9 / static_cast<double>(size);
+		results.push_back(result);
+
+		printf("%-24s %10u %12.3f ns/item %12.3f ms\n", kernel.c_str(), static_cast<unsigned int>(size), result.nsPerItem, seconds * 1000.0);
+		fflush(stdout);
+	};
+
+	auto enabled = [&filter](const std::string& kernel)
+	{
+		return filter.empty() == true || kernel.find(filter) != std::string::npos;
+	};
+
+	ParticleController particles;
+	std::vector<ParticleVertex> small;
+	std::vector<ParticleVertex> medium;
+
+	std::for_each(std::begin(particleCounts), std::end(particleCounts),
+		[&](size_t count)
+		{
+			if(enabled("addParticle") == true)
+			{
+				report("addParticle", count, measure(minSeconds,
+					[&particles]()
+					{
+						particles.particles.clear();
+						ci::randSeed(1);
+					},
+					[&particles, count]()
+					{
+						std::array<float, 3> rgb = {0.5f, 0.5f, 0.5f};
+
+						for(size_t i = 0; i < count; i++)
+						{
+							particles.addParticle(static_cast<float>(i % 1920), 540.0f, static_cast<float>(i % 7) - 3.0f, rgb);
+						}
+					}));
+			}
+
+			if(enabled("update") == true || enabled("isDead") == true || enabled("buildVertices") == true)
+			{
+				populate(particles, count);
+			}
+
+			if(enabled("update") == true)
+			{
+				// update() ages, moves and culls the field, so every run starts from a fresh one.
+				report("update", count, measure(minSeconds, [&particles, count]() { populate(particles, count); }, [&particles]() { particles.update(); }));
+			}
+
+			if(enabled("isDead") == true)
+			{
+				volatile size_t dead = 0;
+
+				report("isDead", count, measure(minSeconds, [](){},
+					[&particles, &dead]()
+					{
+						dead = std::count_if(std::begin(particles.particles), std::end(particles.particles),
+							[](const Particle& p)
+							{
+								return ParticleController::isDead(p, 1920, 1080, 32);
+							});
+					}));
+			}
+
+			if(enabled("buildVertices") == true)
+			{
+				small.resize(count);
+				medium.resize(count);
+				size_t smallCount = 0;
+				size_t mediumCount = 0;
+				report("buildVertices", count, measure(minSeconds, [](){}, [&]() { particles.buildVertices(small.data(), smallCount, medium.data(), mediumCount); }));
+			}
+
+			// Give the memory back before the next, larger count.
+			particles.particles.clear();
+			std::vector<ParticleVertex>().swap(small);
+			std::vector<ParticleVertex>().swap(medium);
+		});
+
+	std::for_each(std::begin(sampleSizes), std::end(sampleSizes),
+		[&](size_t size)
+		{
+			std::vector<float> values(size);
+			std::vector<float> left(size);
+			std::vector<float> right(size);
+			std::vector<float> out(size);
+			std::vector<std::array<float, 3>> colors(size);
+
+			ci::randSeed(1);
+
+			for(size_t i = 0; i < size; i++)
+			{
+				values[i] = ci::randFloat(-3.0f, 3.0f);
+				left[i] = ci::randFloat(0.0f, 1.0f);
+				right[i] = ci::randFloat(0.0f, 1.0f);
+			}
+
+			if(enabled("getValueColor") == true)
+			{
+				report("getValueColor", size, measure(minSeconds, [](){},
+					[&values, &colors, size]()
+					{
+						for(size_t i = 0; i < size; i++)
+						{
+							colors[i] = Palette::getValueColor(values[i], true, false, 5.0f);
+						}
+					}));
+			}
+
+			if(enabled("mapRow") == true)
+			{
+				Palette palette;
+				palette.generate(true, false, 5.0f, 1.0f);
+				report("mapRow", size, measure(minSeconds, [](){}, [&]() { palette.mapRow(values.data(), size, colors.data()); }));
+			}
+
+			if(enabled("mirrorSpectrumDB") == true)
+			{
+				report("mirrorSpectrumDB", size, measure(minSeconds, [](){}, [&]() { AudioAnalyzer::mirrorSpectrumDB(left.data(), right.data(), size, out.data()); }));
+			}
+
+			if(enabled("decimate") == true)
+			{
+				// Into the columns of a 1920 pixel wide window.
+				std::vector<EmissionPoint> points(size);
+				report("decimate", size, measure(minSeconds, [](){}, [&]() { Emission::decimate(values, 5.0f, 1920.0f, 1920, 0.1f, points.data()); }));
+			}
+		});
+
+	if(options.has("output") == true)
+	{
+		std::ofstream os(options.getString("output", "kernels.csv").c_str());
+		os << "kernel,size,ns_per_item\n";
+
+		std::for_each(std::begin(results), std::end(results),
+			[&os](const Result& result)
+			{
+				os << result.kernel << "," << result.size << "," << result.nsPerItem << "\n";
+			});
+	}
+
+	auto regressions = 0;
+
+	if(options.has("baseline") == true)
+	{
+		std::map<std::pair<std::string, size_t>, double> baseline;
+		auto stored = loadResults(options.getString("baseline", ""));
+
+		std::for_each(std::begin(stored), std::end(stored),
+			[&baseline](const Result& result)
+			{
+				baseline[std::make_pair(result.kernel, result.size)] = result.nsPerItem;
+			});
+
+		printf("\n%-24s %10s %12s %12s %9s\n", "kernel", "size", "baseline", "current", "change");
+
+		std::for_each(std::begin(results), std::end(results),
+			[&](const Result& result)
+			{
+				auto entry = baseline.find(std::make_pair(result.kernel, result.size));
+
+				if(entry == baseline.end() || entry->second <= 0)
+				{
+					return;
+				}
+
+				auto change = 100.0 * (result.nsPerItem - entry->second) / entry->second;
+				auto regressed = change > threshold;
+				regressions += regressed == true ? 1 : 0;
+
+				printf("%-24s %10u %12.3f %12.3f %+8.1f%%%s\n", result.kernel.c_str(), static_cast<unsigned int>(result.size), 
+					entry->second, result.nsPerItem, change, regressed == true ? "  REGRESSION" : "");
+			});
+	}
+
+	return regressions > 0 ? 1 : 0;
+}
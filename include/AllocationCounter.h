@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// Debug builds (or EPOCH_COUNT_ALLOCATIONS) replace the global operator new
+// to count heap allocations made on one watched thread, so the per-frame
+// path can be checked for steady-state allocations. Release builds count
+// nothing and isAvailable() is false.
+namespace AllocationCounter
+{
+	bool isAvailable();
+
+	// Count allocations made on the calling thread from now on.
+	void watchThisThread();
+
+	// Allocations counted since the last reset().
+	uint64_t getCount();
+	void reset();
+
+	// For work that is allowed to allocate, such as the debug overlays.
+	void suspend();
+	void resume();
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "cinder/Timer.h"
+
+#include "FMOD.hpp"
+#include "AudioCapture.h"
+#include "Palette.h"
+#include "Stft.h"
+#include "TrackAnalysis.h"
+#include "TripleBuffer.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// What the UI wants analyzed. Copied by the analysis thread once per pass.
+struct AnalysisSettings
+{
+	AnalysisSettings();
+
+	int waveSampleSize;
+	int sampleSize;
+	bool analyzeWave;
+	bool analyzeSpectrum;
+	bool timeDomain;
+	bool useGreyscale;
+	bool useAvSync;
+	float velocityScale;
+
+	// Seconds from now until a frame picked up now is on screen.
+	double presentationLead;
+};
+
+// One finished analysis pass, ready to emit particles from.
+struct AnalysisFrame
+{
+	AnalysisFrame();
+
+	uint64_t sequence;
+	uint64_t clock;
+
+	// What the frame was analyzed with.
+	AnalysisSettings settings;
+
+	std::vector<float> wave;
+	std::vector<float> spectrum;
+	std::vector<std::array<float, 3>> waveColors;
+	std::vector<std::array<float, 3>> spectrumColors;
+	std::array<float, 3> waveMaxColor;
+	std::array<float, 3> spectrumMaxColor;
+
+	float waveMax;
+	float spectrumMax;
+
+	double analysisSeconds;
+
+	// Parts of analysisSeconds: reading samples, FFT and dB conversion, palette mapping.
+	double fetchSeconds;
+	double spectrumSeconds;
+	double colorSeconds;
+
+	bool precomputed;
+};
+
+// Runs audio fetch, FFT, dB conversion and color mapping on its own thread at
+// a fixed cadence and publishes finished frames through a triple buffer, so
+// FMOD lock contention or large sample sizes never stall the render loop.
+class AudioAnalyzer
+{
+	public:
+		AudioAnalyzer();
+		~AudioAnalyzer();
+
+		void start(double rate);
+		void stop();
+
+		// The thread keeps its cadence but skips analysis, so resuming is immediate.
+		void setPaused(bool paused);
+
+		// Runs one analysis pass on the calling thread, for when the thread isn't
+		// started (headless benchmarks step the pipeline themselves).
+		void step();
+
+		// Called on the UI thread whenever the FMOD system is (re)created.
+		void attach(FMOD::System* system);
+		void detach();
+
+		// Window and hop are in samples; overlap is 1 - hop / window.
+		void configureStft(size_t windowSize, size_t hop, bool interpolate);
+
+		// Replaces the built in color palettes. Returns false if the file can't be read.
+		bool loadPalette(const std::string& fileName);
+
+		// Precomputed columns for the playing track, read at the channel's position.
+		void setTrackAnalysis(std::shared_ptr<const TrackAnalysis> analysis, FMOD::Channel* channel);
+
+		void configure(const AnalysisSettings& settings);
+
+		// Maps a frame's wave and spectrum to colors with the palette its settings
+		// select, exactly as analysis does. Only while the thread isn't started.
+		void colorize(AnalysisFrame& frame);
+
+		// UI thread. Picks up the newest published frame without waiting.
+		bool update();
+		const AnalysisFrame& getFrame() const;
+
+		const AudioCapture& getCapture() const;
+		double getRate() const;
+
+		// Converts left and right magnitude spectra of 'count' bins to dB, alternating
+		// sign per bin, and lays them out mirrored about the middle of 'out'.
+		static void mirrorSpectrumDB(const float* left, const float* right, size_t count, float* out);
+
+		size_t getStftWindowSize() const;
+		size_t getStftHop() const;
+		uint64_t getStftColumns() const;
+
+	protected:
+		void run();
+		void process();
+		void analyze(const AnalysisSettings& settings, AnalysisFrame& frame);
+		const Palette& selectPalette(const AnalysisSettings& settings);
+
+		void getChannelWaveData(const AnalysisSettings& settings, float* out, size_t count, int channel);
+		void getChannelSpectrum(const AnalysisSettings& settings, float* out, size_t count, int channel);
+		void getStereoWaveData(const AnalysisSettings& settings, std::vector<float>& waveData);
+		void getSpectrumDataMirrorDB(const AnalysisSettings& settings, std::vector<float>& waveData);
+
+	private:
+		FMOD::System* system;
+		AudioCapture capture;
+		Stft stft;
+		bool stftInterpolate;
+
+		Palette timePalette;
+		Palette spectrumPalette;
+		Palette greyscalePalette;
+		bool greyscaleTimeDomain;
+		Palette userPalette;
+		bool hasUserPalette;
+
+		std::shared_ptr<const TrackAnalysis> trackAnalysis;
+		FMOD::Channel* trackChannel;
+		uint64_t trackPosition;
+		bool usePrecomputed;
+
+		std::thread thread;
+		std::atomic<bool> running;
+		std::atomic<bool> paused;
+		std::mutex settingsMutex;
+		std::mutex sourceMutex;
+
+		AnalysisSettings settings;
+		TripleBuffer<AnalysisFrame> frames;
+
+		ci::Timer timer;
+		double rate;
+		uint64_t sequence;
+		uint64_t latchClock;
+		std::atomic<uint64_t> stftColumns;
+
+		std::vector<float> waveDataLeft;
+		std::vector<float> waveDataRight;
+};
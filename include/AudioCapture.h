@@ -0,0 +1,76 @@
+#pragma once
+
+#include "cinder/Timer.h"
+
+#include "FMOD.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Taps the final FMOD mix with a custom DSP unit and keeps the most recent
+// audio in a ring buffer addressed by DSP clock (output samples since the
+// mixer started). Every mixed block is timestamped so a frame can ask for
+// the window that will be audible when it reaches the screen, rather than
+// whatever the mixer happens to hold when update() runs.
+class AudioCapture
+{
+	public:
+		AudioCapture();
+		~AudioCapture();
+
+		bool attach(FMOD::System* system);
+		void detach();
+		bool isAttached() const;
+
+		// Seconds on the capture clock, shared with the mixer timestamps.
+		double getSeconds() const;
+
+		int getSampleRate() const;
+
+		// Output latency of the mixer: DSP buffer length times buffer count.
+		unsigned int getLatencySamples() const;
+
+		// DSP clock one past the newest captured sample.
+		uint64_t getWriteClock() const;
+
+		// DSP clock of the sample leaving the speakers at 'seconds'.
+		uint64_t getAudibleClockAt(double seconds) const;
+
+		// Time at which the sample at 'clock' leaves the speakers.
+		double getAudibleTime(uint64_t clock) const;
+
+		// Copies the 'count' samples of 'channel' ending at 'endClock', clamped
+		// to what has been captured. Returns the end clock actually used.
+		uint64_t getWindow(uint64_t endClock, size_t count, int channel, float* out) const;
+
+	private:
+		static FMOD_RESULT F_CALLBACK readCallback(FMOD_DSP_STATE* state, float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int outchannels);
+
+		void write(const float* in, unsigned int length, int channels);
+
+		struct BlockStamp
+		{
+			uint64_t clock;
+			double seconds;
+		};
+
+		static const size_t CapacityFrames = 1 << 17;
+		static const size_t StampCount = 64;
+
+		FMOD::System* system;
+		FMOD::DSP* dsp;
+
+		ci::Timer timer;
+
+		std::vector<float> ring;
+		BlockStamp stamps[StampCount];
+
+		std::atomic<uint64_t> writeClock;
+		std::atomic<uint32_t> stampIndex;
+
+		uint64_t firstClock;
+		int sampleRate;
+		unsigned int latencySamples;
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "cinder/Timer.h"
+
+#include "FMOD.hpp"
+#include "MappedFileSystem.h"
+#include "SeekTableCache.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Owns the one FMOD system for the life of the app. The next track is opened
+// in the background (FMOD_NONBLOCKING) while the current one plays and is
+// scheduled to start on the exact DSP clock the current one ends, so track
+// changes are gapless and never block the UI thread. Sounds that are done
+// with are released once FMOD has finished opening them.
+class AudioEngine
+{
+	public:
+		enum LoadMode
+		{
+			// Decode the whole file to PCM up front. Most memory, slowest open.
+			LoadMode_Sample,
+			// Decode from disk while playing through a small buffer.
+			LoadMode_Stream,
+			// Keep the compressed file in memory and decode in the mixer.
+			LoadMode_CompressedSample,
+			LoadMode_End
+		};
+
+		AudioEngine();
+		~AudioEngine();
+
+		// A zero buffer length or count keeps FMOD's default mixer buffering.
+		bool init(unsigned int dspBufferLength, int dspBufferCount);
+		void shutdown();
+
+		// Applies to tracks opened after the call.
+		void setLoadMode(LoadMode mode);
+		LoadMode getLoadMode() const;
+		static const char* getLoadModeName(LoadMode mode);
+
+		// FMOD output plugin. FMOD_OUTPUTTYPE_NOSOUND_NRT mixes one block per
+		// update() with no device, as fast as it is called. Call before init().
+		void setOutput(FMOD_OUTPUTTYPE output);
+
+		// Size of each stream's file buffer in bytes. Call before init().
+		void setStreamBufferSize(unsigned int bytes);
+
+		// Serve FMOD's file reads from memory-mapped files. Call before init().
+		void setMappedFileIo(bool enabled, uint32_t readahead);
+
+		// Take MP3 lengths from prebuilt seek tables instead of having FMOD scan
+		// every file on open. Null turns it off. The cache must outlive the engine.
+		void setSeekTableCache(SeekTableCache* cache);
+
+		// Stop whatever is playing and start 'fileName' as soon as it has opened.
+		// Reuses the prefetched sound if it is the same file.
+		void play(const std::string& fileName, bool loop);
+
+		// Open 'fileName' in the background to follow the current track. Calling
+		// again with the same file does nothing; a different file replaces it.
+		void prefetch(const std::string& fileName);
+
+		// Pumps FMOD and advances tracks. Returns true when the current track changed.
+		bool update();
+
+		// Pauses the channel group. The DSP clock keeps running while paused, so the
+		// join scheduled for the next track is cancelled and re-armed from the
+		// current track's position on resume.
+		void setPaused(bool paused);
+		bool isPaused() const;
+
+		// True when nothing is playing or opening.
+		bool isIdle() const;
+
+		FMOD::System* getSystem() const;
+		FMOD::ChannelGroup* getChannelGroup() const;
+		FMOD::Channel* getChannel() const;
+		const std::string& getFileName() const;
+		const std::string& getPrefetchFileName() const;
+
+		// Seconds from asking for the current track until it became audible.
+		// Zero when it was joined gaplessly from the prefetch.
+		double getFirstAudioSeconds() const;
+
+		// Seconds FMOD took to open the current track.
+		double getOpenSeconds() const;
+
+		// Memory FMOD holds for the current track's sound, in bytes.
+		unsigned int getTrackMemory() const;
+
+		// Updates on which the current stream reported starving or the disk busy.
+		uint64_t getStarvingCount() const;
+		uint64_t getDiskBusyCount() const;
+
+		const MappedFileSystem& getFileSystem() const;
+		bool isMappedFileIo() const;
+
+	protected:
+		struct Track
+		{
+			Track();
+
+			std::string fileName;
+			FMOD::Sound* sound;
+			FMOD::Channel* channel;
+			uint64_t startClock;
+			bool loop;
+			std::shared_ptr<const SeekTable> seekTable;
+
+			double requestTime;
+			double openSeconds;
+			double firstAudioSeconds;
+			unsigned int memoryBytes;
+		};
+
+		bool open(Track& track, const std::string& fileName, bool loop, bool exactLength);
+		void findSeekTable(Track& track);
+		bool start(Track& track, uint64_t clock);
+		void unschedule(Track& track);
+		void rebase(Track& track);
+		void measure(Track& track);
+		void retire(Track& track);
+		void releaseRetired(bool wait);
+
+		uint64_t getClock() const;
+		uint64_t getEndClock(const Track& track) const;
+
+		// Length in the sound's own samples, and its sample rate.
+		void getLength(const Track& track, uint64_t& length, float& frequency) const;
+		uint64_t toOutputSamples(const Track& track, uint64_t samples) const;
+
+		static FMOD_RESULT F_CALLBACK channelCallback(FMOD_CHANNEL* channel, FMOD_CHANNEL_CALLBACKTYPE type, void* commandData1, void* commandData2);
+
+	private:
+		FMOD::System* system;
+		FMOD::ChannelGroup* channelGroup;
+
+		Track current;
+		Track next;
+
+		// Sounds still opening can't be released without stalling, so they wait here.
+		std::vector<FMOD::Sound*> retired;
+
+		MappedFileSystem fileSystem;
+		bool useMappedFileIo;
+		uint32_t readahead;
+		SeekTableCache* seekTableCache;
+		uint64_t starvingCount;
+		uint64_t diskBusyCount;
+
+		ci::Timer timer;
+		FMOD_OUTPUTTYPE output;
+		LoadMode loadMode;
+		unsigned int streamBufferSize;
+		unsigned int blockLength;
+		int outputRate;
+
+		// Set by the END callback, which FMOD runs from System::update on this thread.
+		bool currentEnded;
+		bool paused;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "cinder/Timer.h"
+
+#include "FrameProfiler.h"
+#include "Statistics.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a headless benchmark run was configured with, echoed into its report.
+struct BenchmarkSettings
+{
+	BenchmarkSettings();
+
+	// A file name, or the name of a SignalGenerator type.
+	std::string source;
+	std::string domain;
+	std::string render;
+	int frames;
+	int warmupFrames;
+	int waveSampleSize;
+	int sampleSize;
+	uint32_t maxAge;
+	float entropy;
+};
+
+// Times an uncapped run of the full frame pipeline and reports frame time
+// percentiles, particle throughput and peak memory as JSON.
+class Benchmark
+{
+	public:
+		Benchmark();
+
+		void start(const BenchmarkSettings& settings);
+		bool isRunning() const;
+
+		// True once the configured number of frames has been measured.
+		bool isComplete() const;
+
+		void beginFrame();
+		void endFrame(size_t particleCount, size_t emitted);
+
+		const BenchmarkSettings& getSettings() const;
+
+		// Per-phase timings are taken from the profiler's most recent frames.
+		std::string toJson(const FrameProfiler& profiler) const;
+		bool writeJson(const std::string& fileName, const FrameProfiler& profiler) const;
+
+		// Largest resident set of the process so far, in bytes.
+		static uint64_t getPeakMemory();
+
+	private:
+		BenchmarkSettings settings;
+		ci::Timer timer;
+		bool running;
+		int frame;
+		double frameStart;
+		double measureStart;
+		double measureSeconds;
+
+		std::vector<double> frameTimes;
+		uint64_t particleFrames;
+		uint64_t emitted;
+		size_t peakParticles;
+};
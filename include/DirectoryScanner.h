@@ -0,0 +1,64 @@
+#pragma once
+
+#include "cinder/Timer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Walks directory trees on a pool of worker threads. Each directory is a
+// separate job, so sibling folders are listed in parallel. Playable files
+// are handed back in batches (sorted within each directory) for the UI
+// thread to append as they arrive.
+class DirectoryScanner
+{
+	public:
+		DirectoryScanner();
+		~DirectoryScanner();
+
+		void start(size_t threadCount);
+		void stop();
+
+		// Extensions are matched case-insensitively and include the dot, e.g. ".mp3".
+		void addExtension(const std::string& extension);
+
+		// Walk 'directories' too. Joins a scan already in progress.
+		void scan(const std::vector<std::string>& directories);
+		void cancel();
+
+		// Moves files found since the last call onto the end of 'fileNames'.
+		bool poll(std::vector<std::string>& fileNames);
+
+		bool isScanning() const;
+		size_t getFileCount() const;
+		size_t getDirectoryCount() const;
+		double getSeconds() const;
+		double getFilesPerSecond() const;
+
+	protected:
+		void run();
+		void list(const std::string& directory, std::vector<std::string>& files, std::vector<std::string>& directories) const;
+
+	private:
+		std::vector<std::thread> threads;
+		mutable std::mutex mutex;
+		std::condition_variable condition;
+		std::deque<std::string> queue;
+		std::vector<std::string> found;
+		std::set<std::string> extensions;
+
+		// Bumped by cancel() so results from the previous scan are dropped.
+		unsigned int generation;
+		size_t active;
+		size_t fileCount;
+		size_t directoryCount;
+
+		ci::Timer timer;
+		double elapsed;
+		std::atomic<bool> running;
+};
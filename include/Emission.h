@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A sample chosen to emit a particle: where it goes across the view, its
+// scaled value and its index in the source, for looking up its color.
+struct EmissionPoint
+{
+	float x;
+	float value;
+	uint32_t index;
+};
+
+namespace Emission
+{
+	// Spreads 'values' across 'width' pixels and keeps what can be seen in
+	// 'columns' output columns: a column holding one sample passes it through,
+	// one holding several keeps its minimum and maximum when they straddle
+	// zero and its peak otherwise. Points whose scaled value is under 'threshold'
+	// in magnitude are dropped. Points keep the position of the sample they
+	// came from, so with as many columns as samples nothing changes.
+	// 'points' must have room for values.size(); returns how many were written.
+	size_t decimate(const std::vector<float>& values, float scale, float width, size_t columns, float threshold, EmissionPoint* points);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+// Radix-2 FFT with a Hann window. Produces the same shape of data as
+// FMOD::System::getSpectrum: size/2 linear magnitudes, where a full scale
+// sine wave peaks at 1.0.
+class Fft
+{
+	public:
+		Fft();
+		explicit Fft(size_t size);
+
+		void resize(size_t size);
+		size_t size() const;
+
+		// Reads size() samples from 'in' and writes size()/2 magnitudes to 'out'.
+		void magnitudes(const float* in, float* out);
+
+	private:
+		size_t fftSize;
+		float windowGain;
+		std::vector<float> window;
+		std::vector<size_t> bitReverse;
+		std::vector<std::complex<float>> twiddle;
+		std::vector<std::complex<float>> scratch;
+};
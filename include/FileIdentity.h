@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace FileIdentity
+{
+	// Hash of a file's path, size and modification time; changes whenever the file is
+	// replaced or edited, without reading its contents. Zero if the file can't be found.
+	uint64_t getKey(const std::string& fileName);
+
+	// Hash of the path alone, without touching the disk.
+	uint64_t getPathHash(const std::string& fileName);
+}
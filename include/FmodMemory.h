@@ -0,0 +1,51 @@
+#pragma once
+
+#include "FMOD.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// What FMOD holds, split the way the overlay shows it.
+struct FmodMemoryBreakdown
+{
+	FmodMemoryBreakdown();
+
+	unsigned int total;
+	unsigned int streams;
+	unsigned int sounds;
+	unsigned int dsp;
+	unsigned int channels;
+	unsigned int system;
+};
+
+// Routes every FMOD allocation either into one fixed pool, which bounds
+// FMOD's memory outright, or through counting heap callbacks. Must be set
+// up before the first FMOD::System_Create.
+namespace FmodMemory
+{
+	enum Category
+	{
+		Category_Normal,
+		Category_StreamFile,
+		Category_StreamDecode,
+		Category_SampleData,
+		Category_DspBuffer,
+		Category_End
+	};
+
+	// A poolBytes of zero uses the tracked heap callbacks instead of a pool.
+	bool initialize(size_t poolBytes);
+
+	bool isPooled();
+	size_t getPoolBytes();
+
+	// Memory_GetStats: bytes allocated now and the most ever allocated, across all FMOD systems.
+	void getStats(int& current, int& peak);
+
+	// Live bytes per allocation type. Only counted with the heap callbacks.
+	int64_t getTrackedBytes(Category category);
+	const char* getCategoryName(Category category);
+
+	// System::getMemoryInfo grouped by subsystem for one FMOD system.
+	FmodMemoryBreakdown getBreakdown(FMOD::System* system);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for scratch that only lives until the end of the frame,
+// such as emission points and vertex arrays. reset() starts the next frame
+// by rewinding, so once the arena has grown to the largest frame seen it
+// never touches the heap again. A frame that doesn't fit spills into
+// separate blocks, and the next reset() grows the arena to cover it.
+class FrameArena
+{
+	public:
+		explicit FrameArena(size_t capacity = 1024 * 1024);
+
+		// Uninitialized room for 'count' objects, valid until reset(). No
+		// destructors are run, so only for trivially destructible types.
+		template<typename T>
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(this->allocateBytes(count * sizeof(T), std::alignment_of<T>::value));
+		}
+
+		void* allocateBytes(size_t bytes, size_t alignment);
+		void reset();
+
+		size_t getCapacity() const;
+		size_t getUsedBytes() const;
+
+		// Most bytes any one frame has used, and how many times the arena grew to fit.
+		size_t getHighWater() const;
+		uint32_t getGrowCount() const;
+
+	private:
+		FrameArena(const FrameArena&);
+		FrameArena& operator=(const FrameArena&);
+
+		std::vector<uint8_t> block;
+		size_t used;
+
+		std::vector<std::vector<uint8_t>> spills;
+		size_t spilledBytes;
+
+		size_t highWater;
+		uint32_t growCount;
+};
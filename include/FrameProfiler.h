@@ -0,0 +1,121 @@
+#pragma once
+
+#include "cinder/Color.h"
+#include "cinder/Timer.h"
+
+#include "FMOD.hpp"
+#include "Statistics.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped per-phase frame timer. The UI thread fills in one frame at a time and
+// commits it to a fixed ring that other threads can read without locking; the
+// ring feeds the overlay graph and the CSV and Chrome trace exports.
+class FrameProfiler
+{
+	public:
+		enum Phase
+		{
+			Phase_AudioUpdate,
+			// Run on the analysis thread; charged to the frame that picked the result up.
+			Phase_Fetch,
+			Phase_Spectrum,
+			Phase_Color,
+			Phase_Emission,
+			Phase_ParticleUpdate,
+			Phase_Clear,
+			Phase_Particles,
+			Phase_Credits,
+			Phase_Overlay,
+			// From the end of draw() to the start of the next update(): buffer swap and vsync.
+			Phase_Swap,
+			Phase_End
+		};
+
+		// Timings for one frame, in milliseconds.
+		struct Frame
+		{
+			Frame();
+
+			uint64_t index;
+			double start;
+			float total;
+
+			// Offset of each phase from the start of the frame, and how long it ran.
+			std::array<float, Phase_End> phaseStart;
+			std::array<float, Phase_End> phaseDuration;
+
+			// FMOD's own CPU usage in percent, sampled once per frame.
+			float fmodDsp;
+			float fmodStream;
+			float fmodUpdate;
+			float fmodTotal;
+		};
+
+		static const size_t Capacity = 1024;
+
+		FrameProfiler();
+
+		// Closes the previous frame, if any, and starts a new one.
+		void beginFrame();
+
+		// Marks the end of draw(); the time until the next beginFrame() is the swap.
+		void endDraw();
+
+		void begin(Phase phase);
+		void end(Phase phase);
+
+		// For work timed elsewhere, such as the analysis thread.
+		void add(Phase phase, double seconds);
+
+		void sampleFmod(FMOD::System* system);
+
+		// The most recent committed frames, oldest first. Safe from any thread.
+		std::vector<Frame> getFrames(size_t count = Capacity) const;
+
+		// The newest committed frame, without copying the ring. False before the first one.
+		bool getLastFrame(Frame& frame) const;
+
+		// Milliseconds; Phase_End summarizes whole frames.
+		static Distribution summarize(const std::vector<Frame>& frames, Phase phase);
+
+		static const char* getPhaseName(Phase phase);
+		static ci::ColorA getPhaseColor(Phase phase);
+
+		bool writeCsv(const std::string& fileName) const;
+		bool writeChromeTrace(const std::string& fileName) const;
+
+		// Stacked frame time graph, one column per frame, newest on the right.
+		void draw(float x, float y, float width, float height, size_t frameCount) const;
+
+	private:
+		double getMilliseconds() const;
+
+		ci::Timer timer;
+		Frame current;
+		bool inFrame;
+		double drawEnd;
+		std::array<double, Phase_End> phaseBegin;
+
+		std::array<Frame, Capacity> ring;
+		std::atomic<uint64_t> written;
+};
+
+// Times the enclosing scope as one phase.
+class ProfileScope
+{
+	public:
+		ProfileScope(FrameProfiler& profiler, FrameProfiler::Phase phase);
+		~ProfileScope();
+
+	private:
+		ProfileScope(const ProfileScope&);
+		ProfileScope& operator=(const ProfileScope&);
+
+		FrameProfiler& profiler;
+		FrameProfiler::Phase phase;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "cinder/Timer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Decides when there is nothing worth drawing: playback paused, stopped or
+// muted, or the window minimized or hidden. A quiet player stops emitting
+// and lets the field decay before going idle; an occluded window goes idle
+// at once. Process CPU time is accounted separately for active and idle
+// stretches so the saving can be read off.
+class IdleMonitor
+{
+	public:
+		enum State
+		{
+			State_Active,
+			// Quiet, but particles are still on screen. No emission.
+			State_Decaying,
+			// Nothing to show; the caller drops to its idle frame rate.
+			State_Idle,
+			State_End
+		};
+
+		IdleMonitor();
+
+		void setEnabled(bool enabled);
+		bool isEnabled() const;
+
+		// Once per frame. Returns true when the state changed.
+		bool update(bool paused, bool stopped, bool muted, bool occluded, size_t particleCount);
+
+		State getState() const;
+		static const char* getStateName(State state);
+
+		bool isEmitting() const;
+		bool isOccluded() const;
+
+		// Process CPU time over wall time, in percent of one core, across all active
+		// (including decaying) or all idle time so far.
+		double getActiveCpuPercent() const;
+		double getIdleCpuPercent() const;
+
+		// One line for the stats overlay.
+		std::string describe() const;
+
+		static double getProcessCpuSeconds();
+
+		// Whether the platform window behind 'nativeWindow' is minimized.
+		static bool isMinimized(void* nativeWindow);
+
+	private:
+		void account();
+
+		bool enabled;
+		State state;
+		bool occluded;
+
+		ci::Timer timer;
+		double stretchStart;
+		double stretchCpuStart;
+		double activeSeconds;
+		double activeCpuSeconds;
+		double idleSeconds;
+		double idleCpuSeconds;
+};
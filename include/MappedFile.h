@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a file. By default the whole file is mapped;
+// with a window only that much is mapped at a time and view() moves it, so
+// streaming through long files doesn't use up a 32 bit address space.
+class MappedFile
+{
+	public:
+		// View size for reading through audio files.
+		static const uint64_t StreamWindow = 32 * 1024 * 1024;
+
+		MappedFile();
+		~MappedFile();
+
+		// 'window' of zero maps the whole file.
+		bool open(const std::string& fileName, uint64_t window = 0);
+
+		// For paths that don't survive the ANSI code page.
+		bool open(const std::wstring& fileName, uint64_t window = 0);
+		void close();
+
+		bool isOpen() const;
+
+		// The whole file, when it was opened without a window.
+		const uint8_t* data() const;
+		uint64_t size() const;
+
+		// Pointer to 'count' bytes at 'offset', moving the window there if needed.
+		// Valid until the next call. Null if the range isn't in the file or can't be mapped.
+		const uint8_t* view(uint64_t offset, uint64_t count);
+
+		// Ask for a range to be paged in ahead of use. May block while it reads.
+		void prefetch(uint64_t offset, uint64_t count);
+
+		// Hint that a range will be read soon and return at once. Only covers what
+		// is mapped now. Does nothing where the OS has no such hint (Windows before 8).
+		void advise(uint64_t offset, uint64_t count) const;
+
+	private:
+		// Maps the file just opened.
+		bool map();
+
+		// Replaces the view with one that covers 'count' bytes at 'offset'.
+		bool mapView(uint64_t offset, uint64_t count);
+		void unmapView();
+
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		const uint8_t* base;
+		uint64_t viewOffset;
+		uint64_t viewLength;
+		uint64_t window;
+		uint64_t length;
+
+#if defined(_WIN32)
+		void* file;
+		void* mapping;
+#else
+		int file;
+#endif
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "FMOD.hpp"
+#include "MappedFile.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// FMOD file callbacks that serve every read from a memory-mapped window onto
+// the file instead of FMOD's buffered stdio. Async reads are queued to a
+// worker thread, most urgent first, so a page fault never stalls FMOD's
+// stream thread; after each read the worker asks the OS to page in the
+// range that follows it, without waiting for it. FMOD Ex always reads into its own buffer, so data is copied
+// once from the page cache rather than through a second stdio buffer.
+class MappedFileSystem
+{
+	public:
+		MappedFileSystem();
+		~MappedFileSystem();
+
+		// Registers the callbacks on 'system' and starts the read worker.
+		// Only one instance can be installed at a time.
+		bool install(FMOD::System* system, uint32_t readahead);
+		void uninstall();
+
+		uint64_t getBytesRead() const;
+		uint64_t getAsyncReads() const;
+		size_t getQueueDepth() const;
+		uint32_t getOpenFiles() const;
+
+	protected:
+		struct File
+		{
+			// Async and blocking reads can both move the window.
+			std::mutex mutex;
+			MappedFile file;
+			unsigned int position;
+			uint64_t prefetched;
+		};
+
+		void run();
+		void read(File* file, unsigned int offset, void* buffer, unsigned int count, unsigned int* bytesRead);
+
+		static FMOD_RESULT F_CALLBACK openCallback(const char* name, int unicode, unsigned int* fileSize, void** handle, void** userData);
+		static FMOD_RESULT F_CALLBACK closeCallback(void* handle, void* userData);
+		static FMOD_RESULT F_CALLBACK readCallback(void* handle, void* buffer, unsigned int sizeBytes, unsigned int* bytesRead, void* userData);
+		static FMOD_RESULT F_CALLBACK seekCallback(void* handle, unsigned int position, void* userData);
+		static FMOD_RESULT F_CALLBACK asyncReadCallback(FMOD_ASYNCREADINFO* info, void* userData);
+		static FMOD_RESULT F_CALLBACK asyncCancelCallback(void* handle, void* userData);
+
+	private:
+		MappedFileSystem(const MappedFileSystem&);
+		MappedFileSystem& operator=(const MappedFileSystem&);
+
+		FMOD::System* system;
+		uint32_t readahead;
+
+		std::thread thread;
+		mutable std::mutex mutex;
+		std::condition_variable condition;
+		std::condition_variable idle;
+		std::deque<FMOD_ASYNCREADINFO*> queue;
+		void* busyHandle;
+
+		std::atomic<uint64_t> bytesRead;
+		std::atomic<uint64_t> asyncReads;
+		std::atomic<uint32_t> openFiles;
+		std::atomic<bool> running;
+};
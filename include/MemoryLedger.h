@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// What one subsystem holds, and how much it has churned through.
+struct MemoryStats
+{
+	MemoryStats();
+
+	int64_t live;
+	int64_t peak;
+
+	// Everything ever allocated, so a rate can be taken between two reads.
+	uint64_t allocated;
+	uint64_t allocations;
+};
+
+// Process-wide live byte counts per subsystem. Some are counted exactly as
+// allocations happen (the particle list's allocator, overlay textures);
+// the rest are measured containers whose size is set once in a while, with
+// any growth counted as allocation. Safe from any thread.
+namespace MemoryLedger
+{
+	enum Subsystem
+	{
+		Subsystem_Particles,
+		Subsystem_Analysis,
+		Subsystem_Textures,
+		Subsystem_Playlist,
+		Subsystem_Fmod,
+		Subsystem_End
+	};
+
+	void allocate(Subsystem subsystem, size_t bytes);
+	void release(Subsystem subsystem, size_t bytes);
+
+	// For measured subsystems: the live size now.
+	void set(Subsystem subsystem, int64_t bytes);
+
+	MemoryStats getStats(Subsystem subsystem);
+	const char* getSubsystemName(Subsystem subsystem);
+}
+
+// Heap allocator that counts into the ledger, for standard containers.
+template<typename T, MemoryLedger::Subsystem S>
+class CountingAllocator
+{
+	public:
+		typedef T value_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+
+		template<typename U>
+		struct rebind
+		{
+			typedef CountingAllocator<U, S> other;
+		};
+
+		CountingAllocator()
+		{
+		}
+
+		template<typename U>
+		CountingAllocator(const CountingAllocator<U, S>&)
+		{
+		}
+
+		pointer address(reference value) const
+		{
+			return &value;
+		}
+
+		const_pointer address(const_reference value) const
+		{
+			return &value;
+		}
+
+		pointer allocate(size_type count, const void* = nullptr)
+		{
+			auto p = static_cast<pointer>(::operator new(count * sizeof(T)));
+			MemoryLedger::allocate(S, count * sizeof(T));
+			return p;
+		}
+
+		void deallocate(pointer p, size_type count)
+		{
+			MemoryLedger::release(S, count * sizeof(T));
+			::operator delete(p);
+		}
+
+		size_type max_size() const
+		{
+			return static_cast<size_type>(-1) / sizeof(T);
+		}
+
+		template<typename U, typename V>
+		void construct(U* p, V&& value)
+		{
+			::new(static_cast<void*>(p)) U(std::forward<V>(value));
+		}
+
+		template<typename U>
+		void destroy(U* p)
+		{
+			p->~U();
+		}
+};
+
+template<typename T, typename U, MemoryLedger::Subsystem S>
+bool operator==(const CountingAllocator<T, S>&, const CountingAllocator<U, S>&)
+{
+	return true;
+}
+
+template<typename T, typename U, MemoryLedger::Subsystem S>
+bool operator!=(const CountingAllocator<T, S>&, const CountingAllocator<U, S>&)
+{
+	return false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "cinder/Timer.h"
+
+#include "MemoryLedger.h"
+
+#include <array>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Samples the memory ledger at a fixed interval and keeps a history of the
+// samples, to give each subsystem's allocation rate and the trend of its
+// live bytes. Every sample can also be appended to a CSV stats file. The
+// history is a ring sized by configure(), so sampling doesn't allocate.
+class MemoryMonitor
+{
+	public:
+		struct Sample
+		{
+			Sample();
+
+			// Seconds since the monitor was created.
+			double time;
+			std::array<MemoryStats, MemoryLedger::Subsystem_End> stats;
+		};
+
+		MemoryMonitor();
+
+		// Seconds between samples, and how many samples to keep. Clears the history.
+		void configure(double interval, size_t historyLength);
+
+		// Writes one row per subsystem per sample from now on.
+		bool openStats(const std::string& fileName);
+
+		// Call once per frame. Returns true when a sample was taken.
+		bool update();
+
+		double getSeconds() const;
+		MemoryStats getStats(MemoryLedger::Subsystem subsystem) const;
+
+		// Bytes per second allocated over the last interval.
+		double getAllocationRate(MemoryLedger::Subsystem subsystem) const;
+
+		// Growth of live bytes per hour, fitted over the samples taken at or after 'since' seconds.
+		double getSlope(MemoryLedger::Subsystem subsystem, double since = 0) const;
+
+		// Live bytes and growth per hour a subsystem should stay under; zero for no limit.
+		void setLimits(MemoryLedger::Subsystem subsystem, int64_t budget, double maxSlope);
+		int64_t getBudget(MemoryLedger::Subsystem subsystem) const;
+		double getMaxSlope(MemoryLedger::Subsystem subsystem) const;
+
+		bool isOverBudget(MemoryLedger::Subsystem subsystem) const;
+
+		// One overlay line for a subsystem, flagged when it is over either limit.
+		std::string describe(MemoryLedger::Subsystem subsystem) const;
+
+	private:
+		// 0 is the newest sample.
+		const Sample& getSample(size_t age) const;
+
+		ci::Timer timer;
+		double interval;
+
+		std::vector<Sample> history;
+		size_t head;
+		size_t count;
+		std::ofstream statsFile;
+
+		std::array<int64_t, MemoryLedger::Subsystem_End> budgets;
+		std::array<double, MemoryLedger::Subsystem_End> maxSlopes;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Playlist.h"
+#include "TrackMetadataLoader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#pragma pack(push, 1)
+// On-disk layout of one cached track: this header, the artist, album and
+// title bytes (not terminated), then artHeight rows of artWidth RGB pixels.
+struct MetadataHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t year;
+	uint32_t durationMs;
+	uint32_t artistLength;
+	uint32_t albumLength;
+	uint32_t titleLength;
+	uint32_t artWidth;
+	uint32_t artHeight;
+};
+#pragma pack(pop)
+
+// Indexes playlist tracks in the background, several files at a time, and
+// keeps their tags, duration and a downscaled album art thumbnail in small
+// files that are memory-mapped back in. Entries are keyed by path, size and
+// modification time, so an edited file is simply indexed again. A whole
+// playlist is handed over as one compact copy and decoded a window at a
+// time by the workers, so queueing it costs the UI thread no per-track work.
+class MetadataCache
+{
+	public:
+		static const uint32_t Version = 1;
+
+		MetadataCache();
+		~MetadataCache();
+
+		void start(const std::string& directory, size_t threadCount, int artSize);
+		void stop();
+
+		// Queue tracks that haven't been indexed this session. Returns immediately.
+		void index(const std::vector<std::string>& fileNames);
+		void index(const Playlist& playList);
+
+		// Cached metadata for the file as it is now on disk. False if there is none yet.
+		bool get(const std::string& fileName, TrackMetadata& metadata) const;
+
+		size_t getIndexedCount() const;
+		size_t getPendingCount() const;
+
+	protected:
+		void run();
+		void enqueue(const std::string& fileName);
+
+		// Moves the next window of the playlist into the queue. Call with the mutex held.
+		void fill();
+		bool write(const std::string& cacheFileName, uint64_t key, const TrackMetadata& metadata) const;
+
+		std::string getCacheFileName(uint64_t key) const;
+
+	private:
+		std::vector<std::thread> threads;
+		mutable std::mutex mutex;
+		std::condition_variable condition;
+		std::deque<std::string> queue;
+
+		// Hashes of the paths queued this session.
+		std::unordered_set<uint64_t> known;
+		size_t indexedCount;
+
+		Playlist source;
+		size_t sourceIndex;
+
+		std::string directory;
+		int artSize;
+		std::atomic<bool> running;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "FrameProfiler.h"
+#include "MemoryLedger.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Fixed-bucket histogram in seconds, kept the way Prometheus reports one.
+struct MetricsHistogram
+{
+	static const size_t BucketCount = 12;
+
+	// 'bounds' holds BucketCount ascending upper bounds; anything larger only counts towards +Inf.
+	explicit MetricsHistogram(const double* bounds);
+
+	void observe(double seconds);
+
+	std::array<double, BucketCount> bounds;
+	std::array<uint64_t, BucketCount> buckets;
+	uint64_t count;
+	double sum;
+};
+
+// Everything the endpoint publishes. The UI thread keeps one up to date and
+// hands a copy over once per frame; memory is read by the server itself.
+struct MetricsSnapshot
+{
+	MetricsSnapshot();
+
+	uint64_t frames;
+	MetricsHistogram frameSeconds;
+	std::array<double, FrameProfiler::Phase_End> phaseSeconds;
+	std::array<float, 4> fmodCpu;
+
+	uint64_t particles;
+	uint64_t emittedParticles;
+	uint64_t culledParticles;
+
+	uint64_t starvingUpdates;
+	uint64_t diskBusyUpdates;
+	MetricsHistogram firstAudioSeconds;
+	double openSeconds;
+
+	size_t qualityLevel;
+	int idleState;
+
+	std::array<MemoryStats, MemoryLedger::Subsystem_End> memory;
+	int fmodMemory;
+	int fmodMemoryPeak;
+	uint64_t processPeakMemory;
+};
+
+// Serves the latest snapshot in the Prometheus text format from its own
+// thread, so a wall of instances can be scraped without touching them.
+// Formatting and socket work never run on the UI thread, and publishing
+// never waits: if a scrape is copying the snapshot, that frame is skipped.
+class MetricsServer
+{
+	public:
+		MetricsServer();
+		~MetricsServer();
+
+		// "PORT", "HOST:PORT" or, except on Windows, "unix:PATH". False if it can't listen.
+		bool start(const std::string& address);
+		void stop();
+		bool isRunning() const;
+
+		// Call once per frame from the UI thread.
+		void publish(const MetricsSnapshot& snapshot);
+
+		uint64_t getScrapeCount() const;
+
+		static std::string format(const MetricsSnapshot& snapshot);
+
+	protected:
+		void run();
+		void serve(intptr_t connection);
+
+	private:
+		MetricsServer(const MetricsServer&);
+		MetricsServer& operator=(const MetricsServer&);
+
+		std::thread thread;
+		std::mutex mutex;
+		MetricsSnapshot snapshot;
+
+		// A platform socket handle; negative when closed.
+		intptr_t listener;
+		std::string unixPath;
+
+		std::atomic<uint64_t> scrapes;
+		std::atomic<bool> running;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Command line options of the form "--name=value" or "--name".
+// Anything that does not start with "--" is kept as a positional argument.
+class Options
+{
+	public:
+		Options();
+
+		void parse(const std::vector<std::string>& args);
+
+		bool has(const std::string& name) const;
+		std::string getString(const std::string& name, const std::string& defaultValue) const;
+		int getInt(const std::string& name, int defaultValue) const;
+		float getFloat(const std::string& name, float defaultValue) const;
+
+		std::vector<std::string> positional;
+
+	private:
+		std::map<std::string, std::string> values;
+};
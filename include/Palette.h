@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Particle colors as a fixed-size lookup table over [0, range). Values past the
+// range use the last entry. The built in palettes are generated from the
+// original piecewise definitions in getValueColor(); user palettes are loaded
+// from a text file into the same format.
+class Palette
+{
+	public:
+		static const size_t Size = 4096;
+
+		Palette();
+
+		void generate(bool timeDomain, bool greyscale, float velocityScale, float range);
+
+		// Lines of "x r g b" control points, linearly interpolated. An optional
+		// "range R" line sets the table range (default 1). '#' starts a comment.
+		bool load(const std::string& fileName);
+
+		float getRange() const;
+		float getVelocityScale() const;
+
+		std::array<float, 3> map(float x) const;
+
+		// Colors for the absolute value of every sample in a row.
+		void mapRow(const float* values, size_t count, std::array<float, 3>* out) const;
+
+		// The piecewise definition the built in tables are generated from.
+		static std::array<float, 3> getValueColor(float x, bool timeDomain, bool greyscale, float velocityScale);
+
+	private:
+		void setRange(float range);
+
+		std::vector<std::array<float, 3>> table;
+		float range;
+		float scale;
+		float velocityScale;
+};
@@ -3,8 +3,11 @@
 #include "cinder/app/AppNative.h"
 #include "cinder/gl/gl.h"
 #include "cinder/Rand.h"
+#include "cinder/Surface.h"
 
 #include "FMOD.hpp"
+#include "FrameArena.h"
+#include "MemoryLedger.h"
 #include "Particle.h"
 #include "ParticleController.h"
 
@@ -16,21 +19,57 @@ using namespace ci;
 using namespace ci::app;
 using namespace std;
 
+// One point sprite's worth of vertex data, laid out for glVertexPointer/glColorPointer.
+struct ParticleVertex
+{
+	float x;
+	float y;
+	float r;
+	float g;
+	float b;
+};
+
+// Contiguous so the field stops allocating once it has reached its size; counted in the memory ledger.
+typedef std::vector<Particle, CountingAllocator<Particle, MemoryLedger::Subsystem_Particles>> ParticleList;
+
 class ParticleController
 {
 	public:
 		ParticleController();
 
-		void update();
-		void draw();
+		// Returns how many particles were culled for age or for leaving the screen.
+		size_t update();
+
+		// Vertex arrays come from 'arena', so it must not be reset until the frame is drawn.
+		void draw(FrameArena& arena);
+
+		// Whether update() will remove the particle.
+		static bool isDead(const Particle& p, int width, int height, uint32_t maxAge);
+
+		// Hash of every particle's state; equal only if two simulations are bit-identical.
+		uint64_t getChecksum() const;
+
+		// Vertices for the 2 and 4 pixel point passes; larger particles are drawn one at a time,
+		// or fold into the point passes when pointPasses is below 3. Both arrays must have
+		// room for every particle.
+		void buildVertices(ParticleVertex* small, size_t& smallCount, ParticleVertex* medium, size_t& mediumCount) const;
+
+		// Same point sizes as draw(), rasterized on the CPU into 'surface'.
+		void drawSoftware(ci::Surface8u& surface) const;
+
 		void addParticle(float x, float y, float value);
 		void addParticle(float x, float y, float value, bool enableVelocityScale);
 		void addParticle(float x, float y, float value, std::array<float, 3> rgb);
 		void addParticle(float x, float y, float value, std::array<float, 3> rgb, bool enableVelocityScale, bool xyVelocitySwap = false);
 
-		std::list<Particle> particles;
+		ParticleList particles;
 		uint32_t maxAge;
 		float entropy;
+
+		// Set by the quality governor: a fraction of maxAge to cull at, and how
+		// many draw passes to use (3 full, 2 without scaled quads, 1 points only).
+		float ageScale;
+		int pointPasses;
 		int screenWidth;
 		int screenHeight;
 };
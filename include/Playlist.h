@@ -0,0 +1,84 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#pragma pack(push, 1)
+// On-disk layout of a binary playlist: this header, then one uint64 offset
+// per block of BlockSize entries, then the string pool. Within a block each
+// entry is stored as varints (bytes shared with the previous entry, suffix
+// length) followed by the suffix. The first entry of a block shares nothing,
+// so any entry can be found by decoding at most one block.
+struct PlaylistHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t count;
+	uint64_t blockCount;
+	uint64_t poolBytes;
+};
+#pragma pack(pop)
+
+// An ordered list of track paths held in the compressed form above. A
+// binary playlist file is memory-mapped and used in place; the first edit
+// copies it into memory. Text playlists (one path per line) can still be
+// imported and exported.
+class Playlist
+{
+	public:
+		static const uint32_t Version = 1;
+		static const size_t BlockSize = 16;
+
+		Playlist();
+
+		// Map a binary playlist. Returns false if it isn't one, or its block table is damaged.
+		bool open(const std::string& fileName);
+
+		// Becomes a copy of 'other': the same mapping if it is mapped, else a copy of its pool.
+		void assign(const Playlist& other);
+		bool save(const std::string& fileName);
+
+		bool importText(const std::string& fileName);
+		bool exportText(const std::string& fileName) const;
+
+		void clear();
+		void push_back(const std::string& fileName);
+
+		size_t size() const;
+		bool empty() const;
+		std::string operator[](size_t index) const;
+
+		// Decodes entry 'index' into 'entry', reusing its storage. Empty if out of range or damaged.
+		void get(size_t index, std::string& entry) const;
+
+		// Heap held by an in-memory playlist; a mapped one costs nothing until edited.
+		size_t getMemoryBytes() const;
+
+		// Decodes every entry in order, cheaper than indexing each one. Stops at damage.
+		void forEach(const std::function<void(const std::string&)>& f) const;
+
+	protected:
+		// Copy a mapped playlist into memory so it can be changed.
+		void detach();
+
+		const uint8_t* getPool() const;
+		uint64_t getBlockOffset(size_t block) const;
+		// Null if the entry runs past 'end'; a mapped file is only as good as whoever wrote it.
+		static const uint8_t* decode(const uint8_t* p, const uint8_t* end, std::string& entry);
+
+	private:
+		Playlist(const Playlist&);
+		Playlist& operator=(const Playlist&);
+
+		MappedFile file;
+		std::string fileName;
+		PlaylistHeader header;
+
+		std::vector<uint8_t> pool;
+		std::vector<uint64_t> offsets;
+		std::string last;
+};
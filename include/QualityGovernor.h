@@ -0,0 +1,84 @@
+#pragma once
+
+#include "FrameProfiler.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How far the governor may go, and what it is aiming for.
+struct QualityBounds
+{
+	QualityBounds();
+
+	// Milliseconds of UI thread work per frame to hold, not counting the swap.
+	double targetMs;
+
+	// Emit from every Nth sample at most.
+	int maxEmissionStride;
+
+	// 3 draws small points, medium points and scaled quads; 2 draws the large
+	// particles as medium points; 1 draws everything in one small point pass.
+	int minPointPasses;
+
+	// Fractions of the user's wave sample size, particle max age and window resolution.
+	float minWaveScale;
+	float minAgeScale;
+	float minRenderScale;
+};
+
+// One rung of the quality ladder. The first rung is full quality.
+struct QualityLevel
+{
+	QualityLevel();
+
+	int emissionStride;
+	int pointPasses;
+	float waveScale;
+	float ageScale;
+	float renderScale;
+};
+
+// Watches the profiler's per-frame work time and steps down a ladder of
+// cheaper settings while it runs over target, and back up once it has been
+// comfortably under for a while. Dropping is quick and climbing is slow, and
+// every change is followed by a hold, so the picture doesn't oscillate.
+class QualityGovernor
+{
+	public:
+		QualityGovernor();
+
+		void configure(const QualityBounds& bounds);
+		const QualityBounds& getBounds() const;
+
+		// Disabling goes straight back to full quality.
+		void setEnabled(bool enabled);
+		bool isEnabled() const;
+
+		// Feed the newest committed frame once per frame. Returns true when the level changed.
+		bool update(const FrameProfiler::Frame& frame);
+
+		const QualityLevel& getLevel() const;
+		size_t getLevelIndex() const;
+		size_t getLevelCount() const;
+
+		// Smoothed UI thread work per frame, in milliseconds.
+		double getAverageMs() const;
+
+		// One line for the stats overlay.
+		std::string describe() const;
+
+	private:
+		void reset();
+
+		QualityBounds bounds;
+		std::vector<QualityLevel> levels;
+		size_t index;
+		bool enabled;
+
+		uint64_t lastFrame;
+		double averageMs;
+		int overFrames;
+		int underFrames;
+		int holdFrames;
+};
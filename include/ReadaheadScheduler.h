@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Warms upcoming playlist tracks into the OS page cache on a background
+// thread, so a track on slow or spinning storage starts as quickly as one
+// on a local SSD. The start of every track is read first, then the rest in
+// playlist order, until the byte budget is spent. A new schedule replaces
+// the old one immediately.
+class ReadaheadScheduler
+{
+	public:
+		ReadaheadScheduler();
+		~ReadaheadScheduler();
+
+		void start(uint64_t budget);
+		void stop();
+
+		// Warm 'fileNames' in order of priority, abandoning any earlier schedule.
+		void schedule(const std::vector<std::string>& fileNames);
+		void cancel();
+
+		bool isBusy() const;
+		uint64_t getWarmedBytes() const;
+		size_t getWarmedFiles() const;
+
+	protected:
+		void run();
+
+		// Pages in [offset, offset + count) in chunks. False if the schedule changed part way.
+		bool warm(const std::string& fileName, uint64_t offset, uint64_t count, unsigned int generation);
+
+	private:
+		std::thread thread;
+		mutable std::mutex mutex;
+		std::condition_variable condition;
+		std::vector<std::string> fileNames;
+		bool hasSchedule;
+		bool busy;
+
+		uint64_t budget;
+		std::atomic<unsigned int> generation;
+		std::atomic<uint64_t> warmedBytes;
+		std::atomic<size_t> warmedFiles;
+		std::atomic<bool> running;
+};
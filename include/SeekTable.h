@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#pragma pack(push, 1)
+// On-disk layout of an MP3 seek table.
+struct SeekTableHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t sampleRate;
+	uint32_t channels;
+	uint32_t samplesPerFrame;
+	uint32_t encoderDelay;
+	uint32_t encoderPadding;
+	uint32_t reserved;
+	uint64_t frameCount;
+};
+#pragma pack(pop)
+
+// One parsed MPEG audio frame header.
+struct Mp3Frame
+{
+	uint32_t length;
+	uint32_t sampleRate;
+	uint32_t samples;
+	uint32_t channels;
+	bool mpeg1;
+};
+
+// Frame count and LAME gapless info of a (typically VBR) MP3, built by
+// walking the frame headers once. Gives the exact decoded length without
+// FMOD_ACCURATETIME's scan at open, and what to trim for a gapless join.
+class SeekTable
+{
+	public:
+		static const uint32_t Version = 2;
+
+		// Samples an MP3 decoder outputs before the first encoded one.
+		static const uint32_t DecoderDelay = 529;
+
+		SeekTable();
+
+		// Walks 'mp3FileName' and writes the table to 'cacheFileName'.
+		static bool build(const std::string& mp3FileName, const std::string& cacheFileName, uint64_t key);
+
+		// Parses the 4 byte header at 'p'. False if it isn't a valid frame header.
+		static bool parseFrame(const uint8_t* p, Mp3Frame& frame);
+
+		bool open(const std::string& cacheFileName, uint64_t key);
+
+		const SeekTableHeader& getHeader() const;
+
+		// Samples a decoder produces, including the encoder delay and padding.
+		uint64_t getSampleCount() const;
+
+		// Decoded samples before the programme starts: the encoder and decoder
+		// delay when the file has a LAME tag, otherwise zero.
+		uint64_t getLeadingSamples() const;
+
+		// Samples of actual programme, with the delay and padding removed.
+		uint64_t getGaplessSampleCount() const;
+
+	private:
+		SeekTableHeader header;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "SeekTable.h"
+
+#include "cinder/Timer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// Background service that walks an MP3 the first time the track is seen and
+// caches its frame count and LAME gapless info in a small file keyed by the
+// file's identity. Later opens read that instead of scanning the file.
+class SeekTableCache
+{
+	public:
+		SeekTableCache();
+		~SeekTableCache();
+
+		void start(const std::string& directory);
+		void stop();
+
+		// Queue a track for indexing. Returns immediately. Anything not ending in .mp3 is ignored.
+		void request(const std::string& fileName);
+
+		// The table for a track if it is ready, otherwise null (and the track is queued).
+		std::shared_ptr<const SeekTable> get(const std::string& fileName);
+
+		size_t getPendingCount() const;
+		uint64_t getBuiltCount() const;
+
+	protected:
+		void run();
+		std::string getCacheFileName(uint64_t key) const;
+
+	private:
+		typedef std::pair<std::string, std::shared_ptr<const SeekTable>> ReadyEntry;
+
+		// A track that couldn't be indexed, with the identity it had then.
+		struct Failure
+		{
+			uint64_t key;
+			double time;
+		};
+
+		std::thread thread;
+		mutable std::mutex mutex;
+		std::condition_variable condition;
+		std::deque<std::string> queue;
+		std::set<std::string> pending;
+		std::map<std::string, Failure> failed;
+		std::list<ReadyEntry> ready;
+
+		std::string directory;
+		ci::Timer timer;
+		std::atomic<uint64_t> builtCount;
+		std::atomic<bool> running;
+};
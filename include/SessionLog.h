@@ -0,0 +1,115 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#pragma pack(push, 1)
+// File header; 'frameCount' is filled in when the recording is closed.
+struct SessionHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t seed;
+	uint32_t frameCount;
+};
+
+// Everything the keyboard and mouse can change that feeds emission.
+struct SessionControls
+{
+	enum Flag
+	{
+		Flag_AbsoluteValue = 1,
+		Flag_Greyscale = 2,
+		Flag_VelocityScale = 4,
+		Flag_WaveColoring = 8,
+		Flag_AvSync = 16,
+		Flag_Decimation = 32
+	};
+
+	float velocityScale;
+	float entropy;
+	uint32_t maxAge;
+	int32_t domain;
+	int32_t waveSampleSize;
+	uint32_t flags;
+
+	// --skip-silent's threshold; zero emits every column.
+	float emissionFloor;
+};
+#pragma pack(pop)
+
+// One frame of a session: the view size, any control changes, the analysis
+// picked up that frame if there was a new one, and a checksum of the particle
+// state afterwards so a replay can tell whether it stayed bit-exact.
+struct SessionFrame
+{
+	SessionFrame();
+
+	uint32_t width;
+	uint32_t height;
+
+	bool hasControls;
+	SessionControls controls;
+
+	bool hasAnalysis;
+	std::vector<float> wave;
+	std::vector<float> spectrum;
+	float waveMax;
+	float spectrumMax;
+
+	// The settings the analysis colored itself with.
+	bool timeDomain;
+	bool greyscale;
+	float paletteVelocityScale;
+
+	uint64_t checksum;
+};
+
+// Writes a session log frame by frame.
+class SessionRecorder
+{
+	public:
+		static const uint32_t Version = 2;
+
+		SessionRecorder();
+		~SessionRecorder();
+
+		bool open(const std::string& fileName, uint32_t seed);
+		void close();
+		bool isOpen() const;
+
+		void write(const SessionFrame& frame);
+		uint32_t getFrameCount() const;
+
+	private:
+		std::ofstream os;
+		uint32_t frameCount;
+};
+
+// Reads a session log back, mapped, in order.
+class SessionPlayer
+{
+	public:
+		SessionPlayer();
+
+		bool open(const std::string& fileName);
+		bool isOpen() const;
+
+		// False at the end of the log (or at a truncated frame).
+		bool next(SessionFrame& frame);
+		void rewind();
+
+		uint32_t getSeed() const;
+		uint32_t getFrameCount() const;
+
+	private:
+		bool read(void* out, size_t size);
+
+		MappedFile file;
+		SessionHeader header;
+		uint64_t position;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "FMOD.hpp"
+
+#include <cstdint>
+#include <string>
+
+// Deterministic test signals, playable through FMOD as a looping user stream
+// so the capture and analysis path sees them exactly like a decoded track.
+class SignalGenerator
+{
+	public:
+		enum Type
+		{
+			// A three note chord of pure tones.
+			Type_Sine,
+			// Logarithmic sweep from 20 Hz to 20 kHz every ten seconds.
+			Type_Sweep,
+			// Full band white noise from a fixed seed.
+			Type_Noise,
+			// Single sample clicks four times a second.
+			Type_Impulse,
+			Type_End
+		};
+
+		SignalGenerator(Type type = Type_Sine, int sampleRate = 44100, int channels = 2);
+
+		static bool parseType(const std::string& name, Type& type);
+		static const char* getTypeName(Type type);
+
+		Type getType() const;
+
+		// Interleaved samples; continues where the last call stopped.
+		void generate(float* out, size_t frames);
+
+		// A looping stream that pulls from this generator. The generator must outlive it.
+		FMOD::Sound* createSound(FMOD::System* system);
+
+	protected:
+		static FMOD_RESULT F_CALLBACK readCallback(FMOD_SOUND* sound, void* data, unsigned int length);
+		static FMOD_RESULT F_CALLBACK setPositionCallback(FMOD_SOUND* sound, int subsound, unsigned int position, FMOD_TIMEUNIT unit);
+
+	private:
+		float next();
+
+		Type type;
+		int sampleRate;
+		int channels;
+		uint64_t position;
+		uint32_t noiseState;
+		double sweepPhase;
+};
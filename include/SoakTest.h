@@ -0,0 +1,50 @@
+#pragma once
+
+#include "cinder/Timer.h"
+
+#include "MemoryMonitor.h"
+
+#include <ostream>
+
+struct SoakSettings
+{
+	SoakSettings();
+
+	double hours;
+
+	// How long each track plays before moving on.
+	double trackSeconds;
+
+	// Growth while caches and pools fill up at the start isn't held against the run.
+	double warmupMinutes;
+
+	// Most a subsystem's live bytes may grow per hour after the warmup, unless it has its own limit.
+	double maxSlope;
+};
+
+// Cycles the playlist for hours and then checks that no subsystem's memory
+// kept growing once the run had warmed up.
+class SoakTest
+{
+	public:
+		SoakTest();
+
+		void start(const SoakSettings& settings);
+		void stop();
+		bool isRunning() const;
+		const SoakSettings& getSettings() const;
+
+		// True once per trackSeconds, when it's time for the next track.
+		bool isTrackDue();
+		bool isComplete() const;
+
+		// Prints each subsystem's slope and peak against its limits in 'monitor', or
+		// maxSlope where it has none. Returns true if all passed.
+		bool evaluate(const MemoryMonitor& monitor, std::ostream& os) const;
+
+	private:
+		SoakSettings settings;
+		ci::Timer timer;
+		bool running;
+		double nextTrack;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+// Summary of a sample distribution (frame times, latencies, ...).
+struct Distribution
+{
+	Distribution();
+
+	size_t count;
+	double mean;
+	double min;
+	double max;
+	double p50;
+	double p95;
+	double p99;
+};
+
+// Keeps the most recent samples of a running measurement.
+class SampleWindow
+{
+	public:
+		explicit SampleWindow(size_t capacity = 240);
+
+		void push(double value);
+		void clear();
+		bool empty() const;
+		double last() const;
+
+		Distribution summarize() const;
+
+	private:
+		size_t capacity;
+		std::deque<double> samples;
+};
+
+namespace Statistics
+{
+	// Linear-interpolated percentile, p in [0, 100]. The input must be sorted.
+	double percentileSorted(const std::vector<double>& sorted, double p);
+
+	Distribution summarize(std::vector<double> samples);
+
+	// Least squares slope of y over x. Zero with fewer than two distinct x.
+	double slope(const std::vector<double>& x, const std::vector<double>& y);
+
+	std::string toString(const Distribution& d, const std::string& units);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "AudioCapture.h"
+#include "Fft.h"
+
+#include <cstdint>
+#include <vector>
+
+// One analyzed hop of the captured stream.
+struct StftColumn
+{
+	StftColumn();
+
+	uint64_t clock;
+	std::vector<float> left;
+	std::vector<float> right;
+};
+
+// Streaming short-time Fourier transform over the captured audio. Columns are
+// produced once per hop of audio and kept in a short history, so the cost is
+// fixed per second of audio no matter how fast frames are rendered, and
+// overlapping windows come for free.
+class Stft
+{
+	public:
+		Stft();
+
+		void configure(size_t windowSize, size_t hop, size_t historySize);
+		void reset();
+
+		size_t getWindowSize() const;
+		size_t getHop() const;
+		size_t getBinCount() const;
+		uint64_t getColumnsProcessed() const;
+
+		// Heap held by the column history and input window.
+		size_t getMemoryBytes() const;
+
+		// Analyzes every complete hop captured since the last call.
+		size_t process(const AudioCapture& capture);
+
+		// Magnitudes of 'channel' at 'clock', either from the newest column at or
+		// before it or interpolated between the two columns around it. The bins are
+		// resampled to 'count' values covering the same frequency range.
+		bool getSpectrum(uint64_t clock, int channel, bool interpolate, float* out, size_t count) const;
+
+	private:
+		const StftColumn& getColumn(size_t age) const;
+
+		Fft fft;
+		std::vector<StftColumn> history;
+		std::vector<float> input;
+
+		size_t windowSize;
+		size_t hop;
+		size_t newest;
+		size_t columnCount;
+		uint64_t nextClock;
+		uint64_t columnsProcessed;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+
+#pragma pack(push, 1)
+// On-disk layout of a pre-analyzed track: this header followed by one record
+// per hop. A record holds the hop's left channel samples as int8 followed by
+// the left and right spectrum of the window ending at the end of the hop,
+// each 'bins' log-quantized uint8 magnitudes.
+struct TrackAnalysisHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t contentHash;
+	uint32_t sampleRate;
+	uint32_t hop;
+	uint32_t windowSize;
+	uint32_t bins;
+	uint64_t columns;
+};
+#pragma pack(pop)
+
+// A memory-mapped, pre-analyzed track. Reading a window is a table lookup.
+class TrackAnalysis
+{
+	public:
+		static const uint32_t Version = 1;
+
+		TrackAnalysis();
+
+		bool open(const std::string& fileName, uint64_t contentHash);
+
+		const TrackAnalysisHeader& getHeader() const;
+		int getSampleRate() const;
+
+		// 'count' left channel samples ending at 'position' (PCM samples of the track).
+		void getWave(uint64_t position, float* out, size_t count) const;
+
+		// Magnitudes of 'channel' from the newest column ending at or before 'position'.
+		// Bins past those stored are zero.
+		void getSpectrum(uint64_t position, int channel, float* out, size_t count) const;
+
+		static uint8_t quantizeMagnitude(float magnitude);
+
+	private:
+		MappedFile file;
+		TrackAnalysisHeader header;
+		size_t recordSize;
+		float magnitudes[256];
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "FMOD.hpp"
+#include "TrackAnalysis.h"
+
+#include "cinder/Timer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Background service that decodes tracks ahead of playback and stores their
+// per-hop waveform and spectrum columns in a memory-mapped cache keyed by a
+// hash of the file contents. Repeat plays read precomputed columns instead
+// of running any FFTs. The cache directory is kept under a size limit by
+// evicting the least recently used entries.
+class TrackAnalysisCache
+{
+	public:
+		TrackAnalysisCache();
+		~TrackAnalysisCache();
+
+		void start(const std::string& directory, uint64_t maxBytes, size_t windowSize, size_t hop);
+		void stop();
+
+		// Queue a track for analysis. Returns immediately.
+		void request(const std::string& fileName);
+
+		// The analysis for a track if it is ready, otherwise null (and the track is queued).
+		std::shared_ptr<const TrackAnalysis> get(const std::string& fileName);
+
+		size_t getPendingCount() const;
+		uint64_t getCacheBytes() const;
+
+	protected:
+		void run();
+		bool analyze(const std::string& fileName, const std::string& cacheFileName, uint64_t contentHash);
+		void evict();
+
+		static uint64_t hashFile(const std::string& fileName);
+		std::string getCacheFileName(uint64_t contentHash) const;
+
+	private:
+		typedef std::pair<std::string, std::shared_ptr<const TrackAnalysis>> ReadyEntry;
+
+		// A track that couldn't be analysed. 'key' is its identity then, or zero if
+		// it couldn't even be hashed and so is worth another try as it is.
+		struct Failure
+		{
+			uint64_t key;
+			double time;
+		};
+
+		FMOD::System* system;
+
+		std::thread thread;
+		mutable std::mutex mutex;
+		std::condition_variable condition;
+		std::deque<std::string> queue;
+		std::set<std::string> pending;
+		std::map<std::string, Failure> failed;
+		std::list<ReadyEntry> ready;
+
+		// Content hash by file identity, so a repeat play doesn't read the whole file again. Worker thread only.
+		std::unordered_map<uint64_t, uint64_t> contentHashes;
+
+		std::string directory;
+		uint64_t maxBytes;
+		uint64_t cacheBytes;
+		size_t windowSize;
+		size_t hop;
+		ci::Timer timer;
+		std::atomic<bool> running;
+};
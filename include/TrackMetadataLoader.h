@@ -0,0 +1,65 @@
+#pragma once
+
+#include "cinder/Surface.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct TrackMetadata
+{
+	TrackMetadata();
+
+	std::string fileName;
+	std::string artist;
+	std::string album;
+	std::string title;
+	unsigned int year;
+	double duration;
+
+	// Decoded and already scaled to the requested size. Only valid if hasAlbumArt.
+	ci::Surface8u albumArt;
+	bool hasAlbumArt;
+};
+
+// Reads ID3 tags and decodes the embedded album art on a worker thread, so
+// a track change costs the UI thread nothing but a small texture upload.
+// Only the most recent request matters; results for tracks that have since
+// been skipped are dropped.
+class TrackMetadataLoader
+{
+	public:
+		TrackMetadataLoader();
+		~TrackMetadataLoader();
+
+		void start();
+		void stop();
+
+		// Album art larger than artSize pixels square is scaled down to it.
+		void request(const std::string& fileName, int artSize);
+
+		// Moves the result for the latest request into 'metadata'. Returns false if it isn't ready yet.
+		bool poll(TrackMetadata& metadata);
+
+		// Reads tags and art synchronously on the calling thread.
+		static void load(const std::string& fileName, int artSize, TrackMetadata& metadata);
+
+	protected:
+		void run();
+
+	private:
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		std::string requestFileName;
+		int requestArtSize;
+		bool hasRequest;
+
+		TrackMetadata result;
+		bool hasResult;
+
+		std::atomic<bool> running;
+};
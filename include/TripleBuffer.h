@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Single producer, single consumer triple buffer. The producer fills the back
+// buffer and publishes it; the consumer picks up the newest published buffer.
+// Neither side ever waits on the other, stale buffers are simply overwritten.
+template<typename T>
+class TripleBuffer
+{
+	public:
+		TripleBuffer() :
+			back(0),
+			middle(1),
+			front(2)
+		{
+		}
+
+		// Producer side.
+		T& getWriteBuffer()
+		{
+			return this->buffers[this->back];
+		}
+
+		void publish()
+		{
+			this->back = this->middle.exchange(this->back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+		}
+
+		// Consumer side. Returns true if a newer buffer was picked up.
+		bool update()
+		{
+			if((this->middle.load(std::memory_order_acquire) & FreshBit) == 0)
+			{
+				return false;
+			}
+
+			this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & IndexMask;
+			return true;
+		}
+
+		const T& getReadBuffer() const
+		{
+			return this->buffers[this->front];
+		}
+
+	private:
+		static const uint32_t FreshBit = 4;
+		static const uint32_t IndexMask = 3;
+
+		T buffers[3];
+		uint32_t back;
+		std::atomic<uint32_t> middle;
+		uint32_t front;
+};
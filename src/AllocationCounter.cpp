@@ -0,0 +1,138 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#if defined(_DEBUG) && !defined(EPOCH_COUNT_ALLOCATIONS)
+	#define EPOCH_COUNT_ALLOCATIONS
+#endif
+
+#if defined(EPOCH_COUNT_ALLOCATIONS)
+
+namespace
+{
+	// Plain globals: they are zero before any constructor can allocate.
+	std::thread::id watched;
+	std::atomic<uint64_t> count;
+	bool suspended;
+
+	void* allocate(size_t size)
+	{
+		if(suspended == false && std::this_thread::get_id() == watched)
+		{
+			count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return malloc(size > 0 ? size : 1);
+	}
+}
+
+void* operator new(size_t size)
+{
+	auto p = allocate(size);
+
+	if(p == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw()
+{
+	return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw()
+{
+	return allocate(size);
+}
+
+void operator delete(void* p) throw()
+{
+	free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+	free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) throw()
+{
+	free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) throw()
+{
+	free(p);
+}
+
+bool AllocationCounter::isAvailable()
+{
+	return true;
+}
+
+void AllocationCounter::watchThisThread()
+{
+	watched = std::this_thread::get_id();
+	count = 0;
+}
+
+uint64_t AllocationCounter::getCount()
+{
+	return count.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::reset()
+{
+	count = 0;
+}
+
+void AllocationCounter::suspend()
+{
+	suspended = true;
+}
+
+void AllocationCounter::resume()
+{
+	suspended = false;
+}
+
+#else
+
+bool AllocationCounter::isAvailable()
+{
+	return false;
+}
+
+void AllocationCounter::watchThisThread()
+{
+}
+
+uint64_t AllocationCounter::getCount()
+{
+	return 0;
+}
+
+void AllocationCounter::reset()
+{
+}
+
+void AllocationCounter::suspend()
+{
+}
+
+void AllocationCounter::resume()
+{
+}
+
+#endif
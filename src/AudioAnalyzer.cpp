@@ -0,0 +1,444 @@
+#include "AudioAnalyzer.h"
+#include "MemoryLedger.h"
+#include "Palette.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+AnalysisSettings::AnalysisSettings() :
+	waveSampleSize(1024),
+	sampleSize(1024),
+	analyzeWave(true),
+	analyzeSpectrum(false),
+	timeDomain(true),
+	useGreyscale(false),
+	useAvSync(true),
+	velocityScale(1.0f),
+	presentationLead(0)
+{
+}
+
+AnalysisFrame::AnalysisFrame() :
+	sequence(0),
+	clock(0),
+	waveMax(0),
+	spectrumMax(0),
+	analysisSeconds(0),
+	fetchSeconds(0),
+	spectrumSeconds(0),
+	colorSeconds(0),
+	precomputed(false)
+{
+	this->waveMaxColor.fill(0);
+	this->spectrumMaxColor.fill(0);
+}
+
+AudioAnalyzer::AudioAnalyzer() :
+	system(nullptr),
+	stftInterpolate(true),
+	hasUserPalette(false),
+	trackChannel(nullptr),
+	trackPosition(0),
+	usePrecomputed(false),
+	running(false),
+	paused(false),
+	timer(true),
+	rate(120.0),
+	sequence(0),
+	latchClock(0),
+	stftColumns(0)
+{
+	// Spectrum dB values run well past 1, so those tables cover a wider range.
+	this->timePalette.generate(true, false, 0, 2.0f);
+	this->spectrumPalette.generate(false, false, 0, 16.0f);
+	this->greyscalePalette.generate(true, true, 1.0f, 16.0f);
+	this->greyscaleTimeDomain = true;
+}
+
+AudioAnalyzer::~AudioAnalyzer()
+{
+	this->stop();
+}
+
+void AudioAnalyzer::start(double rate)
+{
+	this->stop();
+
+	this->rate = std::max(rate, 1.0);
+	this->running = true;
+	this->thread = std::thread(&AudioAnalyzer::run, this);
+}
+
+void AudioAnalyzer::stop()
+{
+	this->running = false;
+
+	if(this->thread.joinable() == true)
+	{
+		this->thread.join();
+	}
+}
+
+void AudioAnalyzer::setPaused(bool paused)
+{
+	this->paused = paused;
+}
+
+void AudioAnalyzer::step()
+{
+	if(this->running == false)
+	{
+		this->process();
+	}
+}
+
+void AudioAnalyzer::attach(FMOD::System* system)
+{
+	std::lock_guard<std::mutex> lock(this->sourceMutex);
+	this->system = system;
+	this->capture.attach(system);
+}
+
+void AudioAnalyzer::detach()
+{
+	std::lock_guard<std::mutex> lock(this->sourceMutex);
+	this->capture.detach();
+	this->system = nullptr;
+	this->trackAnalysis.reset();
+	this->trackChannel = nullptr;
+}
+
+void AudioAnalyzer::configureStft(size_t windowSize, size_t hop, bool interpolate)
+{
+	std::lock_guard<std::mutex> lock(this->sourceMutex);
+	this->stft.configure(windowSize, hop, 32);
+	this->stftInterpolate = interpolate;
+}
+
+bool AudioAnalyzer::loadPalette(const std::string& fileName)
+{
+	Palette palette;
+
+	if(palette.load(fileName) == false)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(this->sourceMutex);
+	this->userPalette = palette;
+	this->hasUserPalette = true;
+	return true;
+}
+
+void AudioAnalyzer::setTrackAnalysis(std::shared_ptr<const TrackAnalysis> analysis, FMOD::Channel* channel)
+{
+	std::lock_guard<std::mutex> lock(this->sourceMutex);
+	this->trackAnalysis = analysis;
+	this->trackChannel = channel;
+}
+
+void AudioAnalyzer::configure(const AnalysisSettings& settings)
+{
+	std::lock_guard<std::mutex> lock(this->settingsMutex);
+	this->settings = settings;
+}
+
+bool AudioAnalyzer::update()
+{
+	return this->frames.update();
+}
+
+const AnalysisFrame& AudioAnalyzer::getFrame() const
+{
+	return this->frames.getReadBuffer();
+}
+
+const AudioCapture& AudioAnalyzer::getCapture() const
+{
+	return this->capture;
+}
+
+double AudioAnalyzer::getRate() const
+{
+	return this->rate;
+}
+
+size_t AudioAnalyzer::getStftWindowSize() const
+{
+	return this->stft.getWindowSize();
+}
+
+size_t AudioAnalyzer::getStftHop() const
+{
+	return this->stft.getHop();
+}
+
+uint64_t AudioAnalyzer::getStftColumns() const
+{
+	return this->stftColumns.load();
+}
+
+void AudioAnalyzer::run()
+{
+	auto period = 1.0 / this->rate;
+	auto next = this->timer.getSeconds();
+
+	while(this->running == true)
+	{
+		if(this->paused == false)
+		{
+			this->process();
+		}
+
+		// Hold our own cadence regardless of how fast the display runs.
+		next += period;
+		auto now = this->timer.getSeconds();
+
+		if(next > now)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>((next - now) * 1000000.0)));
+		}
+		else
+		{
+			next = now;
+		}
+	}
+}
+
+void AudioAnalyzer::process()
+{
+	AnalysisSettings current;
+	{
+		std::lock_guard<std::mutex> lock(this->settingsMutex);
+		current = this->settings;
+	}
+
+	auto start = this->timer.getSeconds();
+
+	AnalysisFrame& frame = this->frames.getWriteBuffer();
+	{
+		std::lock_guard<std::mutex> lock(this->sourceMutex);
+
+		if(this->system != nullptr)
+		{
+			this->analyze(current, frame);
+		}
+	}
+
+	frame.sequence = ++this->sequence;
+	frame.analysisSeconds = this->timer.getSeconds() - start;
+
+	// The other two frames of the triple buffer are the same size once settled.
+	auto frameBytes = (frame.wave.capacity() + frame.spectrum.capacity()) * sizeof(float) 
+		+ (frame.waveColors.capacity() + frame.spectrumColors.capacity()) * sizeof(std::array<float, 3>);
+	MemoryLedger::set(MemoryLedger::Subsystem_Analysis, static_cast<int64_t>(frameBytes * 3 + this->stft.getMemoryBytes()
+		+ (this->waveDataLeft.capacity() + this->waveDataRight.capacity()) * sizeof(float)));
+
+	this->frames.publish();
+}
+
+void AudioAnalyzer::analyze(const AnalysisSettings& settings, AnalysisFrame& frame)
+{
+	// Select the audio that will be audible when a frame picked up now reaches the screen.
+	this->latchClock = this->capture.getAudibleClockAt(this->capture.getSeconds() + settings.presentationLead);
+	frame.clock = std::min(this->latchClock, this->capture.getWriteClock());
+
+	// A pre-analyzed track is read at the channel's audible position, no FFT needed.
+	this->usePrecomputed = false;
+
+	if(settings.useAvSync == true && this->trackAnalysis && this->trackChannel != nullptr
+		&& this->trackAnalysis->getHeader().windowSize == static_cast<uint32_t>(settings.sampleSize * 2))
+	{
+		unsigned int position = 0;
+
+		if(this->trackChannel->getPosition(&position, FMOD_TIMEUNIT_PCM) == FMOD_OK)
+		{
+			// The channel position is where the mixer reads. The output buffer delays
+			// that, and the frame needs what is audible when it is shown.
+			auto lag = static_cast<double>(this->capture.getLatencySamples()) / this->capture.getSampleRate() - settings.presentationLead;
+			auto audible = static_cast<double>(position) - lag * this->trackAnalysis->getSampleRate();
+			this->trackPosition = audible > 0 ? static_cast<uint64_t>(audible) : 0;
+			this->usePrecomputed = true;
+		}
+	}
+
+	frame.precomputed = this->usePrecomputed;
+
+	auto start = this->timer.getSeconds();
+
+	frame.wave.resize(settings.analyzeWave == true ? std::max(settings.waveSampleSize, 0) : 0);
+	frame.waveColors.resize(frame.wave.size());
+	frame.waveMax = 0;
+
+	if(frame.wave.empty() == false)
+	{
+		this->getChannelWaveData(settings, frame.wave.data(), frame.wave.size(), 0);
+		frame.waveMax = fabs(*std::max_element(std::begin(frame.wave), std::end(frame.wave)));
+	}
+
+	auto fetched = this->timer.getSeconds();
+	frame.fetchSeconds = fetched - start;
+
+	// Keep the spectrogram current; this costs one FFT per hop of new audio.
+	if(settings.analyzeSpectrum == true && settings.useAvSync == true && this->capture.isAttached() == true && this->usePrecomputed == false)
+	{
+		this->stft.process(this->capture);
+		this->stftColumns = this->stft.getColumnsProcessed();
+	}
+
+	frame.spectrum.resize(settings.analyzeSpectrum == true ? std::max(settings.sampleSize, 0) : 0);
+	frame.spectrumColors.resize(frame.spectrum.size());
+	frame.spectrumMax = 0;
+
+	if(frame.spectrum.empty() == false)
+	{
+		this->getSpectrumDataMirrorDB(settings, frame.spectrum);
+		frame.spectrumMax = fabs(*std::max_element(std::begin(frame.spectrum), std::end(frame.spectrum)));
+	}
+
+	auto transformed = this->timer.getSeconds();
+	frame.spectrumSeconds = transformed - fetched;
+
+	frame.settings = settings;
+	this->colorize(frame);
+
+	frame.colorSeconds = this->timer.getSeconds() - transformed;
+}
+
+void AudioAnalyzer::colorize(AnalysisFrame& frame)
+{
+	const Palette& palette = this->selectPalette(frame.settings);
+
+	frame.waveColors.resize(frame.wave.size());
+	frame.spectrumColors.resize(frame.spectrum.size());
+
+	frame.waveMaxColor = palette.map(frame.waveMax);
+	frame.spectrumMaxColor = palette.map(frame.spectrumMax);
+
+	palette.mapRow(frame.wave.data(), frame.wave.size(), frame.waveColors.data());
+	palette.mapRow(frame.spectrum.data(), frame.spectrum.size(), frame.spectrumColors.data());
+}
+
+const Palette& AudioAnalyzer::selectPalette(const AnalysisSettings& settings)
+{
+	if(settings.useGreyscale == true)
+	{
+		// The greyscale ramp depends on the velocity scale, so rebuild it only when that or the domain changes.
+		if(this->greyscalePalette.getVelocityScale() != settings.velocityScale || this->greyscaleTimeDomain != settings.timeDomain)
+		{
+			this->greyscalePalette.generate(settings.timeDomain, true, settings.velocityScale, 16.0f);
+			this->greyscaleTimeDomain = settings.timeDomain;
+		}
+
+		return this->greyscalePalette;
+	}
+
+	if(this->hasUserPalette == true)
+	{
+		return this->userPalette;
+	}
+
+	return (settings.timeDomain == true) ? this->timePalette : this->spectrumPalette;
+}
+
+void AudioAnalyzer::mirrorSpectrumDB(const float* left, const float* right, size_t count, float* out)
+{
+	for(int i = count / 2; i >= 0; i--)
+	{
+		auto db = 10.0f * log10(1.0f + left[i]) * 2.0f;
+		db *= 1.5f;
+		
+		if(i % 2 == 0)
+		{
+			out[count/2 - i] = db;
+		}
+		else
+		{
+			out[count/2 - i] = -db;
+		}
+	}
+
+	for(int i = count / 2; i >= 0; i--)
+	{
+		auto db = 10.0f * log10(1.0f + right[i]) * 2.0f;
+		db *= 1.5f;
+		
+		if(i % 2 == 0)
+		{
+			out[count/2 + i - 1] = db;
+		}
+		else
+		{
+			out[count/2 + i - 1] = -db;
+		}
+	}
+}
+
+void AudioAnalyzer::getChannelWaveData(const AnalysisSettings& settings, float* out, size_t count, int channel)
+{
+	if(this->usePrecomputed == true)
+	{
+		// Only the left channel waveform is cached.
+		this->trackAnalysis->getWave(this->trackPosition, out, count);
+	}
+	else if(settings.useAvSync == true && this->capture.isAttached() == true)
+	{
+		this->capture.getWindow(this->latchClock, count, channel, out);
+	}
+	else
+	{
+		this->system->getWaveData(out, count, channel);
+	}
+}
+
+void AudioAnalyzer::getChannelSpectrum(const AnalysisSettings& settings, float* out, size_t count, int channel)
+{
+	if(this->usePrecomputed == true)
+	{
+		this->trackAnalysis->getSpectrum(this->trackPosition, channel, out, count);
+	}
+	else if(settings.useAvSync == true && this->capture.isAttached() == true)
+	{
+		// Reuse the streaming columns instead of transforming again for this frame.
+		this->stft.getSpectrum(this->latchClock, channel, this->stftInterpolate, out, count);
+	}
+	else
+	{
+		this->system->getSpectrum(out, count, channel, FMOD_DSP_FFT_WINDOW::FMOD_DSP_FFT_WINDOW_HANNING);
+	}
+}
+
+void AudioAnalyzer::getStereoWaveData(const AnalysisSettings& settings, std::vector<float>& waveData)
+{
+	this->waveDataLeft.resize(settings.waveSampleSize);
+	this->waveDataRight.resize(settings.waveSampleSize);
+	waveData.resize(settings.waveSampleSize);
+
+	this->getChannelWaveData(settings, this->waveDataLeft.data(), this->waveDataLeft.size(), 0);
+	this->getChannelWaveData(settings, this->waveDataRight.data(), this->waveDataRight.size(), 1);
+
+	for(size_t i = 0; i < waveData.size(); i++)
+	{
+		if(i % 2 == 0)
+		{
+			waveData[i] = -fabs(this->waveDataLeft[i]);
+		}
+		else
+		{
+			waveData[i] = fabs(this->waveDataRight[i]);
+		}
+	}
+}
+
+void AudioAnalyzer::getSpectrumDataMirrorDB(const AnalysisSettings& settings, std::vector<float>& waveDataReversed)
+{
+	this->waveDataLeft.resize(settings.sampleSize);
+	this->waveDataRight.resize(settings.sampleSize);
+	waveDataReversed.resize(settings.sampleSize);
+
+	this->getChannelSpectrum(settings, this->waveDataLeft.data(), this->waveDataLeft.size(), 0);
+	this->getChannelSpectrum(settings, this->waveDataRight.data(), this->waveDataRight.size(), 1);
+
+	AudioAnalyzer::mirrorSpectrumDB(this->waveDataLeft.data(), this->waveDataRight.data(), this->waveDataLeft.size(), waveDataReversed.data());
+}
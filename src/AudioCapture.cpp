@@ -0,0 +1,206 @@
+#include "AudioCapture.h"
+
+#include <algorithm>
+#include <cstring>
+
+AudioCapture::AudioCapture() :
+	system(nullptr),
+	dsp(nullptr),
+	timer(true),
+	writeClock(0),
+	stampIndex(0),
+	firstClock(0),
+	sampleRate(44100),
+	latencySamples(0)
+{
+	// Two interleaved channels per frame.
+	this->ring.resize(CapacityFrames * 2, 0.0f);
+	memset(this->stamps, 0, sizeof(this->stamps));
+}
+
+AudioCapture::~AudioCapture()
+{
+	this->detach();
+}
+
+bool AudioCapture::attach(FMOD::System* system)
+{
+	this->detach();
+
+	FMOD_DSP_DESCRIPTION description;
+	memset(&description, 0, sizeof(description));
+	strncpy(description.name, "Epoch Capture", sizeof(description.name) - 1);
+	description.channels = 0;
+	description.read = &AudioCapture::readCallback;
+	description.userdata = this;
+
+	if(system->createDSP(&description, &this->dsp) != FMOD_OK)
+	{
+		this->dsp = nullptr;
+		return false;
+	}
+
+	this->system = system;
+
+	int rate = 0;
+	this->system->getSoftwareFormat(&rate, nullptr, nullptr, nullptr, nullptr, nullptr);
+	if(rate > 0)
+	{
+		this->sampleRate = rate;
+	}
+
+	unsigned int bufferLength = 0;
+	int numBuffers = 0;
+	this->system->getDSPBufferSize(&bufferLength, &numBuffers);
+	this->latencySamples = bufferLength * static_cast<unsigned int>(numBuffers);
+
+	// Line our clock up with the mixer so blocks carry real DSP clock stamps.
+	unsigned int hi = 0;
+	unsigned int lo = 0;
+	this->system->getDSPClock(&hi, &lo);
+	this->firstClock = (static_cast<uint64_t>(hi) << 32) | lo;
+
+	BlockStamp& stamp = this->stamps[0];
+	stamp.clock = this->firstClock;
+	stamp.seconds = this->timer.getSeconds();
+	this->stampIndex.store(0);
+	this->writeClock.store(this->firstClock);
+
+	this->system->addDSP(this->dsp, nullptr);
+	return true;
+}
+
+void AudioCapture::detach()
+{
+	if(this->dsp != nullptr)
+	{
+		this->dsp->remove();
+		this->dsp->release();
+		this->dsp = nullptr;
+	}
+
+	this->system = nullptr;
+}
+
+bool AudioCapture::isAttached() const
+{
+	return this->dsp != nullptr;
+}
+
+double AudioCapture::getSeconds() const
+{
+	return this->timer.getSeconds();
+}
+
+int AudioCapture::getSampleRate() const
+{
+	return this->sampleRate;
+}
+
+unsigned int AudioCapture::getLatencySamples() const
+{
+	return this->latencySamples;
+}
+
+uint64_t AudioCapture::getWriteClock() const
+{
+	return this->writeClock.load(std::memory_order_acquire);
+}
+
+uint64_t AudioCapture::getAudibleClockAt(double seconds) const
+{
+	const BlockStamp& stamp = this->stamps[this->stampIndex.load(std::memory_order_acquire) % StampCount];
+
+	// The mixer runs at the sample rate between block stamps.
+	auto mixed = static_cast<double>(stamp.clock) + (seconds - stamp.seconds) * static_cast<double>(this->sampleRate);
+	auto audible = mixed - static_cast<double>(this->latencySamples);
+
+	if(audible < static_cast<double>(this->firstClock))
+	{
+		return this->firstClock;
+	}
+
+	return static_cast<uint64_t>(audible);
+}
+
+double AudioCapture::getAudibleTime(uint64_t clock) const
+{
+	const BlockStamp& stamp = this->stamps[this->stampIndex.load(std::memory_order_acquire) % StampCount];
+
+	auto samples = static_cast<double>(clock) + static_cast<double>(this->latencySamples) - static_cast<double>(stamp.clock);
+	return stamp.seconds + samples / static_cast<double>(this->sampleRate);
+}
+
+uint64_t AudioCapture::getWindow(uint64_t endClock, size_t count, int channel, float* out) const
+{
+	auto newest = this->getWriteClock();
+
+	// Leave a block of slack so the mixer can't overwrite what we are reading.
+	const uint64_t slack = 8192;
+	auto oldest = this->firstClock;
+	if(newest - oldest > CapacityFrames - slack)
+	{
+		oldest = newest - (CapacityFrames - slack);
+	}
+
+	endClock = std::min(endClock, newest);
+	endClock = std::max(endClock, std::min(newest, oldest + count));
+
+	channel = std::min(std::max(channel, 0), 1);
+
+	for(size_t i = 0; i < count; i++)
+	{
+		auto clock = endClock + i - count;
+
+		if(endClock + i < count || clock < oldest)
+		{
+			out[i] = 0.0f;
+		}
+		else
+		{
+			out[i] = this->ring[(clock & (CapacityFrames - 1)) * 2 + channel];
+		}
+	}
+
+	return endClock;
+}
+
+void AudioCapture::write(const float* in, unsigned int length, int channels)
+{
+	auto clock = this->writeClock.load(std::memory_order_relaxed);
+
+	for(unsigned int i = 0; i < length; i++)
+	{
+		auto frame = ((clock + i) & (CapacityFrames - 1)) * 2;
+		auto left = in[i * channels];
+		auto right = channels > 1 ? in[i * channels + 1] : left;
+		this->ring[frame] = left;
+		this->ring[frame + 1] = right;
+	}
+
+	auto index = this->stampIndex.load(std::memory_order_relaxed) + 1;
+	BlockStamp& stamp = this->stamps[index % StampCount];
+	stamp.clock = clock;
+	stamp.seconds = this->timer.getSeconds();
+	this->stampIndex.store(index, std::memory_order_release);
+
+	this->writeClock.store(clock + length, std::memory_order_release);
+}
+
+FMOD_RESULT F_CALLBACK AudioCapture::readCallback(FMOD_DSP_STATE* state, float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int outchannels)
+{
+	// Pass the mix through untouched.
+	memcpy(outbuffer, inbuffer, sizeof(float) * length * outchannels);
+
+	auto dsp = reinterpret_cast<FMOD::DSP*>(state->instance);
+	void* userData = nullptr;
+	dsp->getUserData(&userData);
+
+	auto capture = static_cast<AudioCapture*>(userData);
+	if(capture != nullptr && inchannels > 0)
+	{
+		capture->write(inbuffer, length, inchannels);
+	}
+
+	return FMOD_OK;
+}
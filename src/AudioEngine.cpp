@@ -0,0 +1,630 @@
+#include "AudioEngine.h"
+
+#include <algorithm>
+
+AudioEngine::Track::Track() :
+	sound(nullptr),
+	channel(nullptr),
+	startClock(0),
+	loop(false),
+	requestTime(0),
+	openSeconds(-1),
+	firstAudioSeconds(-1),
+	memoryBytes(0)
+{
+}
+
+AudioEngine::AudioEngine() :
+	system(nullptr),
+	channelGroup(nullptr),
+	useMappedFileIo(true),
+	readahead(1024 * 1024),
+	seekTableCache(nullptr),
+	starvingCount(0),
+	diskBusyCount(0),
+	timer(true),
+	output(FMOD_OUTPUTTYPE_AUTODETECT),
+	loadMode(LoadMode_Stream),
+	streamBufferSize(64 * 1024),
+	blockLength(1024),
+	outputRate(44100),
+	currentEnded(false),
+	paused(false)
+{
+}
+
+AudioEngine::~AudioEngine()
+{
+	this->shutdown();
+}
+
+bool AudioEngine::init(unsigned int dspBufferLength, int dspBufferCount)
+{
+	if(this->system != nullptr)
+	{
+		return true;
+	}
+
+	if(FMOD::System_Create(&this->system) != FMOD_OK)
+	{
+		this->system = nullptr;
+		return false;
+	}
+
+	this->system->setOutput(this->output);
+
+	if(dspBufferLength > 0 && dspBufferCount > 0)
+	{
+		this->system->setDSPBufferSize(dspBufferLength, dspBufferCount);
+	}
+
+	this->system->setStreamBufferSize(this->streamBufferSize, FMOD_TIMEUNIT_RAWBYTES);
+
+	// The current track and the one scheduled behind it both need a channel.
+	// Without a real time device, streams have to be fed from update() or they skip.
+	FMOD_INITFLAGS flags = FMOD_INIT_NORMAL | FMOD_INIT_ENABLE_PROFILE;
+
+	if(this->output == FMOD_OUTPUTTYPE_NOSOUND_NRT || this->output == FMOD_OUTPUTTYPE_WAVWRITER_NRT)
+	{
+		flags |= FMOD_INIT_STREAM_FROM_UPDATE;
+	}
+
+	this->system->init(8, flags, nullptr);
+	this->system->createChannelGroup(nullptr, &this->channelGroup);
+
+	if(this->useMappedFileIo == true)
+	{
+		this->useMappedFileIo = this->fileSystem.install(this->system, this->readahead);
+	}
+
+	int numBuffers = 0;
+	this->system->getDSPBufferSize(&this->blockLength, &numBuffers);
+	this->system->getSoftwareFormat(&this->outputRate, nullptr, nullptr, nullptr, nullptr, nullptr);
+
+	return true;
+}
+
+void AudioEngine::shutdown()
+{
+	if(this->system == nullptr)
+	{
+		return;
+	}
+
+	this->retire(this->current);
+	this->retire(this->next);
+	this->current = Track();
+	this->next = Track();
+	this->releaseRetired(true);
+	this->fileSystem.uninstall();
+
+	if(this->channelGroup != nullptr)
+	{
+		this->channelGroup->release();
+		this->channelGroup = nullptr;
+	}
+
+	this->system->close();
+	this->system->release();
+	this->system = nullptr;
+}
+
+void AudioEngine::setLoadMode(LoadMode mode)
+{
+	this->loadMode = mode;
+}
+
+AudioEngine::LoadMode AudioEngine::getLoadMode() const
+{
+	return this->loadMode;
+}
+
+const char* AudioEngine::getLoadModeName(LoadMode mode)
+{
+	switch(mode)
+	{
+		case LoadMode_Sample:
+			return "sample";
+		case LoadMode_Stream:
+			return "stream";
+		case LoadMode_CompressedSample:
+			return "compressed";
+		default:
+			return "unknown";
+	}
+}
+
+void AudioEngine::setOutput(FMOD_OUTPUTTYPE output)
+{
+	this->output = output;
+}
+
+void AudioEngine::setStreamBufferSize(unsigned int bytes)
+{
+	this->streamBufferSize = std::max(bytes, 2048u);
+}
+
+void AudioEngine::setMappedFileIo(bool enabled, uint32_t readahead)
+{
+	this->useMappedFileIo = enabled;
+	this->readahead = readahead;
+}
+
+void AudioEngine::setSeekTableCache(SeekTableCache* cache)
+{
+	this->seekTableCache = cache;
+}
+
+void AudioEngine::play(const std::string& fileName, bool loop)
+{
+	if(this->system == nullptr)
+	{
+		return;
+	}
+
+	this->retire(this->current);
+	this->currentEnded = false;
+
+	// Anything scheduled behind the old track has to be rescheduled.
+	this->unschedule(this->next);
+
+	if(this->next.sound != nullptr && this->next.fileName == fileName)
+	{
+		this->current = this->next;
+		this->current.loop = loop;
+		this->next = Track();
+	}
+	else
+	{
+		// The exact length only matters once the next track is scheduled, and the
+		// seek table is usually built by then, so don't hold up playback scanning.
+		this->current = Track();
+		this->open(this->current, fileName, loop, false);
+	}
+
+	this->current.requestTime = this->timer.getSeconds();
+}
+
+void AudioEngine::prefetch(const std::string& fileName)
+{
+	if(this->system == nullptr || this->next.fileName == fileName)
+	{
+		return;
+	}
+
+	this->retire(this->next);
+	this->next = Track();
+	this->open(this->next, fileName, false, true);
+}
+
+bool AudioEngine::update()
+{
+	if(this->system == nullptr)
+	{
+		return false;
+	}
+
+	// Channel callbacks fire from in here.
+	this->system->update();
+
+	auto changed = false;
+
+	if(this->currentEnded == true)
+	{
+		this->currentEnded = false;
+		this->retire(this->current);
+
+		if(this->next.sound != nullptr)
+		{
+			// Usually already playing: it was scheduled on the clock the old track ended.
+			this->current = this->next;
+			this->next = Track();
+			changed = true;
+		}
+		else
+		{
+			this->current = Track();
+		}
+	}
+
+	FMOD_OPENSTATE state;
+
+	if(this->current.sound != nullptr && this->current.channel != nullptr)
+	{
+		auto starving = false;
+		auto diskBusy = false;
+		this->current.sound->getOpenState(&state, nullptr, &starving, &diskBusy);
+
+		this->starvingCount += (starving == true) ? 1 : 0;
+		this->diskBusyCount += (diskBusy == true) ? 1 : 0;
+	}
+
+	if(this->current.sound != nullptr && this->current.channel == nullptr)
+	{
+		this->current.sound->getOpenState(&state, nullptr, nullptr, nullptr);
+
+		if(state == FMOD_OPENSTATE_READY)
+		{
+			this->measure(this->current);
+
+			if(this->start(this->current, this->getClock() + this->blockLength) == true)
+			{
+				auto wait = this->timer.getSeconds() - this->current.requestTime;
+				this->current.firstAudioSeconds = wait + static_cast<double>(this->blockLength) / this->outputRate;
+			}
+			else
+			{
+				this->retire(this->current);
+			}
+		}
+		else if(state == FMOD_OPENSTATE_ERROR)
+		{
+			this->retire(this->current);
+		}
+	}
+
+	if(this->next.sound != nullptr && this->next.channel == nullptr)
+	{
+		this->next.sound->getOpenState(&state, nullptr, nullptr, nullptr);
+
+		if(state == FMOD_OPENSTATE_ERROR)
+		{
+			// Keep the file name so the same broken file isn't reopened every frame.
+			this->retire(this->next);
+		}
+		else if(state == FMOD_OPENSTATE_READY && this->current.channel != nullptr && this->current.loop == false && this->paused == false)
+		{
+			this->measure(this->next);
+			this->findSeekTable(this->current);
+
+			// If it opened too late for a seamless join, start it as soon as possible instead.
+			auto endClock = this->getEndClock(this->current);
+			auto clock = std::max(endClock, this->getClock() + this->blockLength);
+
+			if(this->start(this->next, clock) == true)
+			{
+				// Stop the current track at its last programme sample, before LAME's padding.
+				this->current.channel->setDelay(FMOD_DELAYTYPE_DSPCLOCK_END, static_cast<unsigned int>(endClock >> 32), static_cast<unsigned int>(endClock));
+
+				// Any gap between the two tracks counts as waiting for audio.
+				this->next.firstAudioSeconds = static_cast<double>(clock - endClock) / this->outputRate;
+			}
+			else
+			{
+				this->retire(this->next);
+			}
+		}
+	}
+
+	this->releaseRetired(false);
+	return changed;
+}
+
+void AudioEngine::setPaused(bool paused)
+{
+	if(this->channelGroup == nullptr || paused == this->paused)
+	{
+		return;
+	}
+
+	this->paused = paused;
+
+	if(paused == true)
+	{
+		// Its start clock would pass while paused; update() re-arms both after the resume.
+		this->unschedule(this->next);
+
+		if(this->current.channel != nullptr)
+		{
+			this->current.channel->setDelay(FMOD_DELAYTYPE_DSPCLOCK_END, 0, 0);
+		}
+
+		this->channelGroup->setPaused(true);
+	}
+	else
+	{
+		this->rebase(this->current);
+		this->channelGroup->setPaused(false);
+	}
+}
+
+bool AudioEngine::isPaused() const
+{
+	return this->paused;
+}
+
+bool AudioEngine::isIdle() const
+{
+	return this->current.sound == nullptr;
+}
+
+FMOD::System* AudioEngine::getSystem() const
+{
+	return this->system;
+}
+
+FMOD::ChannelGroup* AudioEngine::getChannelGroup() const
+{
+	return this->channelGroup;
+}
+
+FMOD::Channel* AudioEngine::getChannel() const
+{
+	return this->current.channel;
+}
+
+const std::string& AudioEngine::getFileName() const
+{
+	return this->current.fileName;
+}
+
+const std::string& AudioEngine::getPrefetchFileName() const
+{
+	return this->next.fileName;
+}
+
+double AudioEngine::getFirstAudioSeconds() const
+{
+	return this->current.firstAudioSeconds;
+}
+
+double AudioEngine::getOpenSeconds() const
+{
+	return this->current.openSeconds;
+}
+
+unsigned int AudioEngine::getTrackMemory() const
+{
+	return this->current.memoryBytes;
+}
+
+uint64_t AudioEngine::getStarvingCount() const
+{
+	return this->starvingCount;
+}
+
+uint64_t AudioEngine::getDiskBusyCount() const
+{
+	return this->diskBusyCount;
+}
+
+const MappedFileSystem& AudioEngine::getFileSystem() const
+{
+	return this->fileSystem;
+}
+
+bool AudioEngine::isMappedFileIo() const
+{
+	return this->useMappedFileIo;
+}
+
+bool AudioEngine::open(Track& track, const std::string& fileName, bool loop, bool exactLength)
+{
+	track.fileName = fileName;
+	track.loop = loop;
+	track.requestTime = this->timer.getSeconds();
+	this->findSeekTable(track);
+
+	FMOD_MODE mode = FMOD_SOFTWARE | FMOD_NONBLOCKING;
+
+	// ACCURATETIME scans VBR files for an exact length, which the gapless join depends
+	// on. A seek table already has it, without reading the whole file at open.
+	if(exactLength == true && track.seekTable == nullptr)
+	{
+		mode |= FMOD_ACCURATETIME;
+	}
+
+	if(this->loadMode == LoadMode_Stream)
+	{
+		mode |= FMOD_CREATESTREAM;
+	}
+	else if(this->loadMode == LoadMode_CompressedSample)
+	{
+		mode |= FMOD_CREATECOMPRESSEDSAMPLE;
+	}
+	else
+	{
+		mode |= FMOD_CREATESAMPLE;
+	}
+
+	if(this->system->createSound(fileName.c_str(), mode, nullptr, &track.sound) != FMOD_OK)
+	{
+		track.sound = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+bool AudioEngine::start(Track& track, uint64_t clock)
+{
+	track.sound->setMode(track.loop == true ? FMOD_LOOP_NORMAL : FMOD_LOOP_OFF);
+
+	if(this->system->playSound(FMOD_CHANNEL_FREE, track.sound, true, &track.channel) != FMOD_OK)
+	{
+		track.channel = nullptr;
+		return false;
+	}
+
+	// Skip LAME's encoder and decoder delay, which would otherwise play as a gap.
+	uint64_t leading = 0;
+
+	if(track.seekTable != nullptr && track.loop == false)
+	{
+		leading = track.seekTable->getLeadingSamples();
+		track.channel->setPosition(static_cast<unsigned int>(leading), FMOD_TIMEUNIT_PCM);
+	}
+
+	track.channel->setChannelGroup(this->channelGroup);
+	track.channel->setDelay(FMOD_DELAYTYPE_DSPCLOCK_START, static_cast<unsigned int>(clock >> 32), static_cast<unsigned int>(clock));
+	track.channel->setUserData(this);
+	track.channel->setCallback(&AudioEngine::channelCallback);
+	track.channel->setPaused(false);
+
+	// The clock the first decoded sample would have played at.
+	auto skipped = this->toOutputSamples(track, leading);
+	track.startClock = (clock > skipped) ? clock - skipped : 0;
+
+	return true;
+}
+
+void AudioEngine::unschedule(Track& track)
+{
+	// The sound stays open, so it can be started again without reopening.
+	if(track.channel != nullptr)
+	{
+		track.channel->setCallback(nullptr);
+		track.channel->stop();
+		track.channel = nullptr;
+	}
+}
+
+void AudioEngine::rebase(Track& track)
+{
+	unsigned int position = 0;
+
+	if(track.channel == nullptr || track.sound == nullptr || track.channel->getPosition(&position, FMOD_TIMEUNIT_PCM) != FMOD_OK)
+	{
+		return;
+	}
+
+	// The resume takes effect at the next mix block; the track started as long
+	// before that as it has already played.
+	auto played = this->toOutputSamples(track, position);
+	auto resume = this->getClock() + this->blockLength;
+	track.startClock = (resume > played) ? resume - played : 0;
+}
+
+void AudioEngine::measure(Track& track)
+{
+	if(track.openSeconds < 0)
+	{
+		track.openSeconds = this->timer.getSeconds() - track.requestTime;
+	}
+
+	// Sample data for decoded and compressed samples, file and decode buffers for streams.
+	track.memoryBytes = 0;
+	track.sound->getMemoryInfo(FMOD_MEMBITS_ALL, FMOD_EVENT_MEMBITS_ALL, &track.memoryBytes, nullptr);
+}
+
+void AudioEngine::retire(Track& track)
+{
+	if(track.channel != nullptr)
+	{
+		track.channel->setCallback(nullptr);
+		track.channel->stop();
+		track.channel = nullptr;
+	}
+
+	if(track.sound != nullptr)
+	{
+		this->retired.push_back(track.sound);
+		track.sound = nullptr;
+	}
+}
+
+void AudioEngine::releaseRetired(bool wait)
+{
+	auto it = std::remove_if(std::begin(this->retired), std::end(this->retired),
+		[wait](FMOD::Sound* sound)
+		{
+			FMOD_OPENSTATE state = FMOD_OPENSTATE_READY;
+			sound->getOpenState(&state, nullptr, nullptr, nullptr);
+
+			if(wait == true || state == FMOD_OPENSTATE_READY || state == FMOD_OPENSTATE_ERROR)
+			{
+				sound->release();
+				return true;
+			}
+
+			return false;
+		});
+
+	this->retired.erase(it, std::end(this->retired));
+}
+
+void AudioEngine::findSeekTable(Track& track)
+{
+	// Queues the file for indexing if its table isn't ready yet.
+	if(track.seekTable == nullptr && this->seekTableCache != nullptr)
+	{
+		track.seekTable = this->seekTableCache->get(track.fileName);
+	}
+}
+
+uint64_t AudioEngine::getClock() const
+{
+	unsigned int hi = 0;
+	unsigned int lo = 0;
+	this->system->getDSPClock(&hi, &lo);
+	return (static_cast<uint64_t>(hi) << 32) | lo;
+}
+
+uint64_t AudioEngine::getEndClock(const Track& track) const
+{
+	uint64_t length = 0;
+	auto frequency = 0.0f;
+	this->getLength(track, length, frequency);
+
+	if(track.seekTable != nullptr)
+	{
+		// Up to the last sample of programme; the same as the decoded length without a LAME tag.
+		length = track.seekTable->getLeadingSamples() + track.seekTable->getGaplessSampleCount();
+	}
+
+	return track.startClock + this->toOutputSamples(track, length);
+}
+
+uint64_t AudioEngine::toOutputSamples(const Track& track, uint64_t samples) const
+{
+	uint64_t length = 0;
+	auto frequency = 0.0f;
+	this->getLength(track, length, frequency);
+
+	// The mixer resamples every sound to the output rate.
+	return static_cast<uint64_t>(static_cast<double>(samples) * this->outputRate / frequency + 0.5);
+}
+
+void AudioEngine::getLength(const Track& track, uint64_t& length, float& frequency) const
+{
+	length = 0;
+	frequency = 0.0f;
+
+	if(track.seekTable != nullptr)
+	{
+		// Every frame as decoded, encoder delay and padding included, which is what FMOD plays.
+		length = track.seekTable->getSampleCount();
+		frequency = static_cast<float>(track.seekTable->getHeader().sampleRate);
+	}
+	else
+	{
+		unsigned int pcm = 0;
+		track.sound->getLength(&pcm, FMOD_TIMEUNIT_PCM);
+		track.sound->getDefaults(&frequency, nullptr, nullptr, nullptr);
+		length = pcm;
+	}
+
+	if(frequency <= 0)
+	{
+		frequency = static_cast<float>(this->outputRate);
+	}
+}
+
+FMOD_RESULT F_CALLBACK AudioEngine::channelCallback(FMOD_CHANNEL* channel, FMOD_CHANNEL_CALLBACKTYPE type, void* commandData1, void* commandData2)
+{
+	if(type == FMOD_CHANNEL_CALLBACKTYPE_END)
+	{
+		auto fmodChannel = reinterpret_cast<FMOD::Channel*>(channel);
+		void* userData = nullptr;
+		fmodChannel->getUserData(&userData);
+
+		auto engine = static_cast<AudioEngine*>(userData);
+
+		if(engine != nullptr && engine->current.channel == fmodChannel)
+		{
+			engine->currentEnded = true;
+		}
+	}
+
+	return FMOD_OK;
+}
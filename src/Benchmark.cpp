@@ -0,0 +1,205 @@
+#include "Benchmark.h"
+#include "FmodMemory.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+	#include <windows.h>
+	#include <psapi.h>
+	#pragma comment(lib, "psapi.lib")
+#else
+	#include <sys/resource.h>
+#endif
+
+namespace
+{
+	std::string escape(const std::string& value)
+	{
+		std::string escaped;
+
+		std::for_each(std::begin(value), std::end(value),
+			[&escaped](char c)
+			{
+				if(c == '"' || c == '\\')
+				{
+					escaped += '\\';
+				}
+
+				escaped += c;
+			});
+
+		return escaped;
+	}
+
+	void writeDistribution(std::ostream& os, const Distribution& d)
+	{
+		os << "{\"mean\": " << d.mean << ", \"min\": " << d.min << ", \"max\": " << d.max 
+			<< ", \"p50\": " << d.p50 << ", \"p95\": " << d.p95 << ", \"p99\": " << d.p99 << "}";
+	}
+}
+
+BenchmarkSettings::BenchmarkSettings() :
+	source("sine"),
+	domain("time"),
+	render("gl"),
+	frames(2000),
+	warmupFrames(120),
+	waveSampleSize(1024),
+	sampleSize(1024),
+	maxAge(32),
+	entropy(0)
+{
+}
+
+Benchmark::Benchmark() :
+	timer(true),
+	running(false),
+	frame(0),
+	frameStart(0),
+	measureStart(0),
+	measureSeconds(0),
+	particleFrames(0),
+	emitted(0),
+	peakParticles(0)
+{
+}
+
+void Benchmark::start(const BenchmarkSettings& settings)
+{
+	this->settings = settings;
+	this->running = true;
+	this->frame = 0;
+	this->measureSeconds = 0;
+	this->frameTimes.clear();
+	this->frameTimes.reserve(static_cast<size_t>(std::max(settings.frames, 0)));
+	this->particleFrames = 0;
+	this->emitted = 0;
+	this->peakParticles = 0;
+}
+
+bool Benchmark::isRunning() const
+{
+	return this->running;
+}
+
+bool Benchmark::isComplete() const
+{
+	return this->running == true && this->frame >= this->settings.warmupFrames + this->settings.frames;
+}
+
+void Benchmark::beginFrame()
+{
+	this->frameStart = this->timer.getSeconds();
+
+	if(this->frame == this->settings.warmupFrames)
+	{
+		this->measureStart = this->frameStart;
+	}
+}
+
+void Benchmark::endFrame(size_t particleCount, size_t emitted)
+{
+	auto now = this->timer.getSeconds();
+
+	// The warmup fills the particle field and the audio buffers before anything counts.
+	if(this->frame >= this->settings.warmupFrames)
+	{
+		this->frameTimes.push_back((now - this->frameStart) * 1000.0);
+		this->particleFrames += particleCount;
+		this->emitted += emitted;
+		this->peakParticles = std::max(this->peakParticles, particleCount);
+		this->measureSeconds = now - this->measureStart;
+	}
+
+	this->frame++;
+}
+
+const BenchmarkSettings& Benchmark::getSettings() const
+{
+	return this->settings;
+}
+
+std::string Benchmark::toJson(const FrameProfiler& profiler) const
+{
+	std::ostringstream os;
+	auto frameTime = Statistics::summarize(this->frameTimes);
+	auto seconds = std::max(this->measureSeconds, 1e-9);
+
+	int fmodCurrent = 0;
+	int fmodPeak = 0;
+	FmodMemory::getStats(fmodCurrent, fmodPeak);
+
+	os << "{\n";
+	os << "  \"settings\": {\"source\": \"" << escape(this->settings.source) << "\", \"domain\": \"" << this->settings.domain 
+		<< "\", \"render\": \"" << this->settings.render << "\", \"frames\": " << this->settings.frames 
+		<< ", \"warmup_frames\": " << this->settings.warmupFrames << ", \"wave_sample_size\": " << this->settings.waveSampleSize 
+		<< ", \"sample_size\": " << this->settings.sampleSize << ", \"max_age\": " << this->settings.maxAge 
+		<< ", \"entropy\": " << this->settings.entropy << "},\n";
+	os << "  \"seconds\": " << this->measureSeconds << ",\n";
+	os << "  \"fps\": " << this->frameTimes.size() / seconds << ",\n";
+	os << "  \"frame_ms\": ";
+	writeDistribution(os, frameTime);
+	os << ",\n";
+
+	// Particles simulated per second is the sum of live particles over every frame.
+	os << "  \"particles_per_second\": " << this->particleFrames / seconds << ",\n";
+	os << "  \"emitted_per_second\": " << this->emitted / seconds << ",\n";
+	os << "  \"peak_particles\": " << this->peakParticles << ",\n";
+	os << "  \"peak_memory_bytes\": " << Benchmark::getPeakMemory() << ",\n";
+	os << "  \"fmod_peak_memory_bytes\": " << fmodPeak << ",\n";
+	os << "  \"phases_ms\": {";
+
+	auto frames = profiler.getFrames(std::min(this->frameTimes.size(), FrameProfiler::Capacity));
+
+	for(int i = 0; i < FrameProfiler::Phase_End; i++)
+	{
+		auto phase = static_cast<FrameProfiler::Phase>(i);
+		os << (i > 0 ? "," : "") << "\n    \"" << FrameProfiler::getPhaseName(phase) << "\": ";
+		writeDistribution(os, FrameProfiler::summarize(frames, phase));
+	}
+
+	os << "\n  }\n";
+	os << "}\n";
+
+	return os.str();
+}
+
+bool Benchmark::writeJson(const std::string& fileName, const FrameProfiler& profiler) const
+{
+	std::ofstream os;
+	os.open(fileName.c_str());
+
+	if(os.is_open() == false)
+	{
+		return false;
+	}
+
+	os << this->toJson(profiler);
+	return os.good();
+}
+
+uint64_t Benchmark::getPeakMemory()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == FALSE)
+	{
+		return 0;
+	}
+
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+
+	if(getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+
+	// Kilobytes on Linux.
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
@@ -0,0 +1,262 @@
+#include "DirectoryScanner.h"
+
+#include "cinder/Filesystem.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+	#include <windows.h>
+#endif
+
+namespace
+{
+	// Junctions and mount points aren't always reported as symlinks, and one pointing at
+	// a parent would have the scan recurse forever.
+	bool isReparsePoint(const std::string& path)
+	{
+#if defined(_WIN32)
+		auto attributes = GetFileAttributesA(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+#else
+		return false;
+#endif
+	}
+}
+
+DirectoryScanner::DirectoryScanner() :
+	generation(0),
+	active(0),
+	fileCount(0),
+	directoryCount(0),
+	elapsed(0),
+	running(false)
+{
+}
+
+DirectoryScanner::~DirectoryScanner()
+{
+	this->stop();
+}
+
+void DirectoryScanner::start(size_t threadCount)
+{
+	this->stop();
+
+	this->running = true;
+
+	for(size_t i = 0; i < std::max(threadCount, size_t(1)); i++)
+	{
+		this->threads.push_back(std::thread(&DirectoryScanner::run, this));
+	}
+}
+
+void DirectoryScanner::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->running = false;
+		this->queue.clear();
+	}
+
+	this->condition.notify_all();
+
+	std::for_each(std::begin(this->threads), std::end(this->threads), 
+		[](std::thread& thread)
+		{
+			thread.join();
+		});
+
+	this->threads.clear();
+}
+
+void DirectoryScanner::addExtension(const std::string& extension)
+{
+	auto lower = extension;
+	std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->extensions.insert(lower);
+}
+
+void DirectoryScanner::scan(const std::vector<std::string>& directories)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if(this->queue.empty() == true && this->active == 0)
+		{
+			this->fileCount = 0;
+			this->directoryCount = 0;
+			this->elapsed = 0;
+			this->timer.start();
+		}
+
+		this->queue.insert(std::end(this->queue), std::begin(directories), std::end(directories));
+	}
+
+	this->condition.notify_all();
+}
+
+void DirectoryScanner::cancel()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->generation++;
+	this->queue.clear();
+	this->found.clear();
+	this->fileCount = 0;
+	this->directoryCount = 0;
+	this->elapsed = 0;
+	this->timer.start();
+}
+
+bool DirectoryScanner::poll(std::vector<std::string>& fileNames)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if(this->found.empty() == true)
+	{
+		return false;
+	}
+
+	fileNames.insert(std::end(fileNames), std::begin(this->found), std::end(this->found));
+	this->found.clear();
+	return true;
+}
+
+bool DirectoryScanner::isScanning() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->queue.empty() == false || this->active > 0;
+}
+
+size_t DirectoryScanner::getFileCount() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->fileCount;
+}
+
+size_t DirectoryScanner::getDirectoryCount() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->directoryCount;
+}
+
+double DirectoryScanner::getSeconds() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return (this->queue.empty() == false || this->active > 0) ? this->timer.getSeconds() : this->elapsed;
+}
+
+double DirectoryScanner::getFilesPerSecond() const
+{
+	auto seconds = this->getSeconds();
+	return seconds > 0 ? this->getFileCount() / seconds : 0;
+}
+
+void DirectoryScanner::run()
+{
+	std::vector<std::string> files;
+	std::vector<std::string> directories;
+
+	while(true)
+	{
+		std::string directory;
+		unsigned int jobGeneration = 0;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			while(this->running == true && this->queue.empty() == true)
+			{
+				this->condition.wait(lock);
+			}
+
+			if(this->running == false)
+			{
+				break;
+			}
+
+			directory = this->queue.front();
+			this->queue.pop_front();
+			jobGeneration = this->generation;
+			this->active++;
+		}
+
+		files.clear();
+		directories.clear();
+		this->list(directory, files, directories);
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->active--;
+
+			if(jobGeneration == this->generation)
+			{
+				this->directoryCount++;
+				this->fileCount += files.size();
+				this->found.insert(std::end(this->found), std::begin(files), std::end(files));
+				this->queue.insert(std::end(this->queue), std::begin(directories), std::end(directories));
+
+				if(this->queue.empty() == true && this->active == 0)
+				{
+					this->elapsed = this->timer.getSeconds();
+					this->timer.stop();
+				}
+			}
+		}
+
+		if(directories.empty() == false)
+		{
+			this->condition.notify_all();
+		}
+	}
+}
+
+void DirectoryScanner::list(const std::string& directory, std::vector<std::string>& files, std::vector<std::string>& directories) const
+{
+	try
+	{
+		for(ci::fs::directory_iterator i(directory), end; i != end; ++i)
+		{
+			// The entry's status comes with the listing on Windows, so this doesn't stat each file.
+			// Links aren't followed into directories, so a link to a parent can't make a cycle.
+			auto status = i->symlink_status();
+
+			if(ci::fs::is_symlink(status) == true)
+			{
+				status = i->status();
+
+				if(ci::fs::is_directory(status) == true)
+				{
+					continue;
+				}
+			}
+
+			if(ci::fs::is_directory(status) == true)
+			{
+				if(isReparsePoint(i->path().string()) == false)
+				{
+					directories.push_back(i->path().string());
+				}
+			}
+			else
+			{
+				auto extension = i->path().extension().string();
+				std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+				// Only written before scanning starts, so no lock is needed here.
+				if(this->extensions.count(extension) > 0)
+				{
+					files.push_back(i->path().string());
+				}
+			}
+		}
+	}
+	catch(...)
+	{
+		// Unreadable directories are skipped; whatever was listed before the error is kept.
+	}
+
+	std::sort(std::begin(files), std::end(files));
+	std::sort(std::begin(directories), std::end(directories));
+}
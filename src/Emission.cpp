@@ -0,0 +1,71 @@
+#include "Emission.h"
+
+#include <algorithm>
+#include <cmath>
+
+size_t Emission::decimate(const std::vector<float>& values, float scale, float width, size_t columns, float threshold, EmissionPoint* points)
+{
+	auto count = values.size();
+	size_t written = 0;
+
+	if(count == 0)
+	{
+		return written;
+	}
+
+	columns = std::min(std::max(columns, static_cast<size_t>(1)), count);
+
+	auto spacing = width / static_cast<float>(count);
+
+	auto emit = [&](size_t i)
+	{
+		auto value = values[i] * scale;
+
+		if(fabs(value) >= threshold)
+		{
+			EmissionPoint point = {spacing * i, value, static_cast<uint32_t>(i)};
+			points[written++] = point;
+		}
+	};
+
+	for(size_t column = 0; column < columns; column++)
+	{
+		auto begin = static_cast<size_t>(static_cast<uint64_t>(column) * count / columns);
+		auto end = static_cast<size_t>(static_cast<uint64_t>(column + 1) * count / columns);
+
+		if(end - begin == 1)
+		{
+			emit(begin);
+			continue;
+		}
+
+		auto low = begin;
+		auto high = begin;
+
+		for(auto i = begin + 1; i < end; i++)
+		{
+			if(values[i] < values[low])
+			{
+				low = i;
+			}
+
+			if(values[i] > values[high])
+			{
+				high = i;
+			}
+		}
+
+		if(values[low] < 0 && values[high] > 0)
+		{
+			// Both excursions are visible, so keep both, in order.
+			emit(std::min(low, high));
+			emit(std::max(low, high));
+		}
+		else
+		{
+			emit(fabs(values[low]) > fabs(values[high]) ? low : high);
+		}
+	}
+
+	return written;
+}
@@ -5,22 +5,42 @@
 #include "cinder/ImageIo.h"
 
 #include "FMOD.hpp"
+#include "AllocationCounter.h"
+#include "AudioAnalyzer.h"
+#include "AudioEngine.h"
+#include "Benchmark.h"
+#include "DirectoryScanner.h"
+#include "Emission.h"
+#include "FmodMemory.h"
+#include "FrameArena.h"
+#include "FrameProfiler.h"
+#include "IdleMonitor.h"
+#include "MemoryLedger.h"
+#include "MemoryMonitor.h"
+#include "MetadataCache.h"
+#include "MetricsServer.h"
+#include "Options.h"
 #include "Particle.h"
 #include "ParticleController.h"
-
-#define TAGLIB_STATIC 
-
-#include "tag.h"
-#include "fileref.h"
-#include "tpropertymap.h"
-#include <id3v2tag.h>
-#include <mpegfile.h>
-#include <attachedpictureframe.h>
+#include "Playlist.h"
+#include "QualityGovernor.h"
+#include "ReadaheadScheduler.h"
+#include "SeekTableCache.h"
+#include "SessionLog.h"
+#include "SignalGenerator.h"
+#include "SoakTest.h"
+#include "Statistics.h"
+#include "TrackAnalysisCache.h"
+#include "TrackMetadataLoader.h"
 
 #include <iostream>
 #include <vector>
 #include <list>
 #include <array>
+#include <cassert>
+#include <cstring>
+#include <ctime>
+#include <thread>
 
 #include <stdio.h>
 
@@ -28,6 +48,15 @@ using namespace ci;
 using namespace ci::app;
 using namespace std;
 
+namespace
+{
+	// Seconds between rebuilds of the help and profiler text.
+	const double OverlayInterval = 0.25;
+
+	// Returned from WinMain, so a script running the soak test sees the result.
+	int exitCode = 0;
+}
+
 class EpochVisualizer : public AppNative 
 {
 	public:
@@ -49,7 +78,43 @@ class EpochVisualizer : public AppNative
 			enableAlbumArt(false),
 			enableCredits(false),
 			enableClearScreen(true),
-			isShiftDown(false)
+			enableAvSync(true),
+			enableProfiler(false),
+			hasTrackAnalysis(false),
+			hasTrackStats(false),
+			wasScanning(false),
+			isShiftDown(false),
+			mixedDomainFlag(false),
+			displayLatency(1.0 / 60.0),
+			drawDuration(0),
+			latchTime(0),
+			latchClock(0),
+			latencyWriteClock(0),
+			latencyPending(false),
+			measureLatencyFrames(0),
+			emittedParticles(0),
+			useDecimation(true),
+			emissionFloor(0),
+			activeFrameRate(60.0f),
+			idleFrameRate(5.0f),
+			albumArtBytes(0),
+			helpBytes(0),
+			profileBytes(0),
+			creditBytes(0),
+			helpTime(0),
+			profileTime(0),
+			creditsChanged(true),
+			allocationWarmup(-1),
+			allocationFrames(0),
+			lastFrameAllocations(0),
+			metricsFrame(0),
+			signalSound(nullptr),
+			replaying(false),
+			replayFrame(0),
+			replayMismatches(0),
+			replayFirstMismatch(0),
+			viewWidth(0),
+			viewHeight(0)
 		{
 
 		}
@@ -65,6 +130,7 @@ class EpochVisualizer : public AppNative
 
 		void prepareSettings(Settings* settings);
 		void setup();
+		void shutdown();
 		void draw();
 		void update();
 		void keyDown(KeyEvent evt);
@@ -75,13 +141,31 @@ class EpochVisualizer : public AppNative
 		
 	protected:
 		void drawHelp();
-
-		std::array<float, 3> getValueColor(float x) const;
-		std::vector<float> getWaveData();
-		std::vector<float> getStereoWaveData();
-		std::vector<float> getSpectrumDataMirrorDB();
-
+		void drawProfiler();
+		void renderOverlay(TextLayout& layout, gl::Texture& texture, size_t& bytes);
+		void countAllocations();
+		void updateLayout();
+		void applyMetadata(const TrackMetadata& metadata);
+		void latchVisualization();
+		void updateIdle();
+		void updateMemory();
+		void updateMetrics();
+		void measureLatency();
+		void reportLatency();
+
+		void startBenchmark();
+		void updateBenchmark();
+
+		void startRecording();
+		void startReplay();
+		bool stepReplay();
+		void finishReplay();
+		SessionControls getControls() const;
+		void applyControls(const SessionControls& controls);
+
+		void createAudioSystem();
 		void soundComplete();
+		void trackChanged(const std::string& fileName);
 
 		void loadFile(const std::string& filename);
 		void loadFileMP3(const std::string& filename);
@@ -94,24 +178,69 @@ class EpochVisualizer : public AppNative
 		void previousTrack();
 
 	private:
-		std::vector<std::string> playList;
+		Options options;
+		Playlist playList;
 		ParticleController particles;
 
+		AudioEngine audio;
+		AudioAnalyzer analyzer;
+		TrackAnalysisCache trackAnalysisCache;
+		TrackMetadataLoader metadataLoader;
+		MetadataCache metadataCache;
+		DirectoryScanner directoryScanner;
+		ReadaheadScheduler readahead;
+		SeekTableCache seekTableCache;
+		std::vector<std::string> scannedFiles;
+		bool wasScanning;
+		std::string currentTrack;
+		SampleWindow analysisTimes;
+		SampleWindow renderTimes;
+		FrameProfiler profiler;
+		QualityGovernor governor;
+		IdleMonitor idle;
+		float activeFrameRate;
+		float idleFrameRate;
+		MemoryMonitor memory;
+		SoakTest soak;
+		size_t albumArtBytes;
+		gl::Fbo sceneFbo;
+
+		// Scratch for the frame's emission points and vertex arrays, rewound every frame.
+		FrameArena arena;
+		std::string prefetchName;
+
+		// Overlay text is only rendered to a texture when it changes, or a few times a second for the profiler.
+		gl::Texture helpTexture;
+		gl::Texture profileTexture;
+		gl::Texture creditTexture;
+		size_t helpBytes;
+		size_t profileBytes;
+		size_t creditBytes;
+		double helpTime;
+		double profileTime;
+		bool creditsChanged;
+
+		// Frames to skip before checking for heap allocations; negative when not checking.
+		int allocationWarmup;
+		uint64_t allocationFrames;
+		uint64_t lastFrameAllocations;
+
+		// Kept up to date on the UI thread and handed to the server once per frame.
+		MetricsServer metricsServer;
+		MetricsSnapshot metrics;
+		uint64_t metricsFrame;
+		std::vector<double> latencyCompensated;
+		std::vector<double> latencyUncompensated;
+
 		gl::Texture albumArt;
 		
 		gl::TextureFontRef fontTexture;
 		ci::Font font;
 
-		std::string debugMe;
 		std::string artist;
 		std::string album;
 		std::string title;
 
-		FMOD::System* fmodSystem;
-		FMOD::Sound* fmodSound;
-		FMOD::Channel* fmodChannel;
-		FMOD::ChannelGroup* fmodChannelGroup;
-
 		float velocityScale;
 		float fontSize;
 		float masterVolume;
@@ -140,8 +269,48 @@ class EpochVisualizer : public AppNative
 		bool enableAlbumArt;
 		bool enableCredits;
 		bool enableClearScreen;
+		bool enableAvSync;
+		bool enableProfiler;
+		bool hasTrackAnalysis;
+		bool hasTrackStats;
 		bool isShiftDown;
 		bool mixedDomainFlag;
+
+		// Seconds from the analysis latch until the frame is on screen.
+		double displayLatency;
+		double drawDuration;
+		double latchTime;
+		uint64_t latchClock;
+
+		// Set at the latch and resolved against FMOD's mix clock once the frame has been swapped.
+		uint64_t latencyWriteClock;
+		bool latencyPending;
+		int measureLatencyFrames;
+		size_t emittedParticles;
+
+		// Samples are reduced to what the view's pixel columns can show before emitting.
+		bool useDecimation;
+		float emissionFloor;
+
+		Benchmark benchmark;
+		SignalGenerator signal;
+		FMOD::Sound* signalSound;
+		gl::Fbo benchmarkFbo;
+		Surface8u benchmarkSurface;
+
+		SessionRecorder recorder;
+		SessionPlayer player;
+		SessionFrame sessionFrame;
+		SessionControls recordedControls;
+		AnalysisFrame replayAnalysis;
+		bool replaying;
+		uint32_t replayFrame;
+		uint32_t replayMismatches;
+		uint32_t replayFirstMismatch;
+
+		// Size emission and culling work to: the window's, or the recorded one when replaying.
+		int viewWidth;
+		int viewHeight;
 };
 
 void EpochVisualizer::prepareSettings(Settings* settings)
@@ -153,12 +322,221 @@ void EpochVisualizer::prepareSettings(Settings* settings)
 void EpochVisualizer::setup()
 {
 	this->setFpsSampleInterval(1.0f/30.0f);
-	
-	FMOD::System_Create(&this->fmodSystem);
-	this->fmodSystem->init(2, FMOD_INIT_NORMAL | FMOD_INIT_ENABLE_PROFILE, nullptr);
-	this->fmodSystem->createChannelGroup(nullptr, &this->fmodChannelGroup);
+	AllocationCounter::watchThisThread();
+
+	this->options.parse(this->getArgs());
+	this->enableAvSync = (this->options.has("no-av-sync") == false);
+	this->displayLatency = this->options.getFloat("display-latency-ms", 1000.0f / 60.0f) / 1000.0;
+
+	if(this->options.has("measure-latency") == true)
+	{
+		// Headless: no rendering, just latch analysis windows and record offsets.
+		this->measureLatencyFrames = std::max(this->options.getInt("measure-latency", 600), 1);
+		this->getWindow()->hide();
+	}
+
+	this->waveSampleSize = std::max(this->options.getInt("wave-size", this->waveSampleSize), 1);
+	this->useDecimation = (this->options.has("no-decimation") == false);
+	this->emissionFloor = this->options.has("skip-silent") == true ? std::max(this->options.getFloat("skip-silent", 0.1f), 0.0f) : 0.0f;
+	this->sampleSize = std::max(this->options.getInt("sample-size", this->sampleSize), 1);
+
+	{
+		auto domain = this->options.getString("domain", "time");
+		this->domain = (domain == "spectrum") ? Domain_FreqMirrorDB : ((domain == "mixed") ? Domain_Mixed : Domain_Time);
+	}
+
+	if(this->options.has("benchmark") == true)
+	{
+		BenchmarkSettings settings;
+		settings.frames = std::max(this->options.getInt("benchmark", settings.frames), 1);
+		settings.warmupFrames = std::max(this->options.getInt("benchmark-warmup", settings.warmupFrames), 0);
+		settings.source = this->options.getString("benchmark-source", this->options.positional.empty() == true ? settings.source : this->options.positional[0]);
+		settings.render = this->options.getString("benchmark-render", settings.render);
+		settings.domain = this->options.getString("domain", settings.domain);
+		settings.waveSampleSize = this->waveSampleSize;
+		settings.sampleSize = this->sampleSize;
+		settings.maxAge = static_cast<uint32_t>(std::max(this->options.getInt("max-age", settings.maxAge), 1));
+		settings.entropy = std::max(this->options.getFloat("entropy", settings.entropy), 0.0f);
+		this->benchmark.start(settings);
+
+		// Headless and uncapped; the mixer runs one block per frame with no device.
+		this->getWindow()->hide();
+		this->disableFrameRate();
+		this->audio.setOutput(FMOD_OUTPUTTYPE_NOSOUND_NRT);
+	}
+
+	{
+		auto replayFile = this->options.getString("replay", "");
+		auto source = this->benchmark.getSettings().source;
+
+		if(this->benchmark.isRunning() == true && source.size() > 4 && source.compare(source.size() - 4, 4, ".epr") == 0)
+		{
+			replayFile = source;
+		}
+
+		if(replayFile.empty() == false)
+		{
+			if(this->player.open(replayFile) == true)
+			{
+				// The log stands in for the audio, so no device is needed.
+				this->replaying = true;
+
+				if(this->benchmark.isRunning() == false)
+				{
+					this->audio.setOutput(FMOD_OUTPUTTYPE_NOSOUND);
+				}
+			}
+			else
+			{
+				console() << "Can't read session log " << replayFile << std::endl;
+			}
+		}
+	}
+
+	// Has to happen before any FMOD system exists, including the analysis cache's.
+	FmodMemory::initialize(static_cast<size_t>(std::max(this->options.getInt("fmod-pool-mb", 0), 0)) * 1024 * 1024);
+
+	this->createAudioSystem();
+
+	{
+		// Twice sampleSize gives the same bin layout as FMOD's getSpectrum.
+		auto window = this->options.getInt("stft-window", this->sampleSize * 2);
+		auto hop = this->options.getInt("stft-hop", window / 4);
+
+		if(this->options.has("stft-overlap") == true)
+		{
+			auto overlap = std::min(std::max(this->options.getFloat("stft-overlap", 0.75f), 0.0f), 0.95f);
+			hop = static_cast<int>(window * (1.0f - overlap));
+		}
+
+		this->analyzer.configureStft(std::max(window, 2), std::max(hop, 1), this->options.has("stft-latest") == false);
+	}
+
+	if(this->options.has("palette") == true)
+	{
+		this->analyzer.loadPalette(this->options.getString("palette", ""));
+	}
+
+	// A benchmark steps analysis once per frame itself.
+	if(this->benchmark.isRunning() == false && this->replaying == false)
+	{
+		this->analyzer.start(this->options.getFloat("analysis-rate", 120.0f));
+	}
+	this->metadataLoader.start();
+
+	auto threads = std::max(std::thread::hardware_concurrency(), 2u);
+
+	this->directoryScanner.addExtension(".mp3");
+	this->directoryScanner.start(static_cast<size_t>(this->options.getInt("scan-threads", static_cast<int>(threads))));
+
+	if(this->options.has("no-readahead") == false)
+	{
+		this->readahead.start(static_cast<uint64_t>(std::max(this->options.getInt("readahead-mb", 256), 0)) * 1024 * 1024);
+	}
+
+	if(this->options.has("no-seek-index") == false)
+	{
+		this->seekTableCache.start(this->options.getString("seek-index-dir", "epoch_cache"));
+	}
+
+	if(this->options.has("no-metadata-cache") == false)
+	{
+		this->metadataCache.start(
+			this->options.getString("metadata-cache-dir", "epoch_cache"),
+			static_cast<size_t>(this->options.getInt("metadata-threads", static_cast<int>(threads))),
+			this->options.getInt("metadata-art-size", 256));
+	}
+
+	if(this->options.has("no-analysis-cache") == false)
+	{
+		this->trackAnalysisCache.start(
+			this->options.getString("analysis-cache-dir", "epoch_cache"),
+			static_cast<uint64_t>(this->options.getInt("analysis-cache-mb", 2048)) * 1024 * 1024,
+			this->sampleSize * 2,
+			this->options.getInt("analysis-cache-hop", 1024));
+	}
+
+	this->particles.maxAge = static_cast<uint32_t>(std::max(this->options.getInt("max-age", 32), 1));
+	this->particles.entropy = std::max(this->options.getFloat("entropy", 0.0f), 0.0f);
+
+	{
+		QualityBounds bounds;
+		bounds.targetMs = std::max(this->options.getFloat("target-ms", static_cast<float>(bounds.targetMs)), 1.0f);
+		bounds.maxEmissionStride = std::max(this->options.getInt("quality-max-stride", bounds.maxEmissionStride), 1);
+		bounds.minPointPasses = std::min(std::max(this->options.getInt("quality-min-passes", bounds.minPointPasses), 1), 3);
+		bounds.minWaveScale = std::min(std::max(this->options.getFloat("quality-min-wave", bounds.minWaveScale), 0.01f), 1.0f);
+		bounds.minAgeScale = std::min(std::max(this->options.getFloat("quality-min-age", bounds.minAgeScale), 0.01f), 1.0f);
+		bounds.minRenderScale = std::min(std::max(this->options.getFloat("quality-min-resolution", bounds.minRenderScale), 0.1f), 1.0f);
+		this->governor.configure(bounds);
+
+		// Runs that have to be repeatable keep full quality.
+		this->governor.setEnabled(this->options.has("no-governor") == false && this->benchmark.isRunning() == false 
+			&& this->measureLatencyFrames == 0 && this->replaying == false && this->options.has("record") == false);
+	}
+
+	{
+		auto interval = std::max(this->options.getFloat("memory-interval", 10.0f), 0.1f);
+
+		if(this->options.has("soak") == true)
+		{
+			SoakSettings settings;
+			settings.hours = std::max(this->options.getFloat("soak", static_cast<float>(settings.hours)), 0.01f);
+			settings.trackSeconds = std::max(this->options.getFloat("soak-track-seconds", static_cast<float>(settings.trackSeconds)), 1.0f);
+			settings.warmupMinutes = std::max(this->options.getFloat("soak-warmup-minutes", static_cast<float>(settings.warmupMinutes)), 0.0f);
+			settings.maxSlope = std::max(this->options.getFloat("soak-slope-kb", static_cast<float>(settings.maxSlope / 1024.0)), 0.0f) * 1024.0;
+			this->soak.start(settings);
+		}
+
+		// Per-subsystem limits in MB and KB per hour; a soak run holds the rest to its own slope limit.
+		for(int i = 0; i < MemoryLedger::Subsystem_End; i++)
+		{
+			auto subsystem = static_cast<MemoryLedger::Subsystem>(i);
+			std::string name = MemoryLedger::getSubsystemName(subsystem);
+
+			auto defaultSlope = (this->soak.isRunning() == true) ? static_cast<float>(this->soak.getSettings().maxSlope / 1024.0) : 0.0f;
+			auto budget = std::max(this->options.getFloat("memory-budget-" + name, 0.0f), 0.0f);
+			auto slope = std::max(this->options.getFloat("memory-slope-" + name, defaultSlope), 0.0f);
+			this->memory.setLimits(subsystem, static_cast<int64_t>(budget * 1024.0 * 1024.0), slope * 1024.0);
+		}
+
+		// Enough history to fit the whole soak run, otherwise the last hour.
+		auto hours = (this->soak.isRunning() == true) ? this->soak.getSettings().hours + 0.1 : 1.0;
+		this->memory.configure(interval, static_cast<size_t>(hours * 3600.0 / interval) + 1);
+
+		if(this->options.has("memory-stats") == true || this->soak.isRunning() == true)
+		{
+			this->memory.openStats(this->options.getString("memory-stats", "memory.csv"));
+		}
+	}
+
+	// Headless and recorded runs never idle; a recording doesn't log skipped emission.
+	this->activeFrameRate = this->getFrameRate();
+	this->idleFrameRate = std::max(this->options.getFloat("idle-fps", this->idleFrameRate), 1.0f);
+	this->idle.setEnabled(this->options.has("no-idle") == false && this->benchmark.isRunning() == false 
+		&& this->measureLatencyFrames == 0 && this->replaying == false && this->options.has("record") == false);
+
+	if(this->options.has("metrics") == true)
+	{
+		auto address = this->options.getString("metrics", "127.0.0.1:9464");
+
+		if(this->metricsServer.start(address) == false)
+		{
+			console() << "Can't serve metrics on " << address << std::endl;
+		}
+	}
+
+	if(this->options.has("alloc-check") == true)
+	{
+		if(AllocationCounter::isAvailable() == true)
+		{
+			this->allocationWarmup = std::max(this->options.getInt("alloc-check", 300), 0);
+		}
+		else
+		{
+			console() << "--alloc-check needs a debug build" << std::endl;
+		}
+	}
 
-	this->particles.maxAge = 32;
 	this->velocityScale = 5;
 	this->useAbsoluteValue = false;
 	this->useGreyscale = false;
@@ -169,25 +547,64 @@ void EpochVisualizer::setup()
 	this->font = Font(this->loadAsset("Arial.ttf" ), this->fontSize);
 	this->fontTexture = gl::TextureFont::create(this->font);
 
-	auto args = this->getArgs();
-
-	if(args.size() <= 1)
+	if(this->benchmark.isRunning() == true)
+	{
+		this->startBenchmark();
+	}
+	else if(this->replaying == true)
+	{
+		// Nothing to play.
+	}
+	else if(this->options.positional.empty() == true)
 	{
-		this->fmodSystem->createSound(ci::app::getAssetPath( "Blank__Kytt_-_08_-_RSPN.mp3" ).string().c_str(), FMOD_SOFTWARE, nullptr, &fmodSound );
-		this->fmodSound->setMode(FMOD_LOOP_NORMAL);
-		this->fmodSystem->playSound(FMOD_CHANNEL_FREE, this->fmodSound, false, &this->fmodChannel);
-		this->fmodChannel->setChannelGroup(this->fmodChannelGroup);
+		this->currentTrack = ci::app::getAssetPath( "Blank__Kytt_-_08_-_RSPN.mp3" ).string();
+		this->audio.play(this->currentTrack, true);
 	}
 	else
 	{
-		std::string fileName = args[1].c_str();
+		std::string fileName = this->options.positional[0];
 		this->loadFile(fileName);
 	}	
+
+	if(this->replaying == true)
+	{
+		this->startReplay();
+	}
+	else if(this->options.has("record") == true)
+	{
+		this->startRecording();
+	}
+}
+
+void EpochVisualizer::shutdown()
+{
+	this->metricsServer.stop();
+	this->recorder.close();
+
+	if(this->options.has("profile-csv") == true)
+	{
+		this->profiler.writeCsv(this->options.getString("profile-csv", "profile.csv"));
+	}
+
+	if(this->options.has("profile-trace") == true)
+	{
+		this->profiler.writeChromeTrace(this->options.getString("profile-trace", "profile.json"));
+	}
+
+	this->analyzer.stop();
+	this->analyzer.detach();
+	this->trackAnalysisCache.stop();
+	this->metadataLoader.stop();
+	this->metadataCache.stop();
+	this->directoryScanner.stop();
+	this->readahead.stop();
+	this->seekTableCache.stop();
+	this->audio.shutdown();
 }
 
 void EpochVisualizer::fileDrop(ci::app::FileDropEvent evt)
 {
-	if(evt.getNumFiles() == 1)
+	if(evt.getNumFiles() == 1 && ci::fs::is_directory(evt.getFile(0)) == false)
 	{
 		auto file = evt.getFile(0);
 		auto filePreferred = file.make_preferred();
@@ -199,15 +616,34 @@ void EpochVisualizer::fileDrop(ci::app::FileDropEvent evt)
 		if(this->isShiftDown == false)
 		{
 			this->playList.clear();
+			this->directoryScanner.cancel();
 		}
 
+		// Folders are walked in the background and appended from update() as they're found.
+		std::vector<std::string> directories;
+
 		for(size_t i = 0; i < evt.getNumFiles(); i++)
 		{
 			auto file = evt.getFile(i);
 			auto filePreferred = file.make_preferred();
 			std::string fileName = filePreferred.string();
-			this->playList.push_back(fileName);
+
+			if(ci::fs::is_directory(filePreferred) == true)
+			{
+				directories.push_back(fileName);
+			}
+			else
+			{
+				this->playList.push_back(fileName);
+			}
+		}
+
+		if(directories.empty() == false)
+		{
+			this->directoryScanner.scan(directories);
 		}
+
+		this->metadataCache.index(this->playList);
 	}
 }
 
@@ -228,7 +664,7 @@ void EpochVisualizer::loadFile(const std::string& fileName)
 	{
 		this->loadFileMP3(fileName);
 	}
-	else if(dropExtension == "epoch")
+	else if(dropExtension == "epoch" || dropExtension == "epl")
 	{
 		this->loadFilePlaylist(fileName);
 	}
@@ -236,94 +672,90 @@ void EpochVisualizer::loadFile(const std::string& fileName)
 
 void EpochVisualizer::loadFileMP3(const std::string& fileName)
 {
-	this->fmodChannel->stop();
+	// Opens in the background and starts playing from update() once it is ready.
+	this->audio.play(fileName, false);
+	this->trackChanged(fileName);
+}
+
+void EpochVisualizer::trackChanged(const std::string& fileName)
+{
+	this->analyzer.setTrackAnalysis(nullptr, nullptr);
 
-	FMOD::System_Create(&this->fmodSystem);
-	this->fmodSystem->init(2, FMOD_INIT_NORMAL | FMOD_INIT_ENABLE_PROFILE, nullptr);
-	this->fmodSystem->createChannelGroup(nullptr, &this->fmodChannelGroup);
-	this->fmodSystem->createSound(fileName.c_str(), FMOD_SOFTWARE, NULL, &this->fmodSound);
-	this->fmodSound->setMode(FMOD_LOOP_OFF);
-	this->fmodSystem->playSound(FMOD_CHANNEL_FREE, this->fmodSound, false, &this->fmodChannel);
-	this->fmodChannel->setChannelGroup(this->fmodChannelGroup);
+	// Pre-analyze this track and the next one in the background.
+	this->currentTrack = fileName;
+	this->hasTrackAnalysis = false;
+	this->hasTrackStats = false;
+	this->trackAnalysisCache.request(fileName);
 
-	// Album Art
+	if(this->playList.empty() == false)
 	{
-		TagLib::MPEG::File f(fileName.c_str());
+		this->trackAnalysisCache.request(this->playList[(this->playListTrackNumber + 1) % this->playList.size()]);
+
+		// Warm the upcoming tracks into the page cache and the tag cache.
+		std::vector<std::string> upcoming;
+		auto count = std::min(static_cast<size_t>(std::max(this->options.getInt("readahead-tracks", 3), 0)), this->playList.size() - 1);
 
-		if(f.isValid() == true)
+		for(size_t i = 1; i <= count; i++)
 		{
-			auto tag = f.ID3v2Tag();
+			upcoming.push_back(this->playList[(this->playListTrackNumber + i) % this->playList.size()]);
+		}
 
-			if(tag != nullptr)
-			{
-				this->artist = std::string(tag->artist().toCString());
-				this->album = std::string(tag->album().toCString()) + " (" + std::to_string(tag->year()) + ")";
-				this->title = std::string(tag->title().toCString());
+		this->readahead.schedule(upcoming);
+		this->metadataCache.index(upcoming);
 
-				TagLib::ID3v2::FrameList l = tag->frameList("APIC");
+		std::for_each(std::begin(upcoming), std::end(upcoming),
+			[this](const std::string& file)
+			{
+				this->seekTableCache.request(file);
+			});
+	}
 
-				if(l.isEmpty() == false)
-				{
-					auto apf = static_cast<TagLib::ID3v2::AttachedPictureFrame*>(l.front());
+	// Indexed tracks come straight from the cache. Otherwise tags and album art load 
+	// on a worker and update() uploads the texture when it is ready.
+	TrackMetadata metadata;
 
-					if(apf != nullptr && apf->picture().data() != nullptr && apf->picture().size() > 0)
-					{
-						std::string extension = std::string(apf->mimeType().toCString());
-
-						if(extension.find('/') != std::string::npos)
-						{
-							extension = extension.substr(extension.find_last_of("/") + 1);
-						}
-
-						this->debugMe = extension;
-
-						std::ofstream os;
-						std::string debugFileName = "debug." + extension;
-						os.open(debugFileName.c_str(), std::ios_base::binary);
-						os.write(apf->picture().data(), apf->picture().size());
-						os.close();
-
-						try
-						{
-							cinder::Buffer buff(apf->picture().data(), apf->picture().size());
-							auto albumImage = ci::loadImage(debugFileName.c_str());
-							// albumImage = ci::loadImage(DataSourceBuffer::create(buff), ImageSource::Options(), extension.c_str());
-							this->albumArt = gl::Texture(albumImage);
-							this->enableAlbumArt = true;
-						}
-						catch(...)
-						{
-							this->enableAlbumArt = false;
-							this->debugMe += " EXCEPTION";
-						}
-					}
-				}
-			}
-		}
+	if(this->metadataCache.get(fileName, metadata) == true)
+	{
+		this->applyMetadata(metadata);
+	}
+	else
+	{
+		this->updateLayout();
+		this->metadataLoader.request(fileName, this->albumArtSize);
+		this->metadataCache.index(std::vector<std::string>(1, fileName));
 	}
 }
 
-void EpochVisualizer::loadFilePlaylist(const std::string& fileName)
+void EpochVisualizer::applyMetadata(const TrackMetadata& metadata)
 {
-	std::ifstream is;
-	is.open(fileName);
+	this->artist = metadata.artist;
+	this->album = metadata.album + (metadata.year > 0 ? " (" + std::to_string(metadata.year) + ")" : "");
+	this->title = metadata.title;
+	this->enableAlbumArt = metadata.hasAlbumArt;
+	this->creditsChanged = true;
 
-	if(is.is_open() == true)
-	{
-		this->playList.clear();
+	MemoryLedger::release(MemoryLedger::Subsystem_Textures, this->albumArtBytes);
+	this->albumArtBytes = 0;
+	this->albumArt.reset();
 
-		while(is.eof() == false)
-		{
-			std::string line;
-			std::getline(is, line);
+	if(metadata.hasAlbumArt == true)
+	{
+		this->albumArt = gl::Texture(metadata.albumArt);
+		this->albumArtBytes = static_cast<size_t>(this->albumArt.getWidth()) * this->albumArt.getHeight() * 4;
+		MemoryLedger::allocate(MemoryLedger::Subsystem_Textures, this->albumArtBytes);
+	}
+}
 
-			if(line.empty() == false)
-			{
-				this->playList.push_back(line);
-			}
-		}
+void EpochVisualizer::loadFilePlaylist(const std::string& fileName)
+{
+	// Binary playlists are mapped and used in place; anything else is read as text.
+	if(this->playList.open(fileName) == false)
+	{
+		this->playList.importText(fileName);
 	}
 
+	this->metadataCache.index(this->playList);
+
 	this->playListTrackNumber = this->playList.size();
 	this->nextTrack();
 }
@@ -452,12 +884,31 @@ void EpochVisualizer::keyDown(KeyEvent evt)
 			this->enableClearScreen = !this->enableClearScreen;
 			break;
 
+		case 'l':
+		case 'L':
+			this->enableAvSync = !this->enableAvSync;
+			break;
+
 		case 'm':
 		case 'M':
 			{
 				bool muted;
-				this->fmodChannelGroup->getMute(&muted);
-				this->fmodChannelGroup->setMute(!muted);
+				this->audio.getChannelGroup()->getMute(&muted);
+				this->audio.getChannelGroup()->setMute(!muted);
+			}
+			break;
+
+		case 'p':
+		case 'P':
+			this->enableProfiler = !this->enableProfiler;
+			break;
+
+		case 'k':
+		case 'K':
+			// Recorded sessions don't log the governor's decisions, so it stays off for them.
+			if(this->recorder.isOpen() == false && this->replaying == false)
+			{
+				this->governor.setEnabled(!this->governor.isEnabled());
 			}
 			break;
 
@@ -470,16 +921,15 @@ void EpochVisualizer::keyDown(KeyEvent evt)
 			break;
 
 		case ' ':
-			{
-				bool paused;
-				this->fmodChannelGroup->getPaused(&paused);
-				this->fmodChannelGroup->setPaused(!paused);
-			}
+			this->audio.setPaused(!this->audio.isPaused());
 			break;
 
 		default:
 			break;
 	};
+
+	// Don't wait for the next idle frame to notice a resume.
+	this->updateIdle();
 }
 
 void EpochVisualizer::keyUp(KeyEvent evt)
@@ -515,122 +965,402 @@ void EpochVisualizer::mouseDrag(MouseEvent evt)
 
 void EpochVisualizer::update()
 {
-	// Check to see if we need to load another track.
+	this->countAllocations();
+	this->arena.reset();
+
+	if(this->benchmark.isRunning() == true)
+	{
+		this->updateBenchmark();
+		return;
+	}
+
+	this->profiler.beginFrame();
+	this->measureLatency();
+
 	{
-		bool soundIsPlaying(false);
-		this->fmodChannel->isPlaying(&soundIsPlaying);
-		if(soundIsPlaying == false)
+		FrameProfiler::Frame last;
+
+		if(this->profiler.getLastFrame(last) == true)
 		{
-			this->soundComplete();
+			this->governor.update(last);
 		}
+
+		const QualityLevel& level = this->governor.getLevel();
+		this->particles.ageScale = level.ageScale;
+		this->particles.pointPasses = level.pointPasses;
 	}
 
-	// Update master volume level.
-	this->fmodChannelGroup->setVolume(this->masterVolume);
+	// The engine joins the prefetched track on its own; only fall back to loading when nothing is queued.
+	this->profiler.begin(FrameProfiler::Phase_AudioUpdate);
+	auto changed = this->audio.update();
+	this->profiler.end(FrameProfiler::Phase_AudioUpdate);
+	this->profiler.sampleFmod(this->audio.getSystem());
 
-	// Update visualization Data
+	if(changed == true)
 	{
-		std::vector<float> waveData;
-		
-		if(this->domain == Domain_Time || (this->domain == Domain_Mixed && this->mixedDomainFlag == true))
+		if(this->playList.empty() == false && this->audio.getFileName() == this->playList[(this->playListTrackNumber + 1) % this->playList.size()])
 		{
-			waveData = this->getWaveData();
+			this->playListTrackNumber = (this->playListTrackNumber + 1) % this->playList.size();
 		}
-		else 
+
+		this->trackChanged(this->audio.getFileName());
+	}
+	else if(this->audio.isIdle() == true && this->replaying == false)
+	{
+		this->soundComplete();
+	}
+
+	if(this->playList.empty() == false)
+	{
+		this->playList.get((this->playListTrackNumber + 1) % this->playList.size(), this->prefetchName);
+		this->audio.prefetch(this->prefetchName);
+	}
+
+	// Append whatever the directory scanner has found since last frame.
+	this->scannedFiles.clear();
+
+	if(this->directoryScanner.poll(this->scannedFiles) == true)
+	{
+		std::for_each(std::begin(this->scannedFiles), std::end(this->scannedFiles), 
+			[this](const std::string& fileName)
+			{
+				this->playList.push_back(fileName);
+			});
+
+		this->metadataCache.index(this->scannedFiles);
+	}
+
+	{
+		auto isScanning = this->directoryScanner.isScanning();
+
+		if(this->wasScanning == true && isScanning == false)
 		{
-			waveData = this->getSpectrumDataMirrorDB();
+			console() << "Scanned " << this->directoryScanner.getDirectoryCount() << " folders, " 
+				<< this->directoryScanner.getFileCount() << " files in " << this->directoryScanner.getSeconds() << " s ("
+				<< this->directoryScanner.getFilesPerSecond() << " files/s)" << std::endl;
 		}
 
-		this->mixedDomainFlag = !this->mixedDomainFlag;
+		this->wasScanning = isScanning;
+	}
+
+	// Once the track is audible, log what it cost to get there.
+	if(this->hasTrackStats == false && this->audio.getFirstAudioSeconds() >= 0)
+	{
+		console() << this->audio.getFileName() << ": " << AudioEngine::getLoadModeName(this->audio.getLoadMode())
+			<< ", first audio " << 1000.0 * this->audio.getFirstAudioSeconds() << " ms"
+			<< ", open " << 1000.0 * this->audio.getOpenSeconds() << " ms"
+			<< ", " << this->audio.getTrackMemory() / 1024 << " KB resident" << std::endl;
+		this->hasTrackStats = true;
+
+		this->metrics.firstAudioSeconds.observe(this->audio.getFirstAudioSeconds());
+		this->metrics.openSeconds = this->audio.getOpenSeconds();
+	}
+
+	// Update master volume level.
+	this->audio.getChannelGroup()->setVolume(this->masterVolume);
 
-		auto maxValue = fabs(*std::max_element(std::begin(waveData), std::end(waveData)));
+	this->updateIdle();
+	this->updateMemory();
+	this->updateMetrics();
 
-		auto rgb = this->getValueColor(maxValue);
+	// Switch to precomputed analysis as soon as the cache has it.
+	if(this->hasTrackAnalysis == false && this->currentTrack.empty() == false && this->audio.getChannel() != nullptr)
+	{
+		auto analysis = this->trackAnalysisCache.get(this->currentTrack);
 
-		for(size_t i = 0; i < waveData.size(); ++i)
+		if(analysis)
 		{
-			auto value = waveData[i];
-			auto absValue = std::abs(value);
-		
-			auto xPos = (static_cast<float>(this->getWindowWidth()) / static_cast<float>(waveData.size())) * i;
-			auto yPos = this->getWindowCenter().y;
+			this->analyzer.setTrackAnalysis(analysis, this->audio.getChannel());
+			this->hasTrackAnalysis = true;
+		}
+	}
 
-			if(this->useAbsoluteValue == true)
-			{
-				yPos = static_cast<float>(this->getWindowHeight());
-			}
+	// Update album art and credits data
+	this->updateLayout();
 
-			if(this->useWaveColoring == false)
-			{
-				rgb = this->getValueColor(absValue);
-			}
+	{
+		TrackMetadata metadata;
 
-			this->particles.addParticle(xPos, yPos, value * this->velocityScale, rgb, this->useVelocityScale);
+		if(this->metadataLoader.poll(metadata) == true)
+		{
+			this->applyMetadata(metadata);
 		}
-
-		this->particles.screenHeight = this->getWindowHeight();
-		this->particles.screenWidth = this->getWindowWidth();
-		this->particles.update();
 	}
 
-	// Update album art and credits data
+	// Nothing is drawn while measuring, so latch here instead of in draw().
+	if(this->measureLatencyFrames > 0)
 	{
-		this->albumArtSize = this->getWindowWidth() / 10;
-		this->albumArtReflectionShift = -(this->albumArtSize / 4);
-		this->albumArtReflectionHeight = this->albumArtSize / 2;
-		this->albumArtReflectionOffset = 2;
-		this->albumArtBorder = this->getWindowWidth() / 40;
+		this->latchVisualization();
 
-		this->albumArtTopX = this->getWindowWidth() - this->albumArtSize - this->albumArtBorder;
-		this->albumArtTopY = this->getWindowHeight() - this->albumArtSize - this->albumArtReflectionHeight - this->albumArtReflectionOffset - this->albumArtBorder;
+		if(this->latencyCompensated.size() >= static_cast<size_t>(this->measureLatencyFrames))
+		{
+			this->reportLatency();
+			this->quit();
+		}
 	}
 }
 
-void EpochVisualizer::draw()
+void EpochVisualizer::latchVisualization()
 {
-	gl::enableAlphaBlending(true);
+	// Select the audio that will be audible when this frame reaches the screen.
+	// Everything after this point (the rest of draw(), the swap and the display)
+	// is latency the picture has to make up for, so latch as late as possible.
+	const AudioCapture& capture = this->analyzer.getCapture();
+	this->latchTime = capture.getSeconds();
 
-	if(this->enableClearScreen == true)
+	if(this->replaying == true)
 	{
-		gl::clear(Color(0, 0, 0));
+		// The log supplies the view size, the controls and the analysis.
+		if(this->stepReplay() == false)
+		{
+			return;
+		}
 	}
 	else
 	{
-		glColor4f(0, 0, 0, 0.05f);
-		glBegin(GL_QUADS);
+		this->viewWidth = this->getWindowWidth();
+		this->viewHeight = this->getWindowHeight();
+	}
+
+	this->sessionFrame.hasAnalysis = false;
+
+	// Tell the analysis thread what to produce next.
+	if(this->replaying == false)
+	{
+		AnalysisSettings settings;
+		settings.waveSampleSize = std::max(static_cast<int>(this->waveSampleSize * this->governor.getLevel().waveScale), 1);
+		settings.sampleSize = this->sampleSize;
+		settings.analyzeWave = (this->domain == Domain_Time || this->domain == Domain_Mixed);
+		settings.analyzeSpectrum = (this->domain != Domain_Time);
+		settings.timeDomain = (this->domain == Domain_Time);
+		settings.useGreyscale = this->useGreyscale;
+		settings.useAvSync = this->enableAvSync;
+		settings.velocityScale = this->velocityScale;
+		settings.presentationLead = this->drawDuration + this->displayLatency;
+		this->analyzer.configure(settings);
+	}
+
+	// Pick up the newest finished analysis. This never waits on the analysis thread.
+	if(this->replaying == false && this->analyzer.update() == true)
+	{
+		const AnalysisFrame& analysis = this->analyzer.getFrame();
+		this->analysisTimes.push(analysis.analysisSeconds * 1000.0);
+		this->profiler.add(FrameProfiler::Phase_Fetch, analysis.fetchSeconds);
+		this->profiler.add(FrameProfiler::Phase_Spectrum, analysis.spectrumSeconds);
+		this->profiler.add(FrameProfiler::Phase_Color, analysis.colorSeconds);
+
+		if(this->recorder.isOpen() == true)
 		{
-			glVertex2f(0, 0);
-			glVertex2f(this->getWindowWidth(), 0);
-			glVertex2f(this->getWindowWidth(), this->getWindowHeight());
-			glVertex2f(0, this->getWindowHeight());
+			this->sessionFrame.hasAnalysis = true;
+			this->sessionFrame.wave = analysis.wave;
+			this->sessionFrame.spectrum = analysis.spectrum;
+			this->sessionFrame.waveMax = analysis.waveMax;
+			this->sessionFrame.spectrumMax = analysis.spectrumMax;
+			this->sessionFrame.timeDomain = analysis.settings.timeDomain;
+			this->sessionFrame.greyscale = analysis.settings.useGreyscale;
+			this->sessionFrame.paletteVelocityScale = analysis.settings.velocityScale;
 		}
-		glEnd();
 	}
 
-	this->particles.draw();
+	const AnalysisFrame& frame = (this->replaying == true) ? this->replayAnalysis : this->analyzer.getFrame();
+	this->latchClock = frame.clock;
 
-	if(this->enableHelp == true)
+	if(this->measureLatencyFrames > 0)
 	{
-		this->drawHelp();
+		// Judged after the swap by measureLatency(); the capture's own clock model can't grade itself.
+		this->latencyWriteClock = capture.getWriteClock();
+		this->latencyPending = true;
 	}
-	
-	if(this->enableCredits == true)
+
+	if(this->recorder.isOpen() == true)
 	{
-		glColor3f(0.9f, 0.9f, 0.9f);
-		
-		TextLayout layout; 
-		layout.setColor(cinder::ColorA(1.0f, 1.0f, 1.0f));
-		layout.setFont(this->font);
-		layout.setLeadingOffset(3.0f);
+		auto controls = this->getControls();
+		this->sessionFrame.width = this->viewWidth;
+		this->sessionFrame.height = this->viewHeight;
+		this->sessionFrame.hasControls = (this->recorder.getFrameCount() == 0 || memcmp(&controls, &this->recordedControls, sizeof(controls)) != 0);
+		this->sessionFrame.controls = controls;
+		this->recordedControls = controls;
+	}
+
+	// Update visualization Data
+	{
+		auto useWave = (this->domain == Domain_Time || (this->domain == Domain_Mixed && this->mixedDomainFlag == true));
+		const std::vector<float>& waveData = (useWave == true) ? frame.wave : frame.spectrum;
+		const std::vector<std::array<float, 3>>& waveColors = (useWave == true) ? frame.waveColors : frame.spectrumColors;
+
+		this->mixedDomainFlag = !this->mixedDomainFlag;
+
+		auto rgb = (useWave == true) ? frame.waveMaxColor : frame.spectrumMaxColor;
+
+		this->profiler.begin(FrameProfiler::Phase_Emission);
+
+		auto points = this->arena.allocate<EmissionPoint>(waveData.size());
+		this->emittedParticles = 0;
+
+		// Paused, stopped or muted: the analysis is stale, so let the field decay.
+		if(this->idle.isEmitting() == true)
+		{
+			// One column per pixel at most, fewer when the governor asks for a coarser stride.
+			auto columns = (this->useDecimation == true) ? std::min(waveData.size(), static_cast<size_t>(std::max(this->viewWidth, 1))) : waveData.size();
+			columns /= static_cast<size_t>(this->governor.getLevel().emissionStride);
+
+			this->emittedParticles = Emission::decimate(waveData, this->velocityScale, static_cast<float>(this->viewWidth), columns, this->emissionFloor, points);
+			this->metrics.emittedParticles += this->emittedParticles;
+		}
+
+		auto yPos = (this->useAbsoluteValue == true) ? static_cast<float>(this->viewHeight) : this->viewHeight * 0.5f;
+
+		std::for_each(points, points + this->emittedParticles,
+			[&](const EmissionPoint& point)
+			{
+				if(this->useWaveColoring == false)
+				{
+					rgb = waveColors[point.index];
+				}
+
+				this->particles.addParticle(point.x, yPos, point.value, rgb, this->useVelocityScale);
+			});
+
+		this->profiler.end(FrameProfiler::Phase_Emission);
+
+		ProfileScope scope(this->profiler, FrameProfiler::Phase_ParticleUpdate);
+		this->particles.screenHeight = this->viewHeight;
+		this->particles.screenWidth = this->viewWidth;
+		this->metrics.culledParticles += this->particles.update();
+	}
+
+	if(this->recorder.isOpen() == true)
+	{
+		this->sessionFrame.checksum = this->particles.getChecksum();
+		this->recorder.write(this->sessionFrame);
+	}
+	else if(this->replaying == true && this->benchmark.isRunning() == false)
+	{
+		if(this->particles.getChecksum() != this->sessionFrame.checksum && this->replayMismatches++ == 0)
+		{
+			this->replayFirstMismatch = this->replayFrame - 1;
+		}
+	}
+}
+
+void EpochVisualizer::draw()
+{
+	if(this->measureLatencyFrames > 0 || this->benchmark.isRunning() == true)
+	{
+		return;
+	}
+
+	this->latchVisualization();
+
+	// Nobody can see it; keep the simulation going but skip the GL work.
+	if(this->idle.isOccluded() == true)
+	{
+		this->profiler.endDraw();
+		return;
+	}
+
+	gl::enableAlphaBlending(true);
+
+	// Under load the governor can render the scene at a fraction of the window's resolution and scale it up.
+	auto renderScale = this->governor.getLevel().renderScale;
+	auto isScaled = (renderScale < 1.0f);
+
+	if(isScaled == true)
+	{
+		auto width = std::max(static_cast<int>(this->getWindowWidth() * renderScale), 1);
+		auto height = std::max(static_cast<int>(this->getWindowHeight() * renderScale), 1);
+
+		if(!this->sceneFbo || this->sceneFbo.getWidth() != width || this->sceneFbo.getHeight() != height)
+		{
+			this->sceneFbo = gl::Fbo(width, height);
+		}
+
+		this->sceneFbo.bindFramebuffer();
+		gl::setViewport(this->sceneFbo.getBounds());
+		gl::setMatricesWindow(this->getWindowWidth(), this->getWindowHeight());
+	}
+
+	this->profiler.begin(FrameProfiler::Phase_Clear);
+
+	if(this->enableClearScreen == true)
+	{
+		gl::clear(Color(0, 0, 0));
+	}
+	else
+	{
+		glColor4f(0, 0, 0, 0.05f);
+		glBegin(GL_QUADS);
+		{
+			glVertex2f(0, 0);
+			glVertex2f(this->getWindowWidth(), 0);
+			glVertex2f(this->getWindowWidth(), this->getWindowHeight());
+			glVertex2f(0, this->getWindowHeight());
+		}
+		glEnd();
+	}
+
+	this->profiler.end(FrameProfiler::Phase_Clear);
+
+	{
+		ProfileScope scope(this->profiler, FrameProfiler::Phase_Particles);
+		this->particles.draw(this->arena);
+
+		if(isScaled == true)
+		{
+			this->sceneFbo.unbindFramebuffer();
+			gl::setViewport(this->getWindowBounds());
+			gl::setMatricesWindow(this->getWindowWidth(), this->getWindowHeight());
+
+			gl::disableAlphaBlending();
+			gl::color(Color(1, 1, 1));
+			gl::draw(this->sceneFbo.getTexture(), Rectf(0, 0, static_cast<float>(this->getWindowWidth()), static_cast<float>(this->getWindowHeight())));
+			gl::enableAlphaBlending(true);
+		}
+	}
+
+	this->profiler.begin(FrameProfiler::Phase_Overlay);
+
+	// The debug overlays are diagnostics, not the steady-state frame; let them allocate.
+	AllocationCounter::suspend();
+
+	if(this->enableHelp == true)
+	{
+		this->drawHelp();
+	}
+
+	if(this->enableProfiler == true)
+	{
+		this->drawProfiler();
+	}
+
+	AllocationCounter::resume();
+
+	this->profiler.end(FrameProfiler::Phase_Overlay);
+	
+	if(this->enableCredits == true)
+	{
+		ProfileScope scope(this->profiler, FrameProfiler::Phase_Credits);
+
+		glColor3f(0.9f, 0.9f, 0.9f);
+
+		if(this->creditsChanged == true)
+		{
+			TextLayout layout; 
+			layout.setColor(cinder::ColorA(1.0f, 1.0f, 1.0f));
+			layout.setFont(this->font);
+			layout.setLeadingOffset(3.0f);
+
+			layout.addLine(this->artist);
+			layout.addLine(this->album);
+			layout.addLine(this->title);
 
-		layout.addLine(this->artist);
-		layout.addLine(this->album);
-		layout.addLine(this->title);
+			this->renderOverlay(layout, this->creditTexture, this->creditBytes);
+			this->creditsChanged = false;
+		}
 
-		auto creditTexture = gl::Texture(layout.render(true, true));
-		creditTexture.enableAndBind();
-		gl::draw(creditTexture, Vec2f(this->albumArtBorder, this->albumArtTopY));
-		creditTexture.disable();
+		this->creditTexture.enableAndBind();
+		gl::draw(this->creditTexture, Vec2f(this->albumArtBorder, this->albumArtTopY));
+		this->creditTexture.disable();
 
 		if(this->enableAlbumArt == true)
 		{
@@ -672,230 +1402,664 @@ void EpochVisualizer::draw()
 			this->albumArt.disable();
 		}
 	}
+
+	// Track how long the rest of the frame takes after the latch.
+	auto elapsed = this->analyzer.getCapture().getSeconds() - this->latchTime;
+	this->drawDuration = this->drawDuration * 0.9 + elapsed * 0.1;
+	this->renderTimes.push(elapsed * 1000.0);
+
+	this->profiler.endDraw();
 }
 
-void EpochVisualizer::drawHelp()
+void EpochVisualizer::updateIdle()
 {
-	gl::color(cinder::ColorA(1.0f, 1.0f,1.0f));
+	auto paused = false;
+	auto muted = false;
+	auto group = this->audio.getChannelGroup();
+
+	if(group != nullptr)
+	{
+		group->getPaused(&paused);
+		group->getMute(&muted);
+	}
+
+	auto window = this->getWindow();
+	auto occluded = (window->isHidden() == true || IdleMonitor::isMinimized(window->getNative()) == true);
+
+	if(this->idle.update(paused, this->audio.isIdle(), muted, occluded, this->particles.particles.size()) == false)
+	{
+		return;
+	}
+
+	// Analysis is only wanted while emitting, and full rate only while there is something to draw.
+	this->setFrameRate(this->idle.getState() == IdleMonitor::State_Idle ? this->idleFrameRate : this->activeFrameRate);
+	this->analyzer.setPaused(this->idle.isEmitting() == false);
+}
 
-	TextLayout layout; 
-	layout.setColor(cinder::ColorA(1.0f, 1.0f, 1.0f));
-	layout.setFont(this->font);
-	layout.setLeadingOffset(3.0f);
-
-	layout.addLine(std::to_string(this->getAverageFps()));
-	layout.addLine("");
-	layout.addLine("> - Volume Up");
-	layout.addLine("< - Volume Down");
-	layout.addLine("b - Toggle Enable Greyscale");
-	layout.addLine("d - Domain Toggle");
-	layout.addLine("E - Entropy Up");
-	layout.addLine("e - Entropy Down");
-	layout.addLine("f - Toggle Full Screen");
-	layout.addLine("g - Particle Max Age Down");
-	layout.addLine("G - Particle Max Age Up");
-	layout.addLine("H - Help");
-	layout.addLine("m - Mute");
-	layout.addLine("q - Quit");
-	layout.addLine("r - Toggle Enable Velocity Scale");
-	layout.addLine("i - Toggle Image Clear / Image Fade & Burn");
-	layout.addLine("v - Velocity Scale Down");
-	layout.addLine("V - Velocity Scale Up");
-	layout.addLine("w - Toggle Wave Coloring");
-	layout.addLine("CTRL-S - Save Playlist");
-	layout.addLine("CTRL-O - Open Playlist");
-
-	auto helpTexture = gl::Texture(layout.render(true, true));
-	helpTexture.enableAndBind();
-	gl::draw(helpTexture, Vec2f(this->albumArtBorder, this->albumArtBorder));
-	helpTexture.disable();
-}
-
-std::array<float, 3> EpochVisualizer::getValueColor(float x) const
-{
-	std::array<float, 3> rgb;
-
-	if(this->domain == EpochVisualizer::Domain_Time)
-	{
-		if(this->useGreyscale == true)
-		{
-			rgb[0] = x * this->velocityScale/2;
-			rgb[1] = rgb[0];
-			rgb[2] = rgb[0];
+void EpochVisualizer::updateMemory()
+{
+	// Particles, analysis and textures count themselves; these are measured.
+	MemoryLedger::set(MemoryLedger::Subsystem_Playlist, static_cast<int64_t>(this->playList.getMemoryBytes()));
+
+	{
+		int current = 0;
+		int peak = 0;
+		FmodMemory::getStats(current, peak);
+		MemoryLedger::set(MemoryLedger::Subsystem_Fmod, current);
+	}
+
+	this->memory.update();
+
+	if(this->soak.isRunning() == true)
+	{
+		if(this->soak.isTrackDue() == true)
+		{
+			this->nextTrack();
 		}
-		else
+
+		if(this->soak.isComplete() == true)
 		{
-			if(x < 0.2f)
-			{
-				rgb[0] = (x / 0.2f)/2.0f;
-				rgb[1] = rgb[0];
-				rgb[2] = rgb[0];
-			}
-			else if(x < 0.4f)
-			{
-				rgb[0] = 0.2f;
-				rgb[1] = 0.2f;
-				rgb[2] = (x / 0.4f);
-			}
-			else if(x < 0.6f)
-			{
-				rgb[0] = ((x - 0.4f) / 0.2f);
-				rgb[1] = 0.35f;
-				rgb[2] = 0.38f;
-			}
-			else if(x < 0.8f)
-			{
-				rgb[0] = ((x - 0.6f) / 0.2f);
-				rgb[1] = 0.556f;
-				rgb[2] = 0.556f;
-			}
-			else if(x < 0.9f)
-			{
-				rgb[0] = 0.9f;
-				rgb[1] = 0.9f;
-				rgb[2] = x / 0.9f;
-			}
-			else
-			{
-				rgb[0] = x / 0.9f;
-				rgb[1] = 0.5f + 1.0f - rgb[0];
-				rgb[2] = rgb[1];
-			}
+			exitCode = (this->soak.evaluate(this->memory, console()) == true) ? 0 : 1;
+			this->soak.stop();
+			this->quit();
 		}
 	}
-	else
+}
+
+void EpochVisualizer::updateMetrics()
+{
+	if(this->metricsServer.isRunning() == false)
+	{
+		return;
+	}
+
+	FrameProfiler::Frame last;
+
+	// Each committed frame is counted once; the profiler works in milliseconds.
+	if(this->profiler.getLastFrame(last) == true && last.index != this->metricsFrame)
 	{
-		if(this->useGreyscale == true)
+		this->metricsFrame = last.index;
+		this->metrics.frames++;
+		this->metrics.frameSeconds.observe(last.total / 1000.0);
+
+		for(int i = 0; i < FrameProfiler::Phase_End; i++)
 		{
-			rgb[0] = x * this->velocityScale/2;
-			rgb[1] = rgb[0];
-			rgb[2] = rgb[0];
+			this->metrics.phaseSeconds[i] += last.phaseDuration[i] / 1000.0;
 		}
-		else
+
+		this->metrics.fmodCpu[0] = last.fmodDsp;
+		this->metrics.fmodCpu[1] = last.fmodStream;
+		this->metrics.fmodCpu[2] = last.fmodUpdate;
+		this->metrics.fmodCpu[3] = last.fmodTotal;
+	}
+
+	this->metrics.particles = this->particles.particles.size();
+	this->metrics.starvingUpdates = this->audio.getStarvingCount();
+	this->metrics.diskBusyUpdates = this->audio.getDiskBusyCount();
+	this->metrics.qualityLevel = this->governor.getLevelIndex();
+	this->metrics.idleState = this->idle.getState();
+
+	this->metricsServer.publish(this->metrics);
+}
+
+void EpochVisualizer::drawProfiler()
+{
+	const size_t frameCount = 240;
+
+	auto graphWidth = 480.0f;
+	auto graphHeight = 120.0f;
+	auto graphX = static_cast<float>(this->getWindowWidth()) - graphWidth - this->albumArtBorder;
+	auto graphY = static_cast<float>(this->getWindowHeight()) - graphHeight - this->albumArtBorder;
+
+	this->profiler.draw(graphX, graphY, graphWidth, graphHeight, frameCount);
+
+	// The numbers change every frame, but nobody can read them that fast.
+	if(!this->profileTexture || this->getElapsedSeconds() - this->profileTime >= OverlayInterval)
+	{
+		this->profileTime = this->getElapsedSeconds();
+
+		auto frames = this->profiler.getFrames(FrameProfiler::Capacity);
+
+		TextLayout layout; 
+		layout.setFont(this->font);
+		layout.setLeadingOffset(3.0f);
+
 		{
-			if(x < 0.05f)
-			{
-				rgb[0] = (x / 0.05f)/2;
-				rgb[1] = rgb[0];
-				rgb[2] = rgb[0];
-			}
-			else if(x < 0.1f)
-			{
-				rgb[0] = 0.1f;
-				rgb[1] = 0.1f;
-				rgb[2] = (x / 0.1f);
-			}
-			else if(x < 0.2f)
+			auto frame = FrameProfiler::summarize(frames, FrameProfiler::Phase_End);
+			layout.setColor(cinder::ColorA(1.0f, 1.0f, 1.0f));
+			layout.addLine("Frame: " + std::to_string(frame.p50) + " / " + std::to_string(frame.p95) + " / " + std::to_string(frame.p99) + " ms (p50 / p95 / p99)");
+		}
+
+		for(int i = 0; i < FrameProfiler::Phase_End; i++)
+		{
+			auto phase = static_cast<FrameProfiler::Phase>(i);
+			auto summary = FrameProfiler::summarize(frames, phase);
+
+			layout.setColor(FrameProfiler::getPhaseColor(phase));
+			layout.addLine(std::string("  ") + FrameProfiler::getPhaseName(phase) + ": " + std::to_string(summary.p50) 
+				+ " / " + std::to_string(summary.p95) + " / " + std::to_string(summary.p99));
+		}
+
+		if(frames.empty() == false)
+		{
+			const FrameProfiler::Frame& last = frames.back();
+			layout.setColor(cinder::ColorA(1.0f, 1.0f, 1.0f));
+			layout.addLine("FMOD CPU: dsp " + std::to_string(last.fmodDsp) + "%, stream " + std::to_string(last.fmodStream) 
+				+ "%, update " + std::to_string(last.fmodUpdate) + "%, total " + std::to_string(last.fmodTotal) + "%");
+		}
+
+		layout.setColor(cinder::ColorA(1.0f, 1.0f, 1.0f));
+		layout.addLine((AllocationCounter::isAvailable() == true ? "Heap: " + std::to_string(this->lastFrameAllocations) + " allocations last frame" : std::string("Heap: not counted"))
+			+ ", arena " + std::to_string(this->arena.getHighWater() / 1024) + " KB high water of " + std::to_string(this->arena.getCapacity() / 1024) 
+			+ " KB, grew " + std::to_string(this->arena.getGrowCount()) + "x");
+
+		this->renderOverlay(layout, this->profileTexture, this->profileBytes);
+	}
+
+	this->profileTexture.enableAndBind();
+	gl::draw(this->profileTexture, Vec2f(graphX, graphY - this->profileTexture.getHeight()));
+	this->profileTexture.disable();
+}
+
+void EpochVisualizer::drawHelp()
+{
+	gl::color(cinder::ColorA(1.0f, 1.0f,1.0f));
+
+	if(!this->helpTexture || this->getElapsedSeconds() - this->helpTime >= OverlayInterval)
+	{
+		this->helpTime = this->getElapsedSeconds();
+
+		TextLayout layout; 
+		layout.setColor(cinder::ColorA(1.0f, 1.0f, 1.0f));
+		layout.setFont(this->font);
+		layout.setLeadingOffset(3.0f);
+
+		layout.addLine(std::to_string(this->getAverageFps()));
+		layout.addLine("A/V Sync: " + std::string(this->enableAvSync == true ? "On" : "Off") 
+			+ " (" + std::to_string(1000.0 * this->analyzer.getCapture().getLatencySamples() / this->analyzer.getCapture().getSampleRate()) + " ms output)");
+
+		{
+			auto analysis = this->analysisTimes.summarize();
+			auto render = this->renderTimes.summarize();
+			layout.addLine("Analysis: " + std::to_string(analysis.p50) + " ms (p95 " + std::to_string(analysis.p95) + ") @ " + std::to_string(static_cast<int>(this->analyzer.getRate())) + " Hz"
+				+ (this->analyzer.getFrame().precomputed == true ? " (precomputed)" : ""));
+			layout.addLine("Render: " + std::to_string(render.p50) + " ms (p95 " + std::to_string(render.p95) + ")");
+			layout.addLine(this->governor.describe());
+			layout.addLine(this->idle.describe());
+			layout.addLine("Memory: " + std::to_string(Benchmark::getPeakMemory() / (1024 * 1024)) + " MB process peak" 
+				+ (this->soak.isRunning() == true ? ", soak test running" : ""));
+
+			for(int i = 0; i < MemoryLedger::Subsystem_End; i++)
 			{
-				rgb[0] = ((x - 0.1f) / 0.1f);
-				rgb[1] = 0.35f;
-				rgb[2] = 0.38f;
+				layout.addLine(this->memory.describe(static_cast<MemoryLedger::Subsystem>(i)));
 			}
-			else if(x < 0.4f)
+			layout.addLine("STFT: " + std::to_string(this->analyzer.getStftWindowSize()) + " / " + std::to_string(this->analyzer.getStftHop()) 
+				+ " (" + std::to_string(this->analyzer.getStftColumns()) + " columns)");
+			layout.addLine("Audio: " + std::string(AudioEngine::getLoadModeName(this->audio.getLoadMode())) 
+				+ ", first audio " + std::to_string(1000.0 * std::max(this->audio.getFirstAudioSeconds(), 0.0)) + " ms, "
+				+ std::to_string(this->audio.getTrackMemory() / 1024) + " KB");
 			{
-				rgb[0] = ((x - 0.2f) / 0.2f);
-				rgb[1] = 0.556f;
-				rgb[2] = 0.556f;
+				int current = 0;
+				int peak = 0;
+				FmodMemory::getStats(current, peak);
+
+				layout.addLine("FMOD Memory: " + std::to_string(current / 1024) + " KB (peak " + std::to_string(peak / 1024) + " KB), " 
+					+ (FmodMemory::isPooled() == true ? "pool " + std::to_string(FmodMemory::getPoolBytes() / (1024 * 1024)) + " MB" : std::string("heap")));
+
+				auto breakdown = FmodMemory::getBreakdown(this->audio.getSystem());
+				layout.addLine("  playback: streams " + std::to_string(breakdown.streams / 1024) + " KB, sounds " + std::to_string(breakdown.sounds / 1024) 
+					+ " KB, DSP " + std::to_string(breakdown.dsp / 1024) + " KB, channels " + std::to_string(breakdown.channels / 1024) 
+					+ " KB, system " + std::to_string(breakdown.system / 1024) + " KB");
+
+				if(FmodMemory::isPooled() == false)
+				{
+					std::string line = "  by type:";
+
+					for(int i = 0; i < FmodMemory::Category_End; i++)
+					{
+						auto category = static_cast<FmodMemory::Category>(i);
+						line += std::string(i > 0 ? ", " : " ") + FmodMemory::getCategoryName(category) + " " + std::to_string(FmodMemory::getTrackedBytes(category) / 1024) + " KB";
+					}
+
+					layout.addLine(line);
+				}
 			}
-			else if(x < 0.6f)
+			layout.addLine("Disk: " + std::string(this->audio.isMappedFileIo() == true ? "mapped" : "stdio")
+				+ ", " + std::to_string(this->audio.getFileSystem().getBytesRead() / (1024 * 1024)) + " MB read, "
+				+ std::to_string(this->audio.getFileSystem().getQueueDepth()) + " queued, starving " + std::to_string(this->audio.getStarvingCount()) 
+				+ ", disk busy " + std::to_string(this->audio.getDiskBusyCount()));
+			layout.addLine("Track Cache: " + std::to_string(this->trackAnalysisCache.getCacheBytes() / (1024 * 1024)) + " MB, " 
+				+ std::to_string(this->trackAnalysisCache.getPendingCount()) + " pending");
+			if(this->directoryScanner.isScanning() == true)
 			{
-				rgb[0] = 0.6f;
-				rgb[1] = 0.6f;
-				rgb[2] = x / 0.6f;
+				layout.addLine("Scanning: " + std::to_string(this->directoryScanner.getFileCount()) + " files, " 
+					+ std::to_string(static_cast<int>(this->directoryScanner.getFilesPerSecond())) + " files/s");
 			}
-			else
+			layout.addLine("Readahead: " + std::to_string(this->readahead.getWarmedBytes() / (1024 * 1024)) + " MB, " 
+				+ std::to_string(this->readahead.getWarmedFiles()) + " tracks" + (this->readahead.isBusy() == true ? " (warming)" : ""));
+			layout.addLine("Metadata: " + std::to_string(this->metadataCache.getIndexedCount()) + " indexed, " 
+				+ std::to_string(this->metadataCache.getPendingCount()) + " pending");
+			layout.addLine("Seek Index: " + std::to_string(this->seekTableCache.getBuiltCount()) + " built, " 
+				+ std::to_string(this->seekTableCache.getPendingCount()) + " pending");
+			if(this->metricsServer.isRunning() == true)
 			{
-				rgb[0] = x / 0.9f;
-				rgb[1] = 0.5f + 1.0f - rgb[0];
-				rgb[2] = rgb[1];
+				layout.addLine("Metrics: " + this->options.getString("metrics", "127.0.0.1:9464") + ", " 
+					+ std::to_string(this->metricsServer.getScrapeCount()) + " scrapes");
 			}
 		}
+		layout.addLine("");
+		layout.addLine("> - Volume Up");
+		layout.addLine("< - Volume Down");
+		layout.addLine("b - Toggle Enable Greyscale");
+		layout.addLine("d - Domain Toggle");
+		layout.addLine("E - Entropy Up");
+		layout.addLine("e - Entropy Down");
+		layout.addLine("f - Toggle Full Screen");
+		layout.addLine("g - Particle Max Age Down");
+		layout.addLine("G - Particle Max Age Up");
+		layout.addLine("H - Help");
+		layout.addLine("m - Mute");
+		layout.addLine("p - Toggle Frame Profiler");
+		layout.addLine("q - Quit");
+		layout.addLine("r - Toggle Enable Velocity Scale");
+		layout.addLine("i - Toggle Image Clear / Image Fade & Burn");
+		layout.addLine("k - Toggle Quality Governor");
+		layout.addLine("l - Toggle Latency Compensated A/V Sync");
+		layout.addLine("v - Velocity Scale Down");
+		layout.addLine("V - Velocity Scale Up");
+		layout.addLine("w - Toggle Wave Coloring");
+		layout.addLine("CTRL-S - Save Playlist");
+		layout.addLine("CTRL-O - Open Playlist");
+
+		this->renderOverlay(layout, this->helpTexture, this->helpBytes);
+	}
+
+	this->helpTexture.enableAndBind();
+	gl::draw(this->helpTexture, Vec2f(this->albumArtBorder, this->albumArtBorder));
+	this->helpTexture.disable();
+}
+
+void EpochVisualizer::renderOverlay(TextLayout& layout, gl::Texture& texture, size_t& bytes)
+{
+	MemoryLedger::release(MemoryLedger::Subsystem_Textures, bytes);
+
+	texture = gl::Texture(layout.render(true, true));
+	bytes = static_cast<size_t>(texture.getWidth()) * texture.getHeight() * 4;
+
+	MemoryLedger::allocate(MemoryLedger::Subsystem_Textures, bytes);
+}
+
+void EpochVisualizer::countAllocations()
+{
+	if(AllocationCounter::isAvailable() == false)
+	{
+		return;
+	}
+
+	// Everything the previous update() and draw() allocated.
+	this->lastFrameAllocations = AllocationCounter::getCount();
+	AllocationCounter::reset();
+
+	if(this->allocationWarmup < 0 || this->benchmark.isComplete() == true)
+	{
+		return;
+	}
+
+	if(this->allocationFrames++ < static_cast<uint64_t>(this->allocationWarmup))
+	{
+		return;
 	}
 
-	return std::move(rgb);
+	if(this->lastFrameAllocations > 0)
+	{
+		AllocationCounter::suspend();
+		console() << "Frame " << this->allocationFrames << ": " << this->lastFrameAllocations << " heap allocations" << std::endl;
+		AllocationCounter::resume();
+
+		// A benchmark is steady state by construction; anywhere else a track change or a dropped file may allocate.
+		assert(this->benchmark.isRunning() == false);
+	}
+}
+
+void EpochVisualizer::updateLayout()
+{
+	this->albumArtSize = this->getWindowWidth() / 10;
+	this->albumArtReflectionShift = -(this->albumArtSize / 4);
+	this->albumArtReflectionHeight = this->albumArtSize / 2;
+	this->albumArtReflectionOffset = 2;
+	this->albumArtBorder = this->getWindowWidth() / 40;
+
+	this->albumArtTopX = this->getWindowWidth() - this->albumArtSize - this->albumArtBorder;
+	this->albumArtTopY = this->getWindowHeight() - this->albumArtSize - this->albumArtReflectionHeight - this->albumArtReflectionOffset - this->albumArtBorder;
 }
 
-std::vector<float> EpochVisualizer::getWaveData()
+void EpochVisualizer::createAudioSystem()
 {
-	std::vector<float> waveData;
-	waveData.resize(this->waveSampleSize);
-	this->fmodSystem->getWaveData(waveData.data(), waveData.size(), 0);
-	return std::move(waveData);
+	// A shorter mixer buffer means less output latency to compensate for.
+	auto bufferLength = std::max(this->options.getInt("dsp-buffer-length", 0), 0);
+	auto bufferCount = std::max(this->options.getInt("dsp-buffer-count", 0), 0);
+
+	auto loadMode = this->options.getString("load-mode", "stream");
+
+	if(loadMode == "sample")
+	{
+		this->audio.setLoadMode(AudioEngine::LoadMode_Sample);
+	}
+	else if(loadMode == "compressed")
+	{
+		this->audio.setLoadMode(AudioEngine::LoadMode_CompressedSample);
+	}
+	else
+	{
+		this->audio.setLoadMode(AudioEngine::LoadMode_Stream);
+	}
+
+	this->audio.setMappedFileIo(this->options.has("no-mapped-io") == false, static_cast<uint32_t>(std::max(this->options.getInt("readahead-kb", 1024), 0)) * 1024);
+	this->audio.setSeekTableCache(this->options.has("no-seek-index") == false ? &this->seekTableCache : nullptr);
+	this->audio.setStreamBufferSize(static_cast<unsigned int>(std::max(this->options.getInt("stream-buffer-kb", 64), 2)) * 1024);
+	this->audio.init(static_cast<unsigned int>(bufferLength), bufferCount);
+	this->analyzer.attach(this->audio.getSystem());
 }
 
-std::vector<float> EpochVisualizer::getStereoWaveData()
+void EpochVisualizer::measureLatency()
 {
-	std::vector<float> waveData;
+	if(this->latencyPending == false)
+	{
+		return;
+	}
+
+	this->latencyPending = false;
+
+	// FMOD's mix clock, read now that the frame has been swapped, is independent of the
+	// timestamps the analysis used to pick the window. What is leaving the speakers is
+	// the mix position less the output buffering; what is audible when the frame reaches
+	// the eye is that plus the display's own delay.
+	unsigned int hi = 0;
+	unsigned int lo = 0;
 
-	std::vector<float> waveDataLeft;
-	waveDataLeft.resize(this->waveSampleSize);
+	if(this->audio.getSystem()->getDSPClock(&hi, &lo) != FMOD_OK)
+	{
+		return;
+	}
 
-	std::vector<float> waveDataRight;
-	waveDataRight.resize(this->waveSampleSize);
+	const AudioCapture& capture = this->analyzer.getCapture();
+	auto rate = static_cast<double>(capture.getSampleRate());
+	auto mixed = static_cast<double>((static_cast<uint64_t>(hi) << 32) | lo);
+	auto audible = mixed - capture.getLatencySamples() + this->displayLatency * rate;
 
-	this->fmodSystem->getWaveData(waveDataLeft.data(), waveDataLeft.size(), 0);
-	this->fmodSystem->getWaveData(waveDataRight.data(), waveDataRight.size(), 1);
+	// Positive means the picture trails the sound.
+	this->latencyCompensated.push_back((audible - static_cast<double>(this->latchClock)) * 1000.0 / rate);
+	this->latencyUncompensated.push_back((audible - static_cast<double>(this->latencyWriteClock)) * 1000.0 / rate);
+}
 
-	for(size_t i = 0; i < this->waveSampleSize; i++)
+void EpochVisualizer::reportLatency()
+{
+	auto compensated = Statistics::summarize(this->latencyCompensated);
+	auto uncompensated = Statistics::summarize(this->latencyUncompensated);
+
+	console() << "Audio sample to frame latency, measured against FMOD's mix clock after the swap, assuming " 
+		<< 1000.0 * this->displayLatency << " ms display latency (positive: picture trails sound)" << std::endl;
+	console() << "  compensated:   " << Statistics::toString(compensated, "ms") << std::endl;
+	console() << "  uncompensated: " << Statistics::toString(uncompensated, "ms") << std::endl;
+
+	std::ofstream os;
+	os.open("latency_report.csv");
+
+	if(os.is_open() == true)
 	{
-		if(i % 2 == 0)
+		os << "frame,compensated_ms,uncompensated_ms\n";
+
+		for(size_t i = 0; i < this->latencyCompensated.size(); i++)
 		{
-			waveData.push_back(-fabs(waveDataLeft[i]));
+			os << i << "," << this->latencyCompensated[i] << "," << this->latencyUncompensated[i] << "\n";
 		}
-		else
+	}
+}
+
+void EpochVisualizer::startBenchmark()
+{
+	const BenchmarkSettings& settings = this->benchmark.getSettings();
+
+	// The particle controller's randomness is seeded so runs are comparable.
+	ci::randSeed(1);
+
+	SignalGenerator::Type type;
+
+	if(this->replaying == true)
+	{
+		// The session log is the source.
+	}
+	else if(SignalGenerator::parseType(settings.source, type) == true)
+	{
+		this->signal = SignalGenerator(type);
+		this->signalSound = this->signal.createSound(this->audio.getSystem());
+
+		FMOD::Channel* channel = nullptr;
+
+		if(this->signalSound != nullptr && this->audio.getSystem()->playSound(FMOD_CHANNEL_FREE, this->signalSound, false, &channel) == FMOD_OK)
 		{
-			waveData.push_back(fabs(waveDataRight[i]));
+			channel->setChannelGroup(this->audio.getChannelGroup());
 		}
 	}
+	else
+	{
+		this->audio.play(settings.source, true);
+	}
 
-	return std::move(waveData);
+	if(settings.render == "gl")
+	{
+		this->benchmarkFbo = gl::Fbo(this->getWindowWidth(), this->getWindowHeight());
+	}
+	else if(settings.render == "software")
+	{
+		this->benchmarkSurface = Surface8u(this->getWindowWidth(), this->getWindowHeight(), false);
+	}
+
+	console() << "Benchmark: " << settings.frames << " frames of " << settings.source << ", " << settings.render << " render" << std::endl;
 }
 
-std::vector<float> EpochVisualizer::getSpectrumDataMirrorDB()
+void EpochVisualizer::updateBenchmark()
 {
-	std::vector<float> waveDataLeft;
-	waveDataLeft.resize(this->sampleSize);
+	// Waiting for quit() to take effect.
+	if(this->benchmark.isComplete() == true)
+	{
+		return;
+	}
 
-	std::vector<float> waveDataRight;
-	waveDataRight.resize(this->sampleSize);
+	this->profiler.beginFrame();
+	this->benchmark.beginFrame();
 
-	std::vector<float> waveDataReversed;
-	waveDataReversed.resize(this->sampleSize);
+	{
+		ProfileScope scope(this->profiler, FrameProfiler::Phase_AudioUpdate);
+		this->audio.update();
+	}
 
-	this->fmodSystem->getSpectrum(waveDataLeft.data(), waveDataLeft.size(), 0, FMOD_DSP_FFT_WINDOW::FMOD_DSP_FFT_WINDOW_HANNING);
-	this->fmodSystem->getSpectrum(waveDataRight.data(), waveDataRight.size(), 1, FMOD_DSP_FFT_WINDOW::FMOD_DSP_FFT_WINDOW_HANNING);
+	this->profiler.sampleFmod(this->audio.getSystem());
 
-	for(int i = waveDataLeft.size() / 2; i >= 0; i--)
+	// Analysis runs inline so every frame sees a fresh pass, unless a session log supplies it.
+	if(this->replaying == false)
 	{
-		auto db = 10.0f * log10(1.0f + waveDataLeft[i]) * 2.0f;
-		db *= 1.5f;
-		
-		if(i % 2 == 0)
+		this->analyzer.step();
+	}
+	this->latchVisualization();
+
+	const BenchmarkSettings& settings = this->benchmark.getSettings();
+
+	if(settings.render == "gl" && this->benchmarkFbo)
+	{
+		this->benchmarkFbo.bindFramebuffer();
+		gl::setViewport(this->benchmarkFbo.getBounds());
+		gl::setMatricesWindow(this->benchmarkFbo.getWidth(), this->benchmarkFbo.getHeight());
+		gl::enableAlphaBlending(true);
+
 		{
-			waveDataReversed[waveDataLeft.size()/2 - i] = db;
+			ProfileScope scope(this->profiler, FrameProfiler::Phase_Clear);
+			gl::clear(Color(0, 0, 0));
 		}
-		else
+
 		{
-			waveDataReversed[waveDataLeft.size()/2 - i] = -db;
+			ProfileScope scope(this->profiler, FrameProfiler::Phase_Particles);
+			this->particles.draw(this->arena);
+
+			// Count the GPU's work, not just the command submission.
+			glFinish();
 		}
+
+		this->benchmarkFbo.unbindFramebuffer();
 	}
+	else if(settings.render == "software" && this->benchmarkSurface)
+	{
+		{
+			ProfileScope scope(this->profiler, FrameProfiler::Phase_Clear);
+			memset(this->benchmarkSurface.getData(), 0, this->benchmarkSurface.getRowBytes() * this->benchmarkSurface.getHeight());
+		}
 
-	for(int i = waveDataRight.size() / 2; i >= 0; i--)
+		ProfileScope scope(this->profiler, FrameProfiler::Phase_Particles);
+		this->particles.drawSoftware(this->benchmarkSurface);
+	}
+
+	this->profiler.endDraw();
+	this->benchmark.endFrame(this->particles.particles.size(), this->emittedParticles);
+
+	if(this->benchmark.isComplete() == true)
 	{
-		auto db = 10.0f * log10(1.0f + waveDataRight[i]) * 2.0f;
-		db *= 1.5f;
-		
-		if(i % 2 == 0)
+		auto report = this->benchmark.toJson(this->profiler);
+		console() << report;
+		this->benchmark.writeJson(this->options.getString("benchmark-output", "benchmark.json"), this->profiler);
+
+		if(this->signalSound != nullptr)
 		{
-			waveDataReversed[waveDataRight.size()/2 + i - 1] = db;
+			this->signalSound->release();
+			this->signalSound = nullptr;
 		}
-		else
+
+		this->quit();
+	}
+}
+
+void EpochVisualizer::startRecording()
+{
+	auto seed = static_cast<uint32_t>(this->options.getInt("seed", static_cast<int>(std::time(nullptr))));
+	auto fileName = this->options.getString("record", "session.epr");
+
+	if(this->recorder.open(fileName, seed) == false)
+	{
+		console() << "Can't write session log " << fileName << std::endl;
+		return;
+	}
+
+	// Everything random in emission comes from here, so the seed is all a replay needs.
+	ci::randSeed(seed);
+	this->mixedDomainFlag = false;
+	this->particles.particles.clear();
+}
+
+void EpochVisualizer::startReplay()
+{
+	ci::randSeed(this->player.getSeed());
+	this->mixedDomainFlag = false;
+	this->particles.particles.clear();
+	this->replayFrame = 0;
+	this->replayMismatches = 0;
+
+	console() << "Replaying " << this->player.getFrameCount() << " frames" << std::endl;
+}
+
+bool EpochVisualizer::stepReplay()
+{
+	if(this->player.next(this->sessionFrame) == false)
+	{
+		if(this->benchmark.isRunning() == false)
 		{
-			waveDataReversed[waveDataRight.size()/2 + i - 1] = -db;
+			this->finishReplay();
+			return false;
 		}
+
+		// As a benchmark workload the log just loops.
+		this->player.rewind();
+
+		if(this->player.next(this->sessionFrame) == false)
+		{
+			return false;
+		}
+	}
+
+	this->viewWidth = static_cast<int>(this->sessionFrame.width);
+	this->viewHeight = static_cast<int>(this->sessionFrame.height);
+
+	if(this->sessionFrame.hasControls == true)
+	{
+		this->applyControls(this->sessionFrame.controls);
+	}
+
+	if(this->sessionFrame.hasAnalysis == true)
+	{
+		this->replayAnalysis.wave = this->sessionFrame.wave;
+		this->replayAnalysis.spectrum = this->sessionFrame.spectrum;
+		this->replayAnalysis.waveMax = this->sessionFrame.waveMax;
+		this->replayAnalysis.spectrumMax = this->sessionFrame.spectrumMax;
+		this->replayAnalysis.settings.timeDomain = this->sessionFrame.timeDomain;
+		this->replayAnalysis.settings.useGreyscale = this->sessionFrame.greyscale;
+		this->replayAnalysis.settings.velocityScale = this->sessionFrame.paletteVelocityScale;
+
+		ProfileScope scope(this->profiler, FrameProfiler::Phase_Color);
+		this->analyzer.colorize(this->replayAnalysis);
 	}
 
-	return std::move(waveDataReversed);
+	this->replayFrame++;
+	return true;
+}
+
+void EpochVisualizer::finishReplay()
+{
+	if(this->replayMismatches == 0)
+	{
+		console() << "Replayed " << this->replayFrame << " frames bit-exactly" << std::endl;
+	}
+	else
+	{
+		console() << "Replayed " << this->replayFrame << " frames; " << this->replayMismatches 
+			<< " diverged, the first at frame " << this->replayFirstMismatch << std::endl;
+	}
+
+	this->quit();
+}
+
+SessionControls EpochVisualizer::getControls() const
+{
+	SessionControls controls;
+	memset(&controls, 0, sizeof(controls));
+
+	controls.velocityScale = this->velocityScale;
+	controls.entropy = this->particles.entropy;
+	controls.maxAge = this->particles.maxAge;
+	controls.domain = this->domain;
+	controls.waveSampleSize = this->waveSampleSize;
+	controls.flags = (this->useAbsoluteValue == true ? SessionControls::Flag_AbsoluteValue : 0)
+		| (this->useGreyscale == true ? SessionControls::Flag_Greyscale : 0)
+		| (this->useVelocityScale == true ? SessionControls::Flag_VelocityScale : 0)
+		| (this->useWaveColoring == true ? SessionControls::Flag_WaveColoring : 0)
+		| (this->enableAvSync == true ? SessionControls::Flag_AvSync : 0)
+		| (this->useDecimation == true ? SessionControls::Flag_Decimation : 0);
+	controls.emissionFloor = this->emissionFloor;
+
+	return controls;
+}
+
+void EpochVisualizer::applyControls(const SessionControls& controls)
+{
+	this->velocityScale = controls.velocityScale;
+	this->particles.entropy = controls.entropy;
+	this->particles.maxAge = controls.maxAge;
+	this->domain = controls.domain;
+	this->waveSampleSize = controls.waveSampleSize;
+	this->useAbsoluteValue = (controls.flags & SessionControls::Flag_AbsoluteValue) != 0;
+	this->useGreyscale = (controls.flags & SessionControls::Flag_Greyscale) != 0;
+	this->useVelocityScale = (controls.flags & SessionControls::Flag_VelocityScale) != 0;
+	this->useWaveColoring = (controls.flags & SessionControls::Flag_WaveColoring) != 0;
+	this->enableAvSync = (controls.flags & SessionControls::Flag_AvSync) != 0;
+	this->useDecimation = (controls.flags & SessionControls::Flag_Decimation) != 0;
+	this->emissionFloor = controls.emissionFloor;
 }
 
 void EpochVisualizer::soundComplete()
@@ -908,6 +2072,7 @@ void EpochVisualizer::loadPlaylist()
 {
 	std::vector<std::string> extensions;
 	extensions.push_back("epoch");
+	extensions.push_back("epl");
 	auto path = ci::app::getOpenFilePath("", extensions);
 
 	if(path.empty() == false)
@@ -922,18 +2087,23 @@ void EpochVisualizer::savePlaylist()
 {
 	std::vector<std::string> extensions;
 	extensions.push_back("epoch");
+	extensions.push_back("epl");
 	auto path = ci::app::getSaveFilePath("", extensions);
 
 	if(path.empty() == false)
 	{
-		std::ofstream os;
-		os.open(path.c_str());
+		auto filePreferred = path.make_preferred();
+		std::string fileName = filePreferred.string();
 
-		for_each(std::begin(this->playList), std::end(this->playList), 
-			[&os](const std::string& entry)
-			{
-				os << entry << "\n";
-			});
+		// .epl is the binary format, anything else is exported as text.
+		if(fileName.size() > 4 && fileName.substr(fileName.size() - 4) == ".epl")
+		{
+			this->playList.save(fileName);
+		}
+		else
+		{
+			this->playList.exportText(fileName);
+		}
 	}
 }
 
@@ -941,6 +2111,8 @@ void EpochVisualizer::nextTrack()
 {
 	if(this->playList.empty() == false)
 	{
+		// Whatever was being warmed is for the wrong tracks now.
+		this->readahead.cancel();
 		this->playListTrackNumber++;
 
 		if(this->playListTrackNumber >= this->playList.size())
@@ -957,6 +2129,7 @@ void EpochVisualizer::previousTrack()
 {
 	if(this->playList.empty() == false)
 	{
+		this->readahead.cancel();
 		this->playListTrackNumber--;
 
 		if(this->playListTrackNumber >= this->playList.size())
@@ -969,4 +2142,17 @@ void EpochVisualizer::previousTrack()
 	}
 }
 
+#if defined(_WIN32)
+// CINDER_APP_NATIVE, except that it returns the exit code.
+int __stdcall WinMain(HINSTANCE instance, HINSTANCE previousInstance, LPSTR commandLine, int showCommand)
+{
+	AppBasic::prepareLaunch();
+	AppBasic* app = new EpochVisualizer;
+	RendererRef renderer(new RendererGl);
+	AppBasic::executeLaunch(app, renderer, "EpochVisualizer");
+	AppBasic::cleanupLaunch();
+	return exitCode;
+}
+#else
 CINDER_APP_NATIVE(EpochVisualizer, RendererGl)
+#endif
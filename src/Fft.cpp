@@ -0,0 +1,111 @@
+#include "Fft.h"
+
+#include <cmath>
+
+namespace
+{
+	const float Pi = 3.14159265358979f;
+}
+
+Fft::Fft() :
+	fftSize(0),
+	windowGain(1.0f)
+{
+}
+
+Fft::Fft(size_t size) :
+	fftSize(0),
+	windowGain(1.0f)
+{
+	this->resize(size);
+}
+
+void Fft::resize(size_t size)
+{
+	// Round up to a power of two.
+	size_t n = 2;
+	while(n < size)
+	{
+		n <<= 1;
+	}
+
+	if(n == this->fftSize)
+	{
+		return;
+	}
+
+	this->fftSize = n;
+	this->window.resize(n);
+	this->bitReverse.resize(n);
+	this->twiddle.resize(n / 2);
+	this->scratch.resize(n);
+
+	auto sum = 0.0f;
+	for(size_t i = 0; i < n; i++)
+	{
+		this->window[i] = 0.5f - 0.5f * cos(2.0f * Pi * static_cast<float>(i) / static_cast<float>(n - 1));
+		sum += this->window[i];
+	}
+
+	// Normalize so a full scale sine has a magnitude of 1.0 at its bin.
+	this->windowGain = 2.0f / sum;
+
+	size_t bits = 0;
+	while((static_cast<size_t>(1) << bits) < n)
+	{
+		bits++;
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		size_t r = 0;
+		for(size_t b = 0; b < bits; b++)
+		{
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		this->bitReverse[i] = r;
+	}
+
+	for(size_t i = 0; i < n / 2; i++)
+	{
+		auto angle = -2.0f * Pi * static_cast<float>(i) / static_cast<float>(n);
+		this->twiddle[i] = std::complex<float>(cos(angle), sin(angle));
+	}
+}
+
+size_t Fft::size() const
+{
+	return this->fftSize;
+}
+
+void Fft::magnitudes(const float* in, float* out)
+{
+	auto n = this->fftSize;
+
+	for(size_t i = 0; i < n; i++)
+	{
+		this->scratch[this->bitReverse[i]] = std::complex<float>(in[i] * this->window[i], 0.0f);
+	}
+
+	for(size_t span = 2; span <= n; span <<= 1)
+	{
+		auto half = span / 2;
+		auto step = n / span;
+
+		for(size_t start = 0; start < n; start += span)
+		{
+			for(size_t k = 0; k < half; k++)
+			{
+				auto t = this->twiddle[k * step] * this->scratch[start + k + half];
+				auto u = this->scratch[start + k];
+				this->scratch[start + k] = u + t;
+				this->scratch[start + k + half] = u - t;
+			}
+		}
+	}
+
+	for(size_t i = 0; i < n / 2; i++)
+	{
+		out[i] = std::abs(this->scratch[i]) * this->windowGain;
+	}
+}
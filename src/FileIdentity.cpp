@@ -0,0 +1,49 @@
+#include "FileIdentity.h"
+
+#include "cinder/Filesystem.h"
+
+namespace
+{
+	// FNV-1a.
+	void mix(uint64_t& hash, const void* data, size_t length)
+	{
+		auto bytes = static_cast<const uint8_t*>(data);
+
+		for(size_t i = 0; i < length; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+}
+
+uint64_t FileIdentity::getKey(const std::string& fileName)
+{
+	uint64_t size = 0;
+	int64_t modified = 0;
+
+	try
+	{
+		size = static_cast<uint64_t>(ci::fs::file_size(fileName));
+		modified = static_cast<int64_t>(ci::fs::last_write_time(fileName));
+	}
+	catch(...)
+	{
+		return 0;
+	}
+
+	// Over the path, size and modification time.
+	uint64_t hash = 14695981039346656037ULL;
+	mix(hash, fileName.data(), fileName.size());
+	mix(hash, &size, sizeof(size));
+	mix(hash, &modified, sizeof(modified));
+
+	return hash == 0 ? 1 : hash;
+}
+
+uint64_t FileIdentity::getPathHash(const std::string& fileName)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	mix(hash, fileName.data(), fileName.size());
+	return hash;
+}
@@ -0,0 +1,199 @@
+#include "FmodMemory.h"
+
+#include "fmod_memoryinfo.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Each tracked block starts with its size and category so free() can account for it.
+	struct BlockHeader
+	{
+		unsigned int size;
+		unsigned int category;
+		unsigned int padding[2];
+	};
+
+	std::vector<uint8_t> pool;
+	bool pooled = false;
+	std::atomic<int64_t> trackedBytes[FmodMemory::Category_End];
+
+	FmodMemory::Category getCategory(FMOD_MEMORY_TYPE type)
+	{
+		if((type & FMOD_MEMORY_STREAM_FILE) != 0)
+		{
+			return FmodMemory::Category_StreamFile;
+		}
+		else if((type & FMOD_MEMORY_STREAM_DECODE) != 0)
+		{
+			return FmodMemory::Category_StreamDecode;
+		}
+		else if((type & FMOD_MEMORY_SAMPLEDATA) != 0)
+		{
+			return FmodMemory::Category_SampleData;
+		}
+		else if((type & FMOD_MEMORY_DSP_OUTPUTBUFFER) != 0)
+		{
+			return FmodMemory::Category_DspBuffer;
+		}
+
+		return FmodMemory::Category_Normal;
+	}
+
+	void* F_CALLBACK trackedAlloc(unsigned int size, FMOD_MEMORY_TYPE type, const char* source)
+	{
+		auto header = static_cast<BlockHeader*>(malloc(sizeof(BlockHeader) + size));
+
+		if(header == nullptr)
+		{
+			return nullptr;
+		}
+
+		header->size = size;
+		header->category = getCategory(type);
+		trackedBytes[header->category] += size;
+		return header + 1;
+	}
+
+	void* F_CALLBACK trackedRealloc(void* p, unsigned int size, FMOD_MEMORY_TYPE type, const char* source)
+	{
+		if(p == nullptr)
+		{
+			return trackedAlloc(size, type, source);
+		}
+
+		auto header = static_cast<BlockHeader*>(p) - 1;
+		auto oldSize = header->size;
+		auto category = header->category;
+
+		header = static_cast<BlockHeader*>(realloc(header, sizeof(BlockHeader) + size));
+
+		if(header == nullptr)
+		{
+			return nullptr;
+		}
+
+		header->size = size;
+		trackedBytes[category] += static_cast<int64_t>(size) - oldSize;
+		return header + 1;
+	}
+
+	void F_CALLBACK trackedFree(void* p, FMOD_MEMORY_TYPE type, const char* source)
+	{
+		if(p == nullptr)
+		{
+			return;
+		}
+
+		auto header = static_cast<BlockHeader*>(p) - 1;
+		trackedBytes[header->category] -= header->size;
+		free(header);
+	}
+}
+
+FmodMemoryBreakdown::FmodMemoryBreakdown() :
+	total(0),
+	streams(0),
+	sounds(0),
+	dsp(0),
+	channels(0),
+	system(0)
+{
+}
+
+bool FmodMemory::initialize(size_t poolBytes)
+{
+	for(int i = 0; i < Category_End; i++)
+	{
+		trackedBytes[i] = 0;
+	}
+
+	if(poolBytes > 0)
+	{
+		// FMOD wants the pool length in multiples of 512 bytes.
+		poolBytes = (poolBytes + 511) & ~static_cast<size_t>(511);
+		pool.resize(poolBytes);
+		pooled = (FMOD::Memory_Initialize(pool.data(), static_cast<int>(poolBytes), nullptr, nullptr, nullptr) == FMOD_OK);
+
+		if(pooled == true)
+		{
+			return true;
+		}
+
+		std::vector<uint8_t>().swap(pool);
+	}
+
+	return FMOD::Memory_Initialize(nullptr, 0, &trackedAlloc, &trackedRealloc, &trackedFree) == FMOD_OK;
+}
+
+bool FmodMemory::isPooled()
+{
+	return pooled;
+}
+
+size_t FmodMemory::getPoolBytes()
+{
+	return pool.size();
+}
+
+void FmodMemory::getStats(int& current, int& peak)
+{
+	current = 0;
+	peak = 0;
+
+	// Non-blocking: a slightly stale figure is fine for display.
+	FMOD::Memory_GetStats(&current, &peak, false);
+}
+
+int64_t FmodMemory::getTrackedBytes(Category category)
+{
+	return trackedBytes[category];
+}
+
+const char* FmodMemory::getCategoryName(Category category)
+{
+	switch(category)
+	{
+		case Category_Normal:
+			return "normal";
+		case Category_StreamFile:
+			return "stream file";
+		case Category_StreamDecode:
+			return "stream decode";
+		case Category_SampleData:
+			return "sample data";
+		case Category_DspBuffer:
+			return "dsp buffer";
+		default:
+			return "unknown";
+	}
+}
+
+FmodMemoryBreakdown FmodMemory::getBreakdown(FMOD::System* system)
+{
+	FmodMemoryBreakdown breakdown;
+
+	if(system == nullptr)
+	{
+		return breakdown;
+	}
+
+	FMOD_MEMORY_USAGE_DETAILS details;
+	memset(&details, 0, sizeof(details));
+
+	if(system->getMemoryInfo(FMOD_MEMBITS_ALL, 0, &breakdown.total, &details) != FMOD_OK)
+	{
+		return breakdown;
+	}
+
+	breakdown.streams = details.streambuffer + details.codec + details.file;
+	breakdown.sounds = details.sound + details.soundgroup + details.secondaryram + details.syncpoint;
+	breakdown.dsp = details.dsp + details.dspconnection + details.dspcodec + details.reverb + details.reverbchannelprops;
+	breakdown.channels = details.channel + details.channelgroup;
+	breakdown.system = details.system + details.output + details.plugins + details.profile + details.string + details.other;
+
+	return breakdown;
+}
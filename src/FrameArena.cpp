@@ -0,0 +1,68 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+
+FrameArena::FrameArena(size_t capacity) :
+	block(capacity),
+	used(0),
+	spilledBytes(0),
+	highWater(0),
+	growCount(0)
+{
+}
+
+void* FrameArena::allocateBytes(size_t bytes, size_t alignment)
+{
+	auto base = reinterpret_cast<uintptr_t>(this->block.data());
+	auto offset = static_cast<size_t>(((base + this->used + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - base);
+
+	if(offset + bytes <= this->block.size())
+	{
+		this->used = offset + bytes;
+		return this->block.data() + offset;
+	}
+
+	// Doesn't fit this frame. Spill to the heap and grow at the next reset.
+	this->spills.push_back(std::vector<uint8_t>(bytes + alignment));
+	this->spilledBytes += bytes + alignment;
+
+	auto spill = reinterpret_cast<uintptr_t>(this->spills.back().data());
+	return reinterpret_cast<void*>((spill + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+}
+
+void FrameArena::reset()
+{
+	auto total = this->used + this->spilledBytes;
+	this->highWater = std::max(this->highWater, total);
+
+	if(this->spills.empty() == false)
+	{
+		// Headroom so slow growth doesn't reallocate every frame.
+		std::vector<uint8_t>(total + total / 2).swap(this->block);
+		this->spills.clear();
+		this->spilledBytes = 0;
+		this->growCount++;
+	}
+
+	this->used = 0;
+}
+
+size_t FrameArena::getCapacity() const
+{
+	return this->block.size();
+}
+
+size_t FrameArena::getUsedBytes() const
+{
+	return this->used + this->spilledBytes;
+}
+
+size_t FrameArena::getHighWater() const
+{
+	return this->highWater;
+}
+
+uint32_t FrameArena::getGrowCount() const
+{
+	return this->growCount;
+}
@@ -0,0 +1,363 @@
+#include "FrameProfiler.h"
+
+#include "cinder/gl/gl.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+	const char* PhaseNames[FrameProfiler::Phase_End] =
+	{
+		"audio update",
+		"fetch",
+		"spectrum",
+		"color",
+		"emission",
+		"particle update",
+		"clear",
+		"particles",
+		"credits",
+		"overlay",
+		"swap"
+	};
+
+	const float PhaseColors[FrameProfiler::Phase_End][3] =
+	{
+		{0.90f, 0.30f, 0.30f},
+		{0.95f, 0.60f, 0.20f},
+		{0.95f, 0.85f, 0.25f},
+		{0.70f, 0.90f, 0.30f},
+		{0.30f, 0.85f, 0.45f},
+		{0.25f, 0.80f, 0.80f},
+		{0.30f, 0.55f, 0.95f},
+		{0.45f, 0.40f, 0.95f},
+		{0.70f, 0.40f, 0.90f},
+		{0.90f, 0.40f, 0.75f},
+		{0.45f, 0.45f, 0.45f}
+	};
+
+	bool isAnalysisPhase(FrameProfiler::Phase phase)
+	{
+		return phase == FrameProfiler::Phase_Fetch || phase == FrameProfiler::Phase_Spectrum || phase == FrameProfiler::Phase_Color;
+	}
+}
+
+FrameProfiler::Frame::Frame() :
+	index(0),
+	start(0),
+	total(0),
+	fmodDsp(0),
+	fmodStream(0),
+	fmodUpdate(0),
+	fmodTotal(0)
+{
+	this->phaseStart.fill(0);
+	this->phaseDuration.fill(0);
+}
+
+FrameProfiler::FrameProfiler() :
+	timer(true),
+	inFrame(false),
+	drawEnd(-1),
+	written(0)
+{
+	this->phaseBegin.fill(0);
+}
+
+void FrameProfiler::beginFrame()
+{
+	auto now = this->getMilliseconds();
+
+	if(this->inFrame == true)
+	{
+		if(this->drawEnd >= 0)
+		{
+			this->current.phaseStart[Phase_Swap] = static_cast<float>(this->drawEnd - this->current.start);
+			this->current.phaseDuration[Phase_Swap] = static_cast<float>(now - this->drawEnd);
+		}
+
+		this->current.total = static_cast<float>(now - this->current.start);
+
+		// Fill the slot before publishing it; readers drop anything overwritten while they copied.
+		auto n = this->written.load(std::memory_order_relaxed);
+		this->ring[n % Capacity] = this->current;
+		this->written.store(n + 1, std::memory_order_release);
+	}
+
+	auto index = this->current.index + (this->inFrame == true ? 1 : 0);
+	this->current = Frame();
+	this->current.index = index;
+	this->current.start = now;
+	this->inFrame = true;
+	this->drawEnd = -1;
+}
+
+void FrameProfiler::endDraw()
+{
+	this->drawEnd = this->getMilliseconds();
+}
+
+void FrameProfiler::begin(Phase phase)
+{
+	this->phaseBegin[phase] = this->getMilliseconds();
+}
+
+void FrameProfiler::end(Phase phase)
+{
+	auto elapsed = this->getMilliseconds() - this->phaseBegin[phase];
+
+	// A phase can run more than once a frame; keep where it first started.
+	if(this->current.phaseDuration[phase] == 0)
+	{
+		this->current.phaseStart[phase] = static_cast<float>(this->phaseBegin[phase] - this->current.start);
+	}
+
+	this->current.phaseDuration[phase] += static_cast<float>(elapsed);
+}
+
+void FrameProfiler::add(Phase phase, double seconds)
+{
+	if(this->current.phaseDuration[phase] == 0)
+	{
+		this->current.phaseStart[phase] = static_cast<float>(this->getMilliseconds() - this->current.start);
+	}
+
+	this->current.phaseDuration[phase] += static_cast<float>(seconds * 1000.0);
+}
+
+void FrameProfiler::sampleFmod(FMOD::System* system)
+{
+	if(system != nullptr)
+	{
+		auto geometry = 0.0f;
+		system->getCPUUsage(&this->current.fmodDsp, &this->current.fmodStream, &geometry, &this->current.fmodUpdate, &this->current.fmodTotal);
+	}
+}
+
+std::vector<FrameProfiler::Frame> FrameProfiler::getFrames(size_t count) const
+{
+	auto end = this->written.load(std::memory_order_acquire);
+
+	// Leave a margin so the writer is unlikely to lap the copy.
+	count = std::min(count, Capacity - 16);
+	auto first = end > count ? end - count : 0;
+
+	std::vector<Frame> frames;
+	frames.reserve(static_cast<size_t>(end - first));
+
+	for(auto i = first; i < end; i++)
+	{
+		frames.push_back(this->ring[i % Capacity]);
+	}
+
+	// Anything the writer reached while we were copying may be torn, including
+	// the slot it is filling now: frame 'after' goes where 'after - Capacity' was.
+	auto after = this->written.load(std::memory_order_acquire);
+
+	if(after >= first + Capacity)
+	{
+		auto torn = static_cast<size_t>(std::min<uint64_t>(after - first - Capacity + 1, frames.size()));
+		frames.erase(std::begin(frames), std::begin(frames) + torn);
+	}
+
+	return frames;
+}
+
+bool FrameProfiler::getLastFrame(Frame& frame) const
+{
+	auto end = this->written.load(std::memory_order_acquire);
+
+	if(end == 0)
+	{
+		return false;
+	}
+
+	// The slot behind the write index won't be touched until a full lap later.
+	frame = this->ring[(end - 1) % Capacity];
+	return true;
+}
+
+Distribution FrameProfiler::summarize(const std::vector<Frame>& frames, Phase phase)
+{
+	std::vector<double> samples;
+	samples.reserve(frames.size());
+
+	std::for_each(std::begin(frames), std::end(frames),
+		[&samples, phase](const Frame& frame)
+		{
+			samples.push_back(phase == Phase_End ? frame.total : frame.phaseDuration[phase]);
+		});
+
+	return Statistics::summarize(samples);
+}
+
+const char* FrameProfiler::getPhaseName(Phase phase)
+{
+	return phase < Phase_End ? PhaseNames[phase] : "frame";
+}
+
+ci::ColorA FrameProfiler::getPhaseColor(Phase phase)
+{
+	return phase < Phase_End ? ci::ColorA(PhaseColors[phase][0], PhaseColors[phase][1], PhaseColors[phase][2]) : ci::ColorA(1.0f, 1.0f, 1.0f);
+}
+
+bool FrameProfiler::writeCsv(const std::string& fileName) const
+{
+	std::ofstream os;
+	os.open(fileName.c_str());
+
+	if(os.is_open() == false)
+	{
+		return false;
+	}
+
+	os << "frame,start_ms,total_ms";
+
+	for(int i = 0; i < Phase_End; i++)
+	{
+		std::string name = PhaseNames[i];
+		std::replace(std::begin(name), std::end(name), ' ', '_');
+		os << "," << name << "_ms";
+	}
+
+	os << ",fmod_dsp_pct,fmod_stream_pct,fmod_update_pct,fmod_total_pct\n";
+
+	auto frames = this->getFrames();
+
+	std::for_each(std::begin(frames), std::end(frames),
+		[&os](const Frame& frame)
+		{
+			os << frame.index << "," << frame.start << "," << frame.total;
+
+			for(int i = 0; i < Phase_End; i++)
+			{
+				os << "," << frame.phaseDuration[i];
+			}
+
+			os << "," << frame.fmodDsp << "," << frame.fmodStream << "," << frame.fmodUpdate << "," << frame.fmodTotal << "\n";
+		});
+
+	return os.good();
+}
+
+bool FrameProfiler::writeChromeTrace(const std::string& fileName) const
+{
+	std::ofstream os;
+	os.open(fileName.c_str());
+
+	if(os.is_open() == false)
+	{
+		return false;
+	}
+
+	// Trace Event Format: complete ("X") events in microseconds, UI thread as tid 1,
+	// analysis thread work as tid 2, FMOD CPU usage as a counter track.
+	os << "{\"traceEvents\":[\n";
+	os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"UI\"}},\n";
+	os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"Analysis\"}}";
+
+	auto frames = this->getFrames();
+
+	std::for_each(std::begin(frames), std::end(frames),
+		[&os](const Frame& frame)
+		{
+			auto start = frame.start * 1000.0;
+
+			os << ",\n{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << start 
+				<< ",\"dur\":" << frame.total * 1000.0 << ",\"args\":{\"index\":" << frame.index << "}}";
+
+			for(int i = 0; i < Phase_End; i++)
+			{
+				if(frame.phaseDuration[i] > 0)
+				{
+					os << ",\n{\"name\":\"" << PhaseNames[i] << "\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":" 
+						<< (isAnalysisPhase(static_cast<Phase>(i)) == true ? 2 : 1)
+						<< ",\"ts\":" << start + frame.phaseStart[i] * 1000.0 << ",\"dur\":" << frame.phaseDuration[i] * 1000.0 << "}";
+				}
+			}
+
+			os << ",\n{\"name\":\"FMOD CPU\",\"ph\":\"C\",\"pid\":1,\"ts\":" << start << ",\"args\":{\"dsp\":" << frame.fmodDsp 
+				<< ",\"stream\":" << frame.fmodStream << ",\"update\":" << frame.fmodUpdate << "}}";
+		});
+
+	os << "\n]}\n";
+	return os.good();
+}
+
+void FrameProfiler::draw(float x, float y, float width, float height, size_t frameCount) const
+{
+	auto frames = this->getFrames(frameCount);
+
+	if(frames.empty() == true || frameCount == 0)
+	{
+		return;
+	}
+
+	// Two 60 Hz frames fill the graph.
+	auto scale = height / 33.3f;
+	auto columnWidth = width / static_cast<float>(frameCount);
+	auto left = x + width - columnWidth * frames.size();
+
+	glBegin(GL_QUADS);
+	{
+		glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+		glVertex2f(x, y);
+		glVertex2f(x + width, y);
+		glVertex2f(x + width, y + height);
+		glVertex2f(x, y + height);
+
+		for(size_t i = 0; i < frames.size(); i++)
+		{
+			auto x0 = left + columnWidth * i;
+			auto x1 = x0 + std::max(columnWidth - 1.0f, 1.0f);
+			auto bottom = y + height;
+
+			// Analysis thread phases overlap the UI thread and are left out of the stack.
+			for(int phase = 0; phase < Phase_End && bottom > y; phase++)
+			{
+				if(isAnalysisPhase(static_cast<Phase>(phase)) == true)
+				{
+					continue;
+				}
+
+				auto top = std::max(bottom - frames[i].phaseDuration[phase] * scale, y);
+
+				glColor4f(PhaseColors[phase][0], PhaseColors[phase][1], PhaseColors[phase][2], 0.9f);
+				glVertex2f(x0, top);
+				glVertex2f(x1, top);
+				glVertex2f(x1, bottom);
+				glVertex2f(x0, bottom);
+
+				bottom = top;
+			}
+		}
+	}
+	glEnd();
+
+	// 60 Hz budget.
+	glColor4f(1.0f, 1.0f, 1.0f, 0.5f);
+	glBegin(GL_LINES);
+	{
+		glVertex2f(x, y + height - 16.7f * scale);
+		glVertex2f(x + width, y + height - 16.7f * scale);
+	}
+	glEnd();
+}
+
+double FrameProfiler::getMilliseconds() const
+{
+	return this->timer.getSeconds() * 1000.0;
+}
+
+ProfileScope::ProfileScope(FrameProfiler& profiler, FrameProfiler::Phase phase) :
+	profiler(profiler),
+	phase(phase)
+{
+	this->profiler.begin(this->phase);
+}
+
+ProfileScope::~ProfileScope()
+{
+	this->profiler.end(this->phase);
+}
@@ -0,0 +1,203 @@
+#include "IdleMonitor.h"
+
+#include "cinder/app/AppNative.h"
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+IdleMonitor::IdleMonitor() :
+	enabled(true),
+	state(State_Active),
+	occluded(false),
+	timer(true),
+	stretchStart(0),
+	stretchCpuStart(IdleMonitor::getProcessCpuSeconds()),
+	activeSeconds(0),
+	activeCpuSeconds(0),
+	idleSeconds(0),
+	idleCpuSeconds(0)
+{
+}
+
+void IdleMonitor::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+}
+
+bool IdleMonitor::isEnabled() const
+{
+	return this->enabled;
+}
+
+bool IdleMonitor::update(bool paused, bool stopped, bool muted, bool occluded, size_t particleCount)
+{
+	auto state = State_Active;
+	auto quiet = (paused == true || stopped == true || muted == true);
+
+	if(this->enabled == true)
+	{
+		if(occluded == true)
+		{
+			state = State_Idle;
+		}
+		else if(quiet == true)
+		{
+			state = (particleCount > 0) ? State_Decaying : State_Idle;
+		}
+	}
+
+	this->occluded = (this->enabled == true && occluded == true);
+
+	if(state == this->state)
+	{
+		return false;
+	}
+
+	// Charge the stretch that just ended; decaying still renders, so it counts as active.
+	auto wasIdle = (this->state == State_Idle);
+	auto isIdle = (state == State_Idle);
+
+	if(wasIdle != isIdle)
+	{
+		auto seconds = this->timer.getSeconds() - this->stretchStart;
+		auto cpu = IdleMonitor::getProcessCpuSeconds() - this->stretchCpuStart;
+		this->account();
+
+		ci::app::console() << (isIdle == true ? "Idle" : "Resumed") << " after " << seconds << " s " << (wasIdle == true ? "idle" : "active") 
+			<< " at " << (seconds > 0 ? 100.0 * cpu / seconds : 0.0) << "% CPU (" 
+			<< (occluded == true ? "occluded" : (paused == true ? "paused" : (muted == true ? "muted" : (stopped == true ? "stopped" : "playing")))) << ")" << std::endl;
+	}
+
+	this->state = state;
+	return true;
+}
+
+IdleMonitor::State IdleMonitor::getState() const
+{
+	return this->state;
+}
+
+const char* IdleMonitor::getStateName(State state)
+{
+	switch(state)
+	{
+		case State_Active:
+			return "active";
+
+		case State_Decaying:
+			return "decaying";
+
+		case State_Idle:
+			return "idle";
+
+		default:
+			return "";
+	}
+}
+
+bool IdleMonitor::isEmitting() const
+{
+	return this->state == State_Active;
+}
+
+bool IdleMonitor::isOccluded() const
+{
+	return this->occluded;
+}
+
+double IdleMonitor::getActiveCpuPercent() const
+{
+	auto seconds = this->activeSeconds;
+	auto cpu = this->activeCpuSeconds;
+
+	if(this->state != State_Idle)
+	{
+		seconds += this->timer.getSeconds() - this->stretchStart;
+		cpu += IdleMonitor::getProcessCpuSeconds() - this->stretchCpuStart;
+	}
+
+	return seconds > 0 ? 100.0 * cpu / seconds : 0.0;
+}
+
+double IdleMonitor::getIdleCpuPercent() const
+{
+	auto seconds = this->idleSeconds;
+	auto cpu = this->idleCpuSeconds;
+
+	if(this->state == State_Idle)
+	{
+		seconds += this->timer.getSeconds() - this->stretchStart;
+		cpu += IdleMonitor::getProcessCpuSeconds() - this->stretchCpuStart;
+	}
+
+	return seconds > 0 ? 100.0 * cpu / seconds : 0.0;
+}
+
+std::string IdleMonitor::describe() const
+{
+	if(this->enabled == false)
+	{
+		return "Idle: off";
+	}
+
+	return std::string("Idle: ") + IdleMonitor::getStateName(this->state) 
+		+ ", CPU " + std::to_string(this->getActiveCpuPercent()) + "% active, " + std::to_string(this->getIdleCpuPercent()) + "% idle";
+}
+
+double IdleMonitor::getProcessCpuSeconds()
+{
+#if defined(_WIN32)
+	FILETIME creation;
+	FILETIME exit;
+	FILETIME kernel;
+	FILETIME user;
+
+	if(GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user) == FALSE)
+	{
+		return 0;
+	}
+
+	auto ticks = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32 | kernel.dwLowDateTime)
+		+ (static_cast<uint64_t>(user.dwHighDateTime) << 32 | user.dwLowDateTime);
+
+	// 100 ns units.
+	return static_cast<double>(ticks) / 10000000.0;
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+#endif
+}
+
+bool IdleMonitor::isMinimized(void* nativeWindow)
+{
+#if defined(_WIN32)
+	return nativeWindow != nullptr && IsIconic(static_cast<HWND>(nativeWindow)) != FALSE;
+#else
+	return false;
+#endif
+}
+
+void IdleMonitor::account()
+{
+	auto now = this->timer.getSeconds();
+	auto cpu = IdleMonitor::getProcessCpuSeconds();
+
+	if(this->state == State_Idle)
+	{
+		this->idleSeconds += now - this->stretchStart;
+		this->idleCpuSeconds += cpu - this->stretchCpuStart;
+	}
+	else
+	{
+		this->activeSeconds += now - this->stretchStart;
+		this->activeCpuSeconds += cpu - this->stretchCpuStart;
+	}
+
+	this->stretchStart = now;
+	this->stretchCpuStart = cpu;
+}
@@ -0,0 +1,315 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+namespace
+{
+	// PrefetchVirtualMemory is Windows 8 and later, so it is looked up rather than linked.
+	struct MemoryRange
+	{
+		void* address;
+		SIZE_T bytes;
+	};
+
+	typedef BOOL (WINAPI* PrefetchVirtualMemoryFunction)(HANDLE process, ULONG_PTR count, MemoryRange* ranges, ULONG flags);
+
+	const PrefetchVirtualMemoryFunction prefetchVirtualMemory = reinterpret_cast<PrefetchVirtualMemoryFunction>(
+		::GetProcAddress(::GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory"));
+}
+#endif
+
+MappedFile::MappedFile() :
+	base(nullptr),
+	viewOffset(0),
+	viewLength(0),
+	window(0),
+	length(0),
+#if defined(_WIN32)
+	file(INVALID_HANDLE_VALUE),
+	mapping(nullptr)
+#else
+	file(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	this->close();
+}
+
+bool MappedFile::open(const std::string& fileName, uint64_t window)
+{
+	this->close();
+	this->window = window;
+
+#if defined(_WIN32)
+	this->file = ::CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if(this->file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+#else
+	this->file = ::open(fileName.c_str(), O_RDONLY);
+
+	if(this->file < 0)
+	{
+		return false;
+	}
+#endif
+
+	return this->map();
+}
+
+bool MappedFile::open(const std::wstring& fileName, uint64_t window)
+{
+	this->close();
+	this->window = window;
+
+#if defined(_WIN32)
+	this->file = ::CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if(this->file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	return this->map();
+#else
+	// Paths are bytes here; convert through the current locale.
+	std::vector<char> narrow(fileName.size() * MB_CUR_MAX + 1);
+
+	if(std::wcstombs(narrow.data(), fileName.c_str(), narrow.size()) == static_cast<size_t>(-1))
+	{
+		return false;
+	}
+
+	return this->open(std::string(narrow.data()), window);
+#endif
+}
+
+bool MappedFile::map()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER fileSize;
+	if(::GetFileSizeEx(this->file, &fileSize) == FALSE || fileSize.QuadPart == 0)
+	{
+		this->close();
+		return false;
+	}
+
+	this->length = static_cast<uint64_t>(fileSize.QuadPart);
+	this->mapping = ::CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if(this->mapping == nullptr)
+	{
+		this->close();
+		return false;
+	}
+#else
+	struct stat info;
+	if(::fstat(this->file, &info) != 0 || info.st_size == 0)
+	{
+		this->close();
+		return false;
+	}
+
+	this->length = static_cast<uint64_t>(info.st_size);
+#endif
+
+	if(this->mapView(0, this->window == 0 ? this->length : std::min(this->window, this->length)) == false)
+	{
+		this->close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MappedFile::mapView(uint64_t offset, uint64_t count)
+{
+	this->unmapView();
+
+	// Views have to start on an allocation boundary: 64 KB on Windows, a page elsewhere.
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	::GetSystemInfo(&info);
+	uint64_t granularity = info.dwAllocationGranularity;
+#else
+	auto granularity = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+#endif
+
+	auto start = offset - offset % granularity;
+	auto bytes = std::min(this->length - start, std::max(this->window, offset + count - start));
+
+	// A window beyond what a 32 bit size can hold would never map anyway.
+	if(bytes > static_cast<uint64_t>(static_cast<size_t>(-1)))
+	{
+		return false;
+	}
+
+#if defined(_WIN32)
+	auto address = ::MapViewOfFile(this->mapping, FILE_MAP_READ, static_cast<DWORD>(start >> 32), static_cast<DWORD>(start), static_cast<SIZE_T>(bytes));
+	this->base = static_cast<const uint8_t*>(address);
+#else
+	auto address = ::mmap(nullptr, static_cast<size_t>(bytes), PROT_READ, MAP_SHARED, this->file, static_cast<off_t>(start));
+	this->base = (address == MAP_FAILED) ? nullptr : static_cast<const uint8_t*>(address);
+#endif
+
+	if(this->base == nullptr)
+	{
+		return false;
+	}
+
+	this->viewOffset = start;
+	this->viewLength = bytes;
+	return true;
+}
+
+void MappedFile::unmapView()
+{
+	if(this->base != nullptr)
+	{
+#if defined(_WIN32)
+		::UnmapViewOfFile(this->base);
+#else
+		::munmap(const_cast<uint8_t*>(this->base), static_cast<size_t>(this->viewLength));
+#endif
+	}
+
+	this->base = nullptr;
+	this->viewOffset = 0;
+	this->viewLength = 0;
+}
+
+void MappedFile::close()
+{
+	this->unmapView();
+
+#if defined(_WIN32)
+	if(this->mapping != nullptr)
+	{
+		::CloseHandle(this->mapping);
+		this->mapping = nullptr;
+	}
+
+	if(this->file != INVALID_HANDLE_VALUE)
+	{
+		::CloseHandle(this->file);
+		this->file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if(this->file >= 0)
+	{
+		::close(this->file);
+		this->file = -1;
+	}
+#endif
+
+	this->length = 0;
+}
+
+bool MappedFile::isOpen() const
+{
+	return this->base != nullptr;
+}
+
+const uint8_t* MappedFile::data() const
+{
+	return this->window == 0 ? this->base : nullptr;
+}
+
+uint64_t MappedFile::size() const
+{
+	return this->length;
+}
+
+const uint8_t* MappedFile::view(uint64_t offset, uint64_t count)
+{
+	if(this->base == nullptr || offset > this->length || count > this->length - offset)
+	{
+		return nullptr;
+	}
+
+	if(offset < this->viewOffset || offset + count > this->viewOffset + this->viewLength)
+	{
+		if(this->mapView(offset, count) == false)
+		{
+			return nullptr;
+		}
+	}
+
+	return this->base + (offset - this->viewOffset);
+}
+
+void MappedFile::prefetch(uint64_t offset, uint64_t count)
+{
+	if(this->base == nullptr || offset >= this->length)
+	{
+		return;
+	}
+
+	count = std::min(count, this->length - offset);
+	auto p = this->view(offset, count);
+
+	if(p == nullptr)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	// Touch one byte per page; the fault brings it into the page cache.
+	volatile uint8_t sink = 0;
+
+	for(uint64_t i = 0; i < count; i += 4096)
+	{
+		sink ^= p[i];
+	}
+#else
+	// madvise wants a page aligned start.
+	auto pageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+	auto start = offset - offset % pageSize;
+	::madvise(const_cast<uint8_t*>(p) - (offset - start), static_cast<size_t>(offset + count - start), MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::advise(uint64_t offset, uint64_t count) const
+{
+	// Only what the current view covers; the rest is asked for once it is mapped.
+	auto end = std::min(offset + count, this->viewOffset + this->viewLength);
+
+	if(this->base == nullptr || offset < this->viewOffset || offset >= end)
+	{
+		return;
+	}
+
+	count = end - offset;
+
+#if defined(_WIN32)
+	if(prefetchVirtualMemory != nullptr)
+	{
+		MemoryRange range;
+		range.address = const_cast<uint8_t*>(this->base) + (offset - this->viewOffset);
+		range.bytes = static_cast<SIZE_T>(count);
+		prefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	// madvise wants a page aligned start.
+	auto pageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+	auto start = offset - offset % pageSize;
+	::madvise(const_cast<uint8_t*>(this->base) + (start - this->viewOffset), static_cast<size_t>(offset + count - start), MADV_WILLNEED);
+#endif
+}
@@ -0,0 +1,307 @@
+#include "MappedFileSystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// The callbacks carry no system pointer, only per-file data.
+	MappedFileSystem* installed = nullptr;
+}
+
+MappedFileSystem::MappedFileSystem() :
+	system(nullptr),
+	readahead(1024 * 1024),
+	busyHandle(nullptr),
+	bytesRead(0),
+	asyncReads(0),
+	openFiles(0),
+	running(false)
+{
+}
+
+MappedFileSystem::~MappedFileSystem()
+{
+	this->uninstall();
+}
+
+bool MappedFileSystem::install(FMOD::System* system, uint32_t readahead)
+{
+	if(installed != nullptr && installed != this)
+	{
+		return false;
+	}
+
+	this->uninstall();
+
+	auto result = system->setFileSystem(
+		&MappedFileSystem::openCallback, 
+		&MappedFileSystem::closeCallback, 
+		&MappedFileSystem::readCallback, 
+		&MappedFileSystem::seekCallback, 
+		&MappedFileSystem::asyncReadCallback, 
+		&MappedFileSystem::asyncCancelCallback, 
+		2048);
+
+	if(result != FMOD_OK)
+	{
+		return false;
+	}
+
+	installed = this;
+	this->system = system;
+	this->readahead = readahead;
+	this->running = true;
+	this->thread = std::thread(&MappedFileSystem::run, this);
+	return true;
+}
+
+void MappedFileSystem::uninstall()
+{
+	if(this->system == nullptr)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->running = false;
+	}
+
+	this->condition.notify_all();
+
+	if(this->thread.joinable() == true)
+	{
+		this->thread.join();
+	}
+
+	// Back to FMOD's own file access.
+	this->system->setFileSystem(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 2048);
+	this->system = nullptr;
+	installed = nullptr;
+}
+
+uint64_t MappedFileSystem::getBytesRead() const
+{
+	return this->bytesRead;
+}
+
+uint64_t MappedFileSystem::getAsyncReads() const
+{
+	return this->asyncReads;
+}
+
+size_t MappedFileSystem::getQueueDepth() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->queue.size();
+}
+
+uint32_t MappedFileSystem::getOpenFiles() const
+{
+	return this->openFiles;
+}
+
+void MappedFileSystem::run()
+{
+	while(true)
+	{
+		FMOD_ASYNCREADINFO* info = nullptr;
+		File* file = nullptr;
+		unsigned int offset = 0;
+		unsigned int sizeBytes = 0;
+		void* buffer = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			while(this->running == true && this->queue.empty() == true)
+			{
+				this->condition.wait(lock);
+			}
+
+			if(this->running == false && this->queue.empty() == true)
+			{
+				break;
+			}
+
+			// Most urgent first; FMOD raises the priority of reads it is about to starve on.
+			auto next = std::max_element(std::begin(this->queue), std::end(this->queue),
+				[](const FMOD_ASYNCREADINFO* a, const FMOD_ASYNCREADINFO* b)
+				{
+					return a->priority < b->priority;
+				});
+
+			info = *next;
+			this->queue.erase(next);
+			this->busyHandle = info->handle;
+
+			// FMOD may reuse the request as soon as its result is set, so nothing is read from it after that.
+			file = static_cast<File*>(info->handle);
+			offset = info->offset;
+			sizeBytes = info->sizebytes;
+			buffer = info->buffer;
+		}
+
+		unsigned int count = 0;
+		this->read(file, offset, buffer, sizeBytes, &count);
+		this->asyncReads++;
+
+		info->bytesread = count;
+		info->result = (count < sizeBytes) ? FMOD_ERR_FILE_EOF : FMOD_OK;
+
+		// Ask for what FMOD will most likely read next, without holding up urgent reads behind the faults.
+		auto end = static_cast<uint64_t>(offset) + count;
+
+		if(this->readahead > 0 && end + this->readahead > file->prefetched)
+		{
+			std::lock_guard<std::mutex> lock(file->mutex);
+			auto start = std::max(end, file->prefetched);
+			file->file.advise(start, end + this->readahead - start);
+			file->prefetched = end + this->readahead;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->busyHandle = nullptr;
+		}
+
+		this->idle.notify_all();
+	}
+}
+
+void MappedFileSystem::read(File* file, unsigned int offset, void* buffer, unsigned int count, unsigned int* bytesRead)
+{
+	std::lock_guard<std::mutex> lock(file->mutex);
+
+	auto size = file->file.size();
+	auto available = (offset < size) ? static_cast<unsigned int>(std::min<uint64_t>(count, size - offset)) : 0u;
+	auto data = file->file.view(offset, available);
+
+	// A view that can't be mapped reads as the end of the file.
+	available = (data != nullptr) ? available : 0;
+
+	if(available > 0)
+	{
+		memcpy(buffer, data, available);
+	}
+
+	*bytesRead = available;
+	this->bytesRead += available;
+}
+
+FMOD_RESULT F_CALLBACK MappedFileSystem::openCallback(const char* name, int unicode, unsigned int* fileSize, void** handle, void** userData)
+{
+	if(name == nullptr)
+	{
+		return FMOD_ERR_FILE_NOTFOUND;
+	}
+
+	auto file = new File();
+	file->position = 0;
+	file->prefetched = 0;
+
+	// With FMOD_UNICODE the name is really a wide string. Only a window is mapped,
+	// so a long mix doesn't need its whole length of address space.
+	auto opened = (unicode != 0) ? file->file.open(std::wstring(reinterpret_cast<const wchar_t*>(name)), MappedFile::StreamWindow) 
+		: file->file.open(std::string(name), MappedFile::StreamWindow);
+
+	// FMOD Ex offsets are 32 bit.
+	if(opened == false || file->file.size() > 0xffffffffULL)
+	{
+		delete file;
+		return FMOD_ERR_FILE_NOTFOUND;
+	}
+
+	*fileSize = static_cast<unsigned int>(file->file.size());
+	*handle = file;
+	*userData = installed;
+
+	if(installed != nullptr)
+	{
+		installed->openFiles++;
+	}
+
+	return FMOD_OK;
+}
+
+FMOD_RESULT F_CALLBACK MappedFileSystem::closeCallback(void* handle, void* userData)
+{
+	auto fileSystem = static_cast<MappedFileSystem*>(userData);
+
+	if(fileSystem != nullptr)
+	{
+		fileSystem->openFiles--;
+	}
+
+	delete static_cast<File*>(handle);
+	return FMOD_OK;
+}
+
+FMOD_RESULT F_CALLBACK MappedFileSystem::readCallback(void* handle, void* buffer, unsigned int sizeBytes, unsigned int* bytesRead, void* userData)
+{
+	auto fileSystem = static_cast<MappedFileSystem*>(userData);
+	auto file = static_cast<File*>(handle);
+
+	if(fileSystem == nullptr || file == nullptr)
+	{
+		return FMOD_ERR_INVALID_PARAM;
+	}
+
+	fileSystem->read(file, file->position, buffer, sizeBytes, bytesRead);
+	file->position += *bytesRead;
+
+	return (*bytesRead < sizeBytes) ? FMOD_ERR_FILE_EOF : FMOD_OK;
+}
+
+FMOD_RESULT F_CALLBACK MappedFileSystem::seekCallback(void* handle, unsigned int position, void* userData)
+{
+	static_cast<File*>(handle)->position = position;
+	return FMOD_OK;
+}
+
+FMOD_RESULT F_CALLBACK MappedFileSystem::asyncReadCallback(FMOD_ASYNCREADINFO* info, void* userData)
+{
+	auto fileSystem = static_cast<MappedFileSystem*>(userData);
+
+	if(fileSystem == nullptr)
+	{
+		return FMOD_ERR_INVALID_PARAM;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(fileSystem->mutex);
+		fileSystem->queue.push_back(info);
+	}
+
+	fileSystem->condition.notify_one();
+	return FMOD_OK;
+}
+
+FMOD_RESULT F_CALLBACK MappedFileSystem::asyncCancelCallback(void* handle, void* userData)
+{
+	auto fileSystem = static_cast<MappedFileSystem*>(userData);
+
+	if(fileSystem == nullptr)
+	{
+		return FMOD_OK;
+	}
+
+	// FMOD may free the request structures as soon as this returns, so drop
+	// queued reads for the file and wait out one in progress.
+	std::unique_lock<std::mutex> lock(fileSystem->mutex);
+
+	auto it = std::remove_if(std::begin(fileSystem->queue), std::end(fileSystem->queue),
+		[handle](const FMOD_ASYNCREADINFO* info)
+		{
+			return info->handle == handle;
+		});
+
+	fileSystem->queue.erase(it, std::end(fileSystem->queue));
+
+	while(fileSystem->busyHandle == handle)
+	{
+		fileSystem->idle.wait(lock);
+	}
+
+	return FMOD_OK;
+}
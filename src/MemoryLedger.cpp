@@ -0,0 +1,87 @@
+#include "MemoryLedger.h"
+
+namespace
+{
+	// Zero-initialized before anything runs, so allocations from static constructors are safe.
+	std::atomic<int64_t> live[MemoryLedger::Subsystem_End];
+	std::atomic<int64_t> peak[MemoryLedger::Subsystem_End];
+	std::atomic<uint64_t> allocated[MemoryLedger::Subsystem_End];
+	std::atomic<uint64_t> allocations[MemoryLedger::Subsystem_End];
+
+	void raisePeak(MemoryLedger::Subsystem subsystem, int64_t bytes)
+	{
+		auto current = peak[subsystem].load(std::memory_order_relaxed);
+
+		while(bytes > current && peak[subsystem].compare_exchange_weak(current, bytes, std::memory_order_relaxed) == false)
+		{
+		}
+	}
+}
+
+MemoryStats::MemoryStats() :
+	live(0),
+	peak(0),
+	allocated(0),
+	allocations(0)
+{
+}
+
+void MemoryLedger::allocate(Subsystem subsystem, size_t bytes)
+{
+	auto now = live[subsystem].fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed) + static_cast<int64_t>(bytes);
+	allocated[subsystem].fetch_add(bytes, std::memory_order_relaxed);
+	allocations[subsystem].fetch_add(1, std::memory_order_relaxed);
+	raisePeak(subsystem, now);
+}
+
+void MemoryLedger::release(Subsystem subsystem, size_t bytes)
+{
+	live[subsystem].fetch_sub(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+}
+
+void MemoryLedger::set(Subsystem subsystem, int64_t bytes)
+{
+	auto previous = live[subsystem].exchange(bytes, std::memory_order_relaxed);
+
+	if(bytes > previous)
+	{
+		allocated[subsystem].fetch_add(static_cast<uint64_t>(bytes - previous), std::memory_order_relaxed);
+		allocations[subsystem].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	raisePeak(subsystem, bytes);
+}
+
+MemoryStats MemoryLedger::getStats(Subsystem subsystem)
+{
+	MemoryStats stats;
+	stats.live = live[subsystem].load(std::memory_order_relaxed);
+	stats.peak = peak[subsystem].load(std::memory_order_relaxed);
+	stats.allocated = allocated[subsystem].load(std::memory_order_relaxed);
+	stats.allocations = allocations[subsystem].load(std::memory_order_relaxed);
+	return stats;
+}
+
+const char* MemoryLedger::getSubsystemName(Subsystem subsystem)
+{
+	switch(subsystem)
+	{
+		case Subsystem_Particles:
+			return "particles";
+
+		case Subsystem_Analysis:
+			return "analysis";
+
+		case Subsystem_Textures:
+			return "textures";
+
+		case Subsystem_Playlist:
+			return "playlist";
+
+		case Subsystem_Fmod:
+			return "fmod";
+
+		default:
+			return "";
+	}
+}
@@ -0,0 +1,167 @@
+#include "MemoryMonitor.h"
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	std::string megabytes(double bytes)
+	{
+		auto tenths = static_cast<long long>(bytes * 10.0 / (1024.0 * 1024.0));
+		return std::to_string(tenths / 10) + "." + std::to_string(std::abs(tenths % 10)) + " MB";
+	}
+}
+
+MemoryMonitor::Sample::Sample() :
+	time(0)
+{
+}
+
+MemoryMonitor::MemoryMonitor() :
+	timer(true),
+	interval(10.0),
+	head(0),
+	count(0)
+{
+	this->budgets.fill(0);
+	this->maxSlopes.fill(0);
+	this->configure(this->interval, 360);
+}
+
+void MemoryMonitor::configure(double interval, size_t historyLength)
+{
+	this->interval = std::max(interval, 0.1);
+	this->history.assign(std::max(historyLength, static_cast<size_t>(2)), Sample());
+	this->head = 0;
+	this->count = 0;
+}
+
+bool MemoryMonitor::openStats(const std::string& fileName)
+{
+	this->statsFile.open(fileName.c_str());
+
+	if(this->statsFile.is_open() == false)
+	{
+		return false;
+	}
+
+	this->statsFile << "seconds,subsystem,live_bytes,peak_bytes,allocated_bytes,allocations,budget_bytes,over_budget\n";
+	return true;
+}
+
+bool MemoryMonitor::update()
+{
+	auto now = this->timer.getSeconds();
+
+	if(this->count > 0 && now - this->getSample(0).time < this->interval)
+	{
+		return false;
+	}
+
+	// Overwrites the oldest sample once the ring is full.
+	this->head = (this->head + 1) % this->history.size();
+	this->count = std::min(this->count + 1, this->history.size());
+
+	Sample& sample = this->history[this->head];
+	sample.time = now;
+
+	for(int i = 0; i < MemoryLedger::Subsystem_End; i++)
+	{
+		auto subsystem = static_cast<MemoryLedger::Subsystem>(i);
+		sample.stats[i] = MemoryLedger::getStats(subsystem);
+
+		if(this->statsFile.is_open() == true)
+		{
+			this->statsFile << now << "," << MemoryLedger::getSubsystemName(subsystem) << "," << sample.stats[i].live << "," << sample.stats[i].peak 
+				<< "," << sample.stats[i].allocated << "," << sample.stats[i].allocations << "," << this->budgets[i] 
+				<< "," << (this->budgets[i] > 0 && sample.stats[i].live > this->budgets[i] ? 1 : 0) << "\n";
+		}
+	}
+
+	// A long run shouldn't lose the stats to a crash.
+	this->statsFile.flush();
+	return true;
+}
+
+double MemoryMonitor::getSeconds() const
+{
+	return this->timer.getSeconds();
+}
+
+MemoryStats MemoryMonitor::getStats(MemoryLedger::Subsystem subsystem) const
+{
+	return this->count == 0 ? MemoryStats() : this->getSample(0).stats[subsystem];
+}
+
+double MemoryMonitor::getAllocationRate(MemoryLedger::Subsystem subsystem) const
+{
+	if(this->count < 2)
+	{
+		return 0;
+	}
+
+	const Sample& last = this->getSample(0);
+	const Sample& previous = this->getSample(1);
+
+	return static_cast<double>(last.stats[subsystem].allocated - previous.stats[subsystem].allocated) / (last.time - previous.time);
+}
+
+double MemoryMonitor::getSlope(MemoryLedger::Subsystem subsystem, double since) const
+{
+	std::vector<double> hours;
+	std::vector<double> bytes;
+
+	for(size_t age = this->count; age > 0; age--)
+	{
+		const Sample& sample = this->getSample(age - 1);
+
+		if(sample.time >= since)
+		{
+			hours.push_back(sample.time / 3600.0);
+			bytes.push_back(static_cast<double>(sample.stats[subsystem].live));
+		}
+	}
+
+	return Statistics::slope(hours, bytes);
+}
+
+void MemoryMonitor::setLimits(MemoryLedger::Subsystem subsystem, int64_t budget, double maxSlope)
+{
+	this->budgets[subsystem] = std::max<int64_t>(budget, 0);
+	this->maxSlopes[subsystem] = std::max(maxSlope, 0.0);
+}
+
+int64_t MemoryMonitor::getBudget(MemoryLedger::Subsystem subsystem) const
+{
+	return this->budgets[subsystem];
+}
+
+double MemoryMonitor::getMaxSlope(MemoryLedger::Subsystem subsystem) const
+{
+	return this->maxSlopes[subsystem];
+}
+
+bool MemoryMonitor::isOverBudget(MemoryLedger::Subsystem subsystem) const
+{
+	return this->budgets[subsystem] > 0 && this->getStats(subsystem).live > this->budgets[subsystem];
+}
+
+std::string MemoryMonitor::describe(MemoryLedger::Subsystem subsystem) const
+{
+	auto stats = this->getStats(subsystem);
+	auto slope = this->getSlope(subsystem);
+	auto overSlope = (this->maxSlopes[subsystem] > 0 && slope > this->maxSlopes[subsystem]);
+
+	return std::string("  ") + MemoryLedger::getSubsystemName(subsystem) + ": " + megabytes(static_cast<double>(stats.live)) 
+		+ (this->budgets[subsystem] > 0 ? " of " + megabytes(static_cast<double>(this->budgets[subsystem])) : "")
+		+ " (peak " + megabytes(static_cast<double>(stats.peak)) + "), " + megabytes(this->getAllocationRate(subsystem)) + "/s allocated, " 
+		+ (slope >= 0 ? "+" : "-") + megabytes(std::abs(slope)) + "/h"
+		+ (this->isOverBudget(subsystem) == true ? " OVER BUDGET" : "") + (overSlope == true ? " GROWING" : "");
+}
+
+const MemoryMonitor::Sample& MemoryMonitor::getSample(size_t age) const
+{
+	return this->history[(this->head + this->history.size() - age) % this->history.size()];
+}
@@ -0,0 +1,325 @@
+#include "MetadataCache.h"
+#include "FileIdentity.h"
+#include "MappedFile.h"
+
+#include "cinder/Filesystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	// Playlist entries decoded into the queue at a time.
+	const size_t WindowSize = 64;
+}
+
+MetadataCache::MetadataCache() :
+	indexedCount(0),
+	sourceIndex(0),
+	artSize(256),
+	running(false)
+{
+}
+
+MetadataCache::~MetadataCache()
+{
+	this->stop();
+}
+
+void MetadataCache::start(const std::string& directory, size_t threadCount, int artSize)
+{
+	this->stop();
+
+	this->directory = directory;
+	this->artSize = std::max(artSize, 1);
+
+	try
+	{
+		ci::fs::create_directories(this->directory);
+	}
+	catch(...)
+	{
+		return;
+	}
+
+	this->running = true;
+
+	for(size_t i = 0; i < std::max(threadCount, size_t(1)); i++)
+	{
+		this->threads.push_back(std::thread(&MetadataCache::run, this));
+	}
+}
+
+void MetadataCache::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->running = false;
+		this->queue.clear();
+		this->source.clear();
+		this->sourceIndex = 0;
+	}
+
+	this->condition.notify_all();
+
+	std::for_each(std::begin(this->threads), std::end(this->threads), 
+		[](std::thread& thread)
+		{
+			thread.join();
+		});
+
+	this->threads.clear();
+}
+
+void MetadataCache::index(const std::vector<std::string>& fileNames)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if(this->running == false)
+		{
+			return;
+		}
+
+		std::for_each(std::begin(fileNames), std::end(fileNames), 
+			[this](const std::string& fileName)
+			{
+				this->enqueue(fileName);
+			});
+	}
+
+	this->condition.notify_all();
+}
+
+void MetadataCache::index(const Playlist& playList)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if(this->running == false)
+		{
+			return;
+		}
+
+		// A mapped playlist is mapped again; an edited one is one copy of its pool.
+		this->source.assign(playList);
+		this->sourceIndex = 0;
+	}
+
+	this->condition.notify_all();
+}
+
+void MetadataCache::enqueue(const std::string& fileName)
+{
+	if(this->known.insert(FileIdentity::getPathHash(fileName)).second == true)
+	{
+		this->queue.push_back(fileName);
+	}
+}
+
+void MetadataCache::fill()
+{
+	std::string fileName;
+	auto end = std::min(this->sourceIndex + WindowSize, this->source.size());
+
+	for(; this->sourceIndex < end; this->sourceIndex++)
+	{
+		this->source.get(this->sourceIndex, fileName);
+
+		if(fileName.empty() == false)
+		{
+			this->enqueue(fileName);
+		}
+	}
+}
+
+bool MetadataCache::get(const std::string& fileName, TrackMetadata& metadata) const
+{
+	if(this->directory.empty() == true)
+	{
+		return false;
+	}
+
+	auto key = FileIdentity::getKey(fileName);
+
+	MappedFile file;
+
+	if(key == 0 || file.open(this->getCacheFileName(key)) == false || file.size() < sizeof(MetadataHeader))
+	{
+		return false;
+	}
+
+	MetadataHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+
+	auto stringBytes = static_cast<uint64_t>(header.artistLength) + header.albumLength + header.titleLength;
+	auto artBytes = static_cast<uint64_t>(header.artWidth) * header.artHeight * 3;
+
+	if(memcmp(header.magic, "EPMD", 4) != 0 || header.version != MetadataCache::Version || header.key != key 
+		|| file.size() < sizeof(header) + stringBytes + artBytes)
+	{
+		return false;
+	}
+
+	auto p = reinterpret_cast<const char*>(file.data() + sizeof(header));
+
+	metadata = TrackMetadata();
+	metadata.fileName = fileName;
+	metadata.artist.assign(p, header.artistLength);
+	p += header.artistLength;
+	metadata.album.assign(p, header.albumLength);
+	p += header.albumLength;
+	metadata.title.assign(p, header.titleLength);
+	p += header.titleLength;
+	metadata.year = header.year;
+	metadata.duration = header.durationMs / 1000.0;
+
+	if(artBytes > 0)
+	{
+		auto width = static_cast<int>(header.artWidth);
+		auto height = static_cast<int>(header.artHeight);
+
+		metadata.albumArt = ci::Surface8u(width, height, false, ci::SurfaceChannelOrder::RGB);
+
+		for(int y = 0; y < height; y++)
+		{
+			memcpy(metadata.albumArt.getData() + y * metadata.albumArt.getRowBytes(), p + y * width * 3, width * 3);
+		}
+
+		metadata.hasAlbumArt = true;
+	}
+
+	return true;
+}
+
+size_t MetadataCache::getIndexedCount() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->indexedCount;
+}
+
+size_t MetadataCache::getPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->queue.size() + (this->source.size() - this->sourceIndex);
+}
+
+void MetadataCache::run()
+{
+	while(true)
+	{
+		std::string fileName;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			while(this->running == true && this->queue.empty() == true && this->sourceIndex >= this->source.size())
+			{
+				this->condition.wait(lock);
+			}
+
+			if(this->running == false)
+			{
+				break;
+			}
+
+			if(this->queue.empty() == true)
+			{
+				this->fill();
+
+				// The whole window was already known.
+				if(this->queue.empty() == true)
+				{
+					continue;
+				}
+			}
+
+			fileName = this->queue.front();
+			this->queue.pop_front();
+		}
+
+		auto key = FileIdentity::getKey(fileName);
+
+		if(key != 0)
+		{
+			auto cacheFileName = this->getCacheFileName(key);
+			TrackMetadata metadata;
+
+			if(this->get(fileName, metadata) == false)
+			{
+				TrackMetadataLoader::load(fileName, this->artSize, metadata);
+				this->write(cacheFileName, key, metadata);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->indexedCount++;
+	}
+}
+
+bool MetadataCache::write(const std::string& cacheFileName, uint64_t key, const TrackMetadata& metadata) const
+{
+	// Store the art as tightly packed RGB whatever the decoder produced.
+	ci::Surface8u art;
+
+	if(metadata.hasAlbumArt == true)
+	{
+		art = ci::Surface8u(metadata.albumArt.getWidth(), metadata.albumArt.getHeight(), false, ci::SurfaceChannelOrder::RGB);
+		art.copyFrom(metadata.albumArt, metadata.albumArt.getBounds());
+	}
+
+	MetadataHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "EPMD", 4);
+	header.version = MetadataCache::Version;
+	header.key = key;
+	header.year = metadata.year;
+	header.durationMs = static_cast<uint32_t>(metadata.duration * 1000.0);
+	header.artistLength = static_cast<uint32_t>(metadata.artist.size());
+	header.albumLength = static_cast<uint32_t>(metadata.album.size());
+	header.titleLength = static_cast<uint32_t>(metadata.title.size());
+
+	if(metadata.hasAlbumArt == true)
+	{
+		header.artWidth = static_cast<uint32_t>(art.getWidth());
+		header.artHeight = static_cast<uint32_t>(art.getHeight());
+	}
+
+	auto temporaryFileName = cacheFileName + ".tmp";
+	std::ofstream os;
+	os.open(temporaryFileName.c_str(), std::ios_base::binary | std::ios_base::trunc);
+
+	if(os.is_open() == false)
+	{
+		return false;
+	}
+
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	os.write(metadata.artist.data(), metadata.artist.size());
+	os.write(metadata.album.data(), metadata.album.size());
+	os.write(metadata.title.data(), metadata.title.size());
+
+	for(uint32_t y = 0; y < header.artHeight; y++)
+	{
+		os.write(reinterpret_cast<const char*>(art.getData() + y * art.getRowBytes()), header.artWidth * 3);
+	}
+
+	os.close();
+
+	if(os.fail() == true)
+	{
+		std::remove(temporaryFileName.c_str());
+		return false;
+	}
+
+	std::remove(cacheFileName.c_str());
+	return std::rename(temporaryFileName.c_str(), cacheFileName.c_str()) == 0;
+}
+
+std::string MetadataCache::getCacheFileName(uint64_t key) const
+{
+	char name[32];
+	sprintf(name, "%016llx.epm", static_cast<unsigned long long>(key));
+	return (ci::fs::path(this->directory) / name).string();
+}
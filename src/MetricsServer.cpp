@@ -0,0 +1,481 @@
+#include "MetricsServer.h"
+#include "Benchmark.h"
+#include "FmodMemory.h"
+#include "IdleMonitor.h"
+
+#include "cinder/Timer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#if defined(_WIN32)
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#pragma comment(lib, "ws2_32.lib")
+
+	typedef int socklen_t;
+#else
+	#include <arpa/inet.h>
+	#include <netinet/in.h>
+	#include <sys/select.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+namespace
+{
+	// 1 ms to a quarter second, around the 16.7 and 33.3 ms of 60 and 30 Hz.
+	const double FrameBounds[MetricsHistogram::BucketCount] = { 0.001, 0.002, 0.004, 0.008, 0.012, 0.0167, 0.02, 0.025, 0.0333, 0.05, 0.1, 0.25 };
+
+	// Time from asking for a track until it is audible.
+	const double LoadBounds[MetricsHistogram::BucketCount] = { 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0 };
+
+	// How often the server thread looks at the running flag while nobody connects.
+	const long PollMicroseconds = 200 * 1000;
+
+	// Total time a scraper gets to send its request and take the reply before it is dropped.
+	const int RequestSeconds = 2;
+	const size_t MaxRequestBytes = 4096;
+
+	void closeSocket(intptr_t socket)
+	{
+#if defined(_WIN32)
+		closesocket(static_cast<SOCKET>(socket));
+#else
+		close(static_cast<int>(socket));
+#endif
+	}
+
+	// Bounds each blocking send and recv; the deadline in serve() bounds the whole request.
+	void setTimeouts(intptr_t socket, int seconds)
+	{
+#if defined(_WIN32)
+		DWORD timeout = seconds * 1000;
+#else
+		timeval timeout;
+		timeout.tv_sec = seconds;
+		timeout.tv_usec = 0;
+#endif
+
+		setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+		setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+	}
+
+	bool waitReadable(intptr_t socket, long microseconds)
+	{
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(socket, &readable);
+
+		timeval timeout;
+		timeout.tv_sec = microseconds / 1000000;
+		timeout.tv_usec = microseconds % 1000000;
+
+		return select(static_cast<int>(socket) + 1, &readable, nullptr, nullptr, &timeout) > 0;
+	}
+
+	void sendAll(intptr_t socket, const std::string& data, const ci::Timer& timer)
+	{
+		size_t sent = 0;
+
+		while(sent < data.size() && timer.getSeconds() < RequestSeconds)
+		{
+			auto count = send(socket, data.data() + sent, static_cast<int>(data.size() - sent), 0);
+
+			if(count <= 0)
+			{
+				return;
+			}
+
+			sent += static_cast<size_t>(count);
+		}
+	}
+
+	void writeHeader(std::ostream& stream, const char* name, const char* type, const char* help)
+	{
+		stream << "# HELP " << name << " " << help << "\n";
+		stream << "# TYPE " << name << " " << type << "\n";
+	}
+
+	void writeHistogram(std::ostream& stream, const char* name, const char* help, const MetricsHistogram& histogram)
+	{
+		writeHeader(stream, name, "histogram", help);
+
+		uint64_t cumulative = 0;
+
+		for(size_t i = 0; i < MetricsHistogram::BucketCount; i++)
+		{
+			cumulative += histogram.buckets[i];
+			stream << name << "_bucket{le=\"" << histogram.bounds[i] << "\"} " << cumulative << "\n";
+		}
+
+		stream << name << "_bucket{le=\"+Inf\"} " << histogram.count << "\n";
+		stream << name << "_sum " << histogram.sum << "\n";
+		stream << name << "_count " << histogram.count << "\n";
+	}
+}
+
+MetricsHistogram::MetricsHistogram(const double* bounds) :
+	count(0),
+	sum(0)
+{
+	std::copy(bounds, bounds + BucketCount, std::begin(this->bounds));
+	this->buckets.fill(0);
+}
+
+void MetricsHistogram::observe(double seconds)
+{
+	auto bucket = std::lower_bound(std::begin(this->bounds), std::end(this->bounds), seconds);
+
+	if(bucket != std::end(this->bounds))
+	{
+		this->buckets[bucket - std::begin(this->bounds)]++;
+	}
+
+	this->count++;
+	this->sum += seconds;
+}
+
+MetricsSnapshot::MetricsSnapshot() :
+	frames(0),
+	frameSeconds(FrameBounds),
+	particles(0),
+	emittedParticles(0),
+	culledParticles(0),
+	starvingUpdates(0),
+	diskBusyUpdates(0),
+	firstAudioSeconds(LoadBounds),
+	openSeconds(0),
+	qualityLevel(0),
+	idleState(0),
+	fmodMemory(0),
+	fmodMemoryPeak(0),
+	processPeakMemory(0)
+{
+	this->phaseSeconds.fill(0);
+	this->fmodCpu.fill(0);
+}
+
+MetricsServer::MetricsServer() :
+	listener(-1),
+	scrapes(0),
+	running(false)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+	this->stop();
+}
+
+bool MetricsServer::start(const std::string& address)
+{
+	this->stop();
+
+#if defined(_WIN32)
+	WSADATA data;
+
+	if(WSAStartup(MAKEWORD(2, 2), &data) != 0)
+	{
+		return false;
+	}
+#endif
+
+	// Every failure below falls through to the cleanup at the end with no listener.
+	intptr_t listener = -1;
+
+	if(address.compare(0, 5, "unix:") == 0)
+	{
+#if !defined(_WIN32)
+		sockaddr_un local;
+		memset(&local, 0, sizeof(local));
+		local.sun_family = AF_UNIX;
+
+		if(address.size() - 5 < sizeof(local.sun_path))
+		{
+			this->unixPath = address.substr(5);
+			strncpy(local.sun_path, this->unixPath.c_str(), sizeof(local.sun_path) - 1);
+
+			// A previous instance that crashed leaves its socket file behind.
+			unlink(local.sun_path);
+
+			listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+			if(listener >= 0 && bind(listener, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+			{
+				closeSocket(listener);
+				listener = -1;
+			}
+		}
+#endif
+	}
+	else
+	{
+		auto colon = address.rfind(':');
+		auto host = (colon == std::string::npos) ? std::string("127.0.0.1") : address.substr(0, colon);
+		auto port = atoi(address.c_str() + (colon == std::string::npos ? 0 : colon + 1));
+
+		sockaddr_in local;
+		memset(&local, 0, sizeof(local));
+		local.sin_family = AF_INET;
+		local.sin_port = htons(static_cast<unsigned short>(port));
+		local.sin_addr.s_addr = inet_addr(host.c_str());
+
+		if(port > 0 && port <= 65535 && local.sin_addr.s_addr != INADDR_NONE)
+		{
+			listener = static_cast<intptr_t>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+		}
+
+		if(listener >= 0)
+		{
+			int enable = 1;
+#if defined(_WIN32)
+			// SO_REUSEADDR on Windows would let another process bind the same port; this
+			// refuses that instead, and a restart still doesn't wait out TIME_WAIT.
+			setsockopt(listener, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, reinterpret_cast<const char*>(&enable), sizeof(enable));
+#else
+			// Restarting the app shouldn't have to wait out TIME_WAIT.
+			setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&enable), sizeof(enable));
+#endif
+
+			if(bind(listener, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+			{
+				closeSocket(listener);
+				listener = -1;
+			}
+		}
+	}
+
+	if(listener < 0 || listen(listener, 4) != 0)
+	{
+		if(listener >= 0)
+		{
+			closeSocket(listener);
+		}
+
+#if defined(_WIN32)
+		WSACleanup();
+#endif
+		return false;
+	}
+
+	this->listener = listener;
+	this->running = true;
+	this->thread = std::thread(&MetricsServer::run, this);
+	return true;
+}
+
+void MetricsServer::stop()
+{
+	this->running = false;
+
+	if(this->thread.joinable() == true)
+	{
+		this->thread.join();
+	}
+
+	if(this->listener >= 0)
+	{
+		closeSocket(this->listener);
+		this->listener = -1;
+
+#if defined(_WIN32)
+		WSACleanup();
+#else
+		if(this->unixPath.empty() == false)
+		{
+			unlink(this->unixPath.c_str());
+			this->unixPath.clear();
+		}
+#endif
+	}
+}
+
+bool MetricsServer::isRunning() const
+{
+	return this->running;
+}
+
+void MetricsServer::publish(const MetricsSnapshot& snapshot)
+{
+	// The server only holds the lock to copy the snapshot out.
+	std::unique_lock<std::mutex> lock(this->mutex, std::try_to_lock);
+
+	if(lock.owns_lock() == true)
+	{
+		this->snapshot = snapshot;
+	}
+}
+
+uint64_t MetricsServer::getScrapeCount() const
+{
+	return this->scrapes;
+}
+
+void MetricsServer::run()
+{
+	while(this->running == true)
+	{
+		if(waitReadable(this->listener, PollMicroseconds) == false)
+		{
+			continue;
+		}
+
+		auto connection = static_cast<intptr_t>(accept(this->listener, nullptr, nullptr));
+
+		if(connection < 0)
+		{
+			continue;
+		}
+
+		this->serve(connection);
+		closeSocket(connection);
+	}
+}
+
+void MetricsServer::serve(intptr_t connection)
+{
+	ci::Timer timer(true);
+	setTimeouts(connection, RequestSeconds);
+
+	std::string request;
+	char buffer[512];
+
+	while(request.find("\r\n\r\n") == std::string::npos && request.size() < MaxRequestBytes)
+	{
+		auto remaining = static_cast<long>((RequestSeconds - timer.getSeconds()) * 1000000.0);
+
+		if(remaining <= 0 || waitReadable(connection, remaining) == false)
+		{
+			return;
+		}
+
+		auto count = recv(connection, buffer, sizeof(buffer), 0);
+
+		if(count <= 0)
+		{
+			return;
+		}
+
+		request.append(buffer, static_cast<size_t>(count));
+	}
+
+	if(request.compare(0, 13, "GET /metrics ") != 0 && request.compare(0, 6, "GET / ") != 0)
+	{
+		sendAll(connection, "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\nConnection: close\r\n\r\nNot found\n", timer);
+		return;
+	}
+
+	MetricsSnapshot snapshot;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		snapshot = this->snapshot;
+	}
+
+	// Read here rather than every frame; all of these are safe from any thread.
+	for(int i = 0; i < MemoryLedger::Subsystem_End; i++)
+	{
+		snapshot.memory[i] = MemoryLedger::getStats(static_cast<MemoryLedger::Subsystem>(i));
+	}
+
+	FmodMemory::getStats(snapshot.fmodMemory, snapshot.fmodMemoryPeak);
+	snapshot.processPeakMemory = Benchmark::getPeakMemory();
+
+	auto body = MetricsServer::format(snapshot);
+
+	std::ostringstream header;
+	header << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " << body.size() << "\r\nConnection: close\r\n\r\n";
+
+	sendAll(connection, header.str(), timer);
+	sendAll(connection, body, timer);
+	this->scrapes++;
+}
+
+std::string MetricsServer::format(const MetricsSnapshot& snapshot)
+{
+	std::ostringstream stream;
+	stream.precision(10);
+
+	writeHeader(stream, "epoch_frames_total", "counter", "Frames completed.");
+	stream << "epoch_frames_total " << snapshot.frames << "\n";
+
+	writeHistogram(stream, "epoch_frame_seconds", "Time from the start of one frame to the start of the next.", snapshot.frameSeconds);
+
+	writeHeader(stream, "epoch_frame_phase_seconds_total", "counter", "Time spent in each phase of the frame.");
+
+	for(int i = 0; i < FrameProfiler::Phase_End; i++)
+	{
+		stream << "epoch_frame_phase_seconds_total{phase=\"" << FrameProfiler::getPhaseName(static_cast<FrameProfiler::Phase>(i)) << "\"} " << snapshot.phaseSeconds[i] << "\n";
+	}
+
+	writeHeader(stream, "epoch_fmod_cpu_percent", "gauge", "FMOD's own CPU usage in the last frame.");
+	stream << "epoch_fmod_cpu_percent{component=\"dsp\"} " << snapshot.fmodCpu[0] << "\n";
+	stream << "epoch_fmod_cpu_percent{component=\"stream\"} " << snapshot.fmodCpu[1] << "\n";
+	stream << "epoch_fmod_cpu_percent{component=\"update\"} " << snapshot.fmodCpu[2] << "\n";
+	stream << "epoch_fmod_cpu_percent{component=\"total\"} " << snapshot.fmodCpu[3] << "\n";
+
+	writeHeader(stream, "epoch_particles", "gauge", "Live particles.");
+	stream << "epoch_particles " << snapshot.particles << "\n";
+
+	writeHeader(stream, "epoch_particles_emitted_total", "counter", "Particles emitted.");
+	stream << "epoch_particles_emitted_total " << snapshot.emittedParticles << "\n";
+
+	writeHeader(stream, "epoch_particles_culled_total", "counter", "Particles removed for age or for leaving the view.");
+	stream << "epoch_particles_culled_total " << snapshot.culledParticles << "\n";
+
+	writeHeader(stream, "epoch_audio_starving_updates_total", "counter", "Audio updates on which the stream reported starving (an underrun).");
+	stream << "epoch_audio_starving_updates_total " << snapshot.starvingUpdates << "\n";
+
+	writeHeader(stream, "epoch_audio_disk_busy_updates_total", "counter", "Audio updates on which the stream reported the disk busy.");
+	stream << "epoch_audio_disk_busy_updates_total " << snapshot.diskBusyUpdates << "\n";
+
+	writeHistogram(stream, "epoch_track_first_audio_seconds", "Time from asking for a track until it was audible; zero when joined gaplessly.", snapshot.firstAudioSeconds);
+
+	writeHeader(stream, "epoch_track_open_seconds", "gauge", "Time FMOD took to open the current track.");
+	stream << "epoch_track_open_seconds " << snapshot.openSeconds << "\n";
+
+	writeHeader(stream, "epoch_quality_level", "gauge", "Quality governor level; 0 is full quality.");
+	stream << "epoch_quality_level " << snapshot.qualityLevel << "\n";
+
+	writeHeader(stream, "epoch_idle_state", "gauge", "Idle monitor state.");
+
+	for(int i = 0; i < IdleMonitor::State_End; i++)
+	{
+		stream << "epoch_idle_state{state=\"" << IdleMonitor::getStateName(static_cast<IdleMonitor::State>(i)) << "\"} " << (snapshot.idleState == i ? 1 : 0) << "\n";
+	}
+
+	writeHeader(stream, "epoch_memory_live_bytes", "gauge", "Bytes each subsystem holds.");
+
+	for(int i = 0; i < MemoryLedger::Subsystem_End; i++)
+	{
+		stream << "epoch_memory_live_bytes{subsystem=\"" << MemoryLedger::getSubsystemName(static_cast<MemoryLedger::Subsystem>(i)) << "\"} " << snapshot.memory[i].live << "\n";
+	}
+
+	writeHeader(stream, "epoch_memory_peak_bytes", "gauge", "Most bytes each subsystem has held at once.");
+
+	for(int i = 0; i < MemoryLedger::Subsystem_End; i++)
+	{
+		stream << "epoch_memory_peak_bytes{subsystem=\"" << MemoryLedger::getSubsystemName(static_cast<MemoryLedger::Subsystem>(i)) << "\"} " << snapshot.memory[i].peak << "\n";
+	}
+
+	writeHeader(stream, "epoch_memory_allocated_bytes_total", "counter", "Bytes each subsystem has allocated.");
+
+	for(int i = 0; i < MemoryLedger::Subsystem_End; i++)
+	{
+		stream << "epoch_memory_allocated_bytes_total{subsystem=\"" << MemoryLedger::getSubsystemName(static_cast<MemoryLedger::Subsystem>(i)) << "\"} " << snapshot.memory[i].allocated << "\n";
+	}
+
+	writeHeader(stream, "epoch_fmod_memory_bytes", "gauge", "Memory FMOD holds.");
+	stream << "epoch_fmod_memory_bytes " << snapshot.fmodMemory << "\n";
+
+	writeHeader(stream, "epoch_fmod_memory_peak_bytes", "gauge", "Most memory FMOD has held at once.");
+	stream << "epoch_fmod_memory_peak_bytes " << snapshot.fmodMemoryPeak << "\n";
+
+	writeHeader(stream, "epoch_process_peak_memory_bytes", "gauge", "Peak working set of the process.");
+	stream << "epoch_process_peak_memory_bytes " << snapshot.processPeakMemory << "\n";
+
+	return stream.str();
+}
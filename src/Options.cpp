@@ -0,0 +1,78 @@
+#include "Options.h"
+
+#include <cstdlib>
+
+Options::Options()
+{
+}
+
+void Options::parse(const std::vector<std::string>& args)
+{
+	this->values.clear();
+	this->positional.clear();
+
+	// The first argument is the executable.
+	for(size_t i = 1; i < args.size(); i++)
+	{
+		const std::string& arg = args[i];
+
+		if(arg.size() > 2 && arg.compare(0, 2, "--") == 0)
+		{
+			auto separator = arg.find('=');
+
+			if(separator != std::string::npos)
+			{
+				this->values[arg.substr(2, separator - 2)] = arg.substr(separator + 1);
+			}
+			else
+			{
+				this->values[arg.substr(2)] = "";
+			}
+		}
+		else
+		{
+			this->positional.push_back(arg);
+		}
+	}
+}
+
+bool Options::has(const std::string& name) const
+{
+	return this->values.find(name) != this->values.end();
+}
+
+std::string Options::getString(const std::string& name, const std::string& defaultValue) const
+{
+	auto i = this->values.find(name);
+
+	if(i == this->values.end() || i->second.empty() == true)
+	{
+		return defaultValue;
+	}
+
+	return i->second;
+}
+
+int Options::getInt(const std::string& name, int defaultValue) const
+{
+	auto i = this->values.find(name);
+
+	if(i == this->values.end() || i->second.empty() == true)
+	{
+		return defaultValue;
+	}
+
+	return std::atoi(i->second.c_str());
+}
+
+float Options::getFloat(const std::string& name, float defaultValue) const
+{
+	auto i = this->values.find(name);
+
+	if(i == this->values.end() || i->second.empty() == true)
+	{
+		return defaultValue;
+	}
+
+	return static_cast<float>(std::atof(i->second.c_str()));
+}
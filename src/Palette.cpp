@@ -0,0 +1,278 @@
+#include "Palette.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	#include <emmintrin.h>
+	#define EPOCH_PALETTE_SSE2
+#endif
+
+Palette::Palette() :
+	range(1.0f),
+	scale(static_cast<float>(Palette::Size)),
+	velocityScale(0)
+{
+	this->table.resize(Palette::Size);
+	this->generate(true, false, 1.0f, 2.0f);
+}
+
+void Palette::setRange(float range)
+{
+	this->range = std::max(range, 0.0001f);
+	this->scale = static_cast<float>(Palette::Size) / this->range;
+}
+
+void Palette::generate(bool timeDomain, bool greyscale, float velocityScale, float range)
+{
+	this->setRange(range);
+	this->velocityScale = velocityScale;
+
+	// Sample each entry at the center of the span of values it covers.
+	for(size_t i = 0; i < Palette::Size; i++)
+	{
+		auto x = (static_cast<float>(i) + 0.5f) / this->scale;
+		this->table[i] = Palette::getValueColor(x, timeDomain, greyscale, velocityScale);
+	}
+}
+
+bool Palette::load(const std::string& fileName)
+{
+	std::ifstream is;
+	is.open(fileName);
+
+	if(is.is_open() == false)
+	{
+		return false;
+	}
+
+	auto fileRange = 1.0f;
+	std::vector<std::array<float, 4>> points;
+
+	while(is.eof() == false)
+	{
+		std::string line;
+		std::getline(is, line);
+
+		if(line.find('#') != std::string::npos)
+		{
+			line = line.substr(0, line.find('#'));
+		}
+
+		std::istringstream ls(line);
+		std::string first;
+
+		if(!(ls >> first))
+		{
+			continue;
+		}
+
+		if(first == "range")
+		{
+			ls >> fileRange;
+			continue;
+		}
+
+		std::array<float, 4> point;
+		point[0] = static_cast<float>(atof(first.c_str()));
+
+		if(ls >> point[1] >> point[2] >> point[3])
+		{
+			points.push_back(point);
+		}
+	}
+
+	if(points.empty() == true)
+	{
+		return false;
+	}
+
+	std::sort(std::begin(points), std::end(points),
+		[](const std::array<float, 4>& a, const std::array<float, 4>& b)
+		{
+			return a[0] < b[0];
+		});
+
+	this->setRange(fileRange);
+	this->velocityScale = 0;
+
+	size_t segment = 0;
+	for(size_t i = 0; i < Palette::Size; i++)
+	{
+		auto x = (static_cast<float>(i) + 0.5f) / this->scale;
+
+		while(segment + 1 < points.size() && points[segment + 1][0] <= x)
+		{
+			segment++;
+		}
+
+		const std::array<float, 4>& a = points[segment];
+		const std::array<float, 4>& b = points[std::min(segment + 1, points.size() - 1)];
+
+		auto t = 0.0f;
+		if(b[0] > a[0] && x > a[0])
+		{
+			t = std::min((x - a[0]) / (b[0] - a[0]), 1.0f);
+		}
+
+		for(size_t c = 0; c < 3; c++)
+		{
+			this->table[i][c] = a[c + 1] + (b[c + 1] - a[c + 1]) * t;
+		}
+	}
+
+	return true;
+}
+
+float Palette::getRange() const
+{
+	return this->range;
+}
+
+float Palette::getVelocityScale() const
+{
+	return this->velocityScale;
+}
+
+std::array<float, 3> Palette::map(float x) const
+{
+	auto index = static_cast<size_t>(std::min(std::fabs(x) * this->scale, static_cast<float>(Palette::Size - 1)));
+	return this->table[index];
+}
+
+void Palette::mapRow(const float* values, size_t count, std::array<float, 3>* out) const
+{
+	size_t i = 0;
+
+#if defined(EPOCH_PALETTE_SSE2)
+	// Four indices at a time: abs, scale, clamp, truncate. Then gather from the table.
+	auto signMask = _mm_set1_ps(-0.0f);
+	auto scale = _mm_set1_ps(this->scale);
+	auto last = _mm_set1_ps(static_cast<float>(Palette::Size - 1));
+
+	for(; i + 4 <= count; i += 4)
+	{
+		auto x = _mm_andnot_ps(signMask, _mm_loadu_ps(values + i));
+		auto index = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(x, scale), last));
+
+		int32_t indices[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), index);
+
+		out[i] = this->table[indices[0]];
+		out[i + 1] = this->table[indices[1]];
+		out[i + 2] = this->table[indices[2]];
+		out[i + 3] = this->table[indices[3]];
+	}
+#endif
+
+	for(; i < count; i++)
+	{
+		out[i] = this->map(values[i]);
+	}
+}
+
+std::array<float, 3> Palette::getValueColor(float x, bool timeDomain, bool greyscale, float velocityScale)
+{
+	std::array<float, 3> rgb;
+
+	if(timeDomain == true)
+	{
+		if(greyscale == true)
+		{
+			rgb[0] = x * velocityScale/2;
+			rgb[1] = rgb[0];
+			rgb[2] = rgb[0];
+		}
+		else
+		{
+			if(x < 0.2f)
+			{
+				rgb[0] = (x / 0.2f)/2.0f;
+				rgb[1] = rgb[0];
+				rgb[2] = rgb[0];
+			}
+			else if(x < 0.4f)
+			{
+				rgb[0] = 0.2f;
+				rgb[1] = 0.2f;
+				rgb[2] = (x / 0.4f);
+			}
+			else if(x < 0.6f)
+			{
+				rgb[0] = ((x - 0.4f) / 0.2f);
+				rgb[1] = 0.35f;
+				rgb[2] = 0.38f;
+			}
+			else if(x < 0.8f)
+			{
+				rgb[0] = ((x - 0.6f) / 0.2f);
+				rgb[1] = 0.556f;
+				rgb[2] = 0.556f;
+			}
+			else if(x < 0.9f)
+			{
+				rgb[0] = 0.9f;
+				rgb[1] = 0.9f;
+				rgb[2] = x / 0.9f;
+			}
+			else
+			{
+				rgb[0] = x / 0.9f;
+				rgb[1] = 0.5f + 1.0f - rgb[0];
+				rgb[2] = rgb[1];
+			}
+		}
+	}
+	else
+	{
+		if(greyscale == true)
+		{
+			rgb[0] = x * velocityScale/2;
+			rgb[1] = rgb[0];
+			rgb[2] = rgb[0];
+		}
+		else
+		{
+			if(x < 0.05f)
+			{
+				rgb[0] = (x / 0.05f)/2;
+				rgb[1] = rgb[0];
+				rgb[2] = rgb[0];
+			}
+			else if(x < 0.1f)
+			{
+				rgb[0] = 0.1f;
+				rgb[1] = 0.1f;
+				rgb[2] = (x / 0.1f);
+			}
+			else if(x < 0.2f)
+			{
+				rgb[0] = ((x - 0.1f) / 0.1f);
+				rgb[1] = 0.35f;
+				rgb[2] = 0.38f;
+			}
+			else if(x < 0.4f)
+			{
+				rgb[0] = ((x - 0.2f) / 0.2f);
+				rgb[1] = 0.556f;
+				rgb[2] = 0.556f;
+			}
+			else if(x < 0.6f)
+			{
+				rgb[0] = 0.6f;
+				rgb[1] = 0.6f;
+				rgb[2] = x / 0.6f;
+			}
+			else
+			{
+				rgb[0] = x / 0.9f;
+				rgb[1] = 0.5f + 1.0f - rgb[0];
+				rgb[2] = rgb[1];
+			}
+		}
+	}
+
+	return rgb;
+}
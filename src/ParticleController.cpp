@@ -1,69 +1,82 @@
 #include "ParticleController.h"
 
+#include <algorithm>
+#include <limits>
+
 ParticleController::ParticleController() :
 	maxAge(32),
-	entropy(0)
+	entropy(0),
+	ageScale(1.0f),
+	pointPasses(3)
 {
 }
 
-void ParticleController::update()
+size_t ParticleController::update()
 {
 	auto w = this->screenWidth;
 	auto h = this->screenHeight;
-	auto a = this->maxAge;
+	// In double with the scale clamped to 1, so the result never exceeds maxAge; in
+	// float a large maxAge rounds past UINT32_MAX and the cast is undefined.
+	auto scale = std::min(std::max(this->ageScale, 0.0f), 1.0f);
+	auto a = std::max(static_cast<uint32_t>(static_cast<double>(this->maxAge) * scale), 1u);
+	auto count = this->particles.size();
 
-	this->particles.remove_if(
+	this->particles.erase(std::remove_if(std::begin(this->particles), std::end(this->particles),
 		[w, h, a](const Particle& p)->bool
 		{
-			return (p.age >= a || p.position[0] < 0 || p.position[1] < 0 || p.position[0] > w || p.position[1] > h);
-		});
+			return ParticleController::isDead(p, w, h, a);
+		}), std::end(this->particles));
 
 	std::for_each(std::begin(this->particles), std::end(this->particles),
 		[](Particle& p)
 		{
 			p.update();
 		});
+
+	return count - this->particles.size();
 }
 
-void ParticleController::draw()
+void ParticleController::draw(FrameArena& arena)
 {
 	// Two pass rendering.
-	// Doing all the < 1 sized points in a single display list is really fast, but 
-	// doesn't allow for adjustment to point size.
+	// All the small points go down in one array per point size, which is really fast
+	// but doesn't allow for adjustment to point size per particle.
+	auto small = arena.allocate<ParticleVertex>(this->particles.size());
+	auto medium = arena.allocate<ParticleVertex>(this->particles.size());
+	size_t smallCount = 0;
+	size_t mediumCount = 0;
+	this->buildVertices(small, smallCount, medium, mediumCount);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
 
 	// Little ones
-	glPointSize(2);
-	glBegin(GL_POINTS);
+	if(smallCount > 0)
 	{
-		std::for_each(std::begin(this->particles), std::end(this->particles),
-			[](Particle& p)
-			{
-				auto abs = fabs(p.scale[0]);
-				if(abs <= 1.0f)
-				{
-					p.draw();
-				}
-			});
+		glPointSize(2);
+		glVertexPointer(2, GL_FLOAT, sizeof(ParticleVertex), &small[0].x);
+		glColorPointer(3, GL_FLOAT, sizeof(ParticleVertex), &small[0].r);
+		glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(smallCount));
 	}
-	glEnd();
 
 	// Little ones
-	glPointSize(4);
-	glBegin(GL_POINTS);
+	if(mediumCount > 0)
 	{
-		std::for_each(std::begin(this->particles), std::end(this->particles),
-			[](Particle& p)
-			{
-				auto abs = fabs(p.scale[0]);
-				if(abs > 1.0f && abs <= 2.0f)
-				{
-					p.draw();
-				}
-			});
+		glPointSize(4);
+		glVertexPointer(2, GL_FLOAT, sizeof(ParticleVertex), &medium[0].x);
+		glColorPointer(3, GL_FLOAT, sizeof(ParticleVertex), &medium[0].r);
+		glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(mediumCount));
 	}
-	glEnd();
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 
 	// Big Ones
+	if(this->pointPasses < 3)
+	{
+		return;
+	}
+
 	std::for_each(std::begin(this->particles), std::end(this->particles),
 		[](Particle& p)
 		{
@@ -75,6 +88,114 @@ void ParticleController::draw()
 		});
 }
 
+bool ParticleController::isDead(const Particle& p, int width, int height, uint32_t maxAge)
+{
+	return (static_cast<uint32_t>(p.age) >= maxAge || p.position[0] < 0 || p.position[1] < 0 || p.position[0] > width || p.position[1] > height);
+}
+
+uint64_t ParticleController::getChecksum() const
+{
+	// FNV-1a over the bytes of the state, not the whole object, so padding doesn't count.
+	uint64_t hash = 14695981039346656037ULL;
+
+	auto mix = [&hash](const void* data, size_t size)
+	{
+		auto bytes = static_cast<const uint8_t*>(data);
+
+		for(size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ULL;
+		}
+	};
+
+	std::for_each(std::begin(this->particles), std::end(this->particles),
+		[&mix](const Particle& p)
+		{
+			float state[10] = 
+			{
+				p.position[0], p.position[1], p.position[2], 
+				p.velocity[0], p.velocity[1], 
+				p.scale[0], p.scale[1], 
+				p.color.r, p.color.g, p.color.b
+			};
+
+			mix(state, sizeof(state));
+			mix(&p.age, sizeof(p.age));
+		});
+
+	return hash;
+}
+
+void ParticleController::buildVertices(ParticleVertex* small, size_t& smallCount, ParticleVertex* medium, size_t& mediumCount) const
+{
+	smallCount = 0;
+	mediumCount = 0;
+
+	// Past the second pass everything left over is drawn as medium points, past the first as small ones.
+	auto largest = (this->pointPasses < 3) ? std::numeric_limits<float>::max() : 2.0f;
+	auto smallest = (this->pointPasses < 2) ? std::numeric_limits<float>::max() : 1.0f;
+
+	std::for_each(std::begin(this->particles), std::end(this->particles),
+		[&](const Particle& p)
+		{
+			auto abs = fabs(p.scale[0]);
+
+			if(abs <= largest)
+			{
+				ParticleVertex v = {p.position[0], p.position[1], p.color.r, p.color.g, p.color.b};
+
+				if(abs <= smallest)
+				{
+					small[smallCount++] = v;
+				}
+				else
+				{
+					medium[mediumCount++] = v;
+				}
+			}
+		});
+}
+
+void ParticleController::drawSoftware(ci::Surface8u& surface) const
+{
+	auto width = surface.getWidth();
+	auto height = surface.getHeight();
+	auto rowBytes = surface.getRowBytes();
+	auto pixelInc = surface.getPixelInc();
+	auto data = surface.getData();
+
+	std::for_each(std::begin(this->particles), std::end(this->particles),
+		[=](const Particle& p)
+		{
+			auto abs = fabs(p.scale[0]);
+			auto size = (abs <= 1.0f) ? 2 : ((abs <= 2.0f) ? 4 : static_cast<int>(abs));
+			auto x0 = static_cast<int>(p.position[0]) - size / 2;
+			auto y0 = static_cast<int>(p.position[1]) - size / 2;
+			auto x1 = std::min(x0 + size, width);
+			auto y1 = std::min(y0 + size, height);
+
+			uint8_t rgb[3] =
+			{
+				static_cast<uint8_t>(std::min(std::max(p.color.r, 0.0f), 1.0f) * 255.0f),
+				static_cast<uint8_t>(std::min(std::max(p.color.g, 0.0f), 1.0f) * 255.0f),
+				static_cast<uint8_t>(std::min(std::max(p.color.b, 0.0f), 1.0f) * 255.0f)
+			};
+
+			for(auto y = std::max(y0, 0); y < y1; y++)
+			{
+				auto pixel = data + y * rowBytes + std::max(x0, 0) * pixelInc;
+
+				for(auto x = std::max(x0, 0); x < x1; x++)
+				{
+					pixel[0] = rgb[0];
+					pixel[1] = rgb[1];
+					pixel[2] = rgb[2];
+					pixel += pixelInc;
+				}
+			}
+		});
+}
+
 void ParticleController::addParticle(float x, float y, float value)
 {
 	this->addParticle(x, y, value, false);
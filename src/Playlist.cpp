@@ -0,0 +1,381 @@
+#include "Playlist.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+	{
+		while(value >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	// Null if the varint runs past 'end' or is longer than 64 bits.
+	const uint8_t* readVarint(const uint8_t* p, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+
+		for(int shift = 0; shift < 64; shift += 7)
+		{
+			if(p >= end)
+			{
+				return nullptr;
+			}
+
+			value |= static_cast<uint64_t>(*p & 0x7f) << shift;
+
+			if((*p++ & 0x80) == 0)
+			{
+				return p;
+			}
+		}
+
+		return nullptr;
+	}
+}
+
+Playlist::Playlist()
+{
+	memset(&this->header, 0, sizeof(this->header));
+}
+
+bool Playlist::open(const std::string& fileName)
+{
+	this->clear();
+
+	if(this->file.open(fileName) == false || this->file.size() < sizeof(PlaylistHeader))
+	{
+		this->file.close();
+		return false;
+	}
+
+	PlaylistHeader fileHeader;
+	memcpy(&fileHeader, this->file.data(), sizeof(fileHeader));
+
+	// Sizes are checked against the file before they are multiplied, so they can't overflow.
+	auto available = this->file.size() - sizeof(fileHeader);
+
+	if(memcmp(fileHeader.magic, "EPPL", 4) != 0 || fileHeader.version != Playlist::Version
+		|| fileHeader.blockCount > available / sizeof(uint64_t) || fileHeader.poolBytes > available
+		|| fileHeader.blockCount != fileHeader.count / BlockSize + (fileHeader.count % BlockSize != 0 ? 1 : 0)
+		|| available < fileHeader.blockCount * sizeof(uint64_t) + fileHeader.poolBytes)
+	{
+		this->file.close();
+		return false;
+	}
+
+	this->header = fileHeader;
+
+	// Every block has to start inside the pool, in order, the first at its start.
+	uint64_t previous = 0;
+
+	for(size_t i = 0; i < this->header.blockCount; i++)
+	{
+		auto offset = this->getBlockOffset(i);
+
+		if(offset < previous || offset >= this->header.poolBytes || (i == 0 && offset != 0))
+		{
+			this->clear();
+			return false;
+		}
+
+		previous = offset;
+	}
+
+	this->fileName = fileName;
+	return true;
+}
+
+void Playlist::assign(const Playlist& other)
+{
+	if(this == &other)
+	{
+		return;
+	}
+
+	this->clear();
+
+	if(other.file.isOpen() == true && this->open(other.fileName) == true)
+	{
+		return;
+	}
+
+	auto pool = other.getPool();
+	this->pool.assign(pool, pool + other.header.poolBytes);
+
+	this->offsets.resize(static_cast<size_t>(other.header.blockCount));
+	for(size_t i = 0; i < this->offsets.size(); i++)
+	{
+		this->offsets[i] = other.getBlockOffset(i);
+	}
+
+	this->header = other.header;
+	this->last = other.last;
+}
+
+bool Playlist::save(const std::string& fileName)
+{
+	// Replacing the file we're mapped onto needs our own copy first.
+	if(this->file.isOpen() == true && fileName == this->fileName)
+	{
+		this->detach();
+	}
+
+	PlaylistHeader fileHeader = this->header;
+	memcpy(fileHeader.magic, "EPPL", 4);
+	fileHeader.version = Playlist::Version;
+
+	auto temporaryFileName = fileName + ".tmp";
+	std::ofstream os;
+	os.open(temporaryFileName.c_str(), std::ios_base::binary | std::ios_base::trunc);
+
+	if(os.is_open() == false)
+	{
+		return false;
+	}
+
+	os.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+
+	for(size_t i = 0; i < fileHeader.blockCount; i++)
+	{
+		auto offset = this->getBlockOffset(i);
+		os.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+	}
+
+	os.write(reinterpret_cast<const char*>(this->getPool()), fileHeader.poolBytes);
+	os.close();
+
+	if(os.fail() == true)
+	{
+		std::remove(temporaryFileName.c_str());
+		return false;
+	}
+
+	std::remove(fileName.c_str());
+	return std::rename(temporaryFileName.c_str(), fileName.c_str()) == 0;
+}
+
+bool Playlist::importText(const std::string& fileName)
+{
+	std::ifstream is;
+	is.open(fileName);
+
+	if(is.is_open() == false)
+	{
+		return false;
+	}
+
+	this->clear();
+
+	while(is.eof() == false)
+	{
+		std::string line;
+		std::getline(is, line);
+
+		if(line.empty() == false && line[line.size() - 1] == '\r')
+		{
+			line.erase(line.size() - 1);
+		}
+
+		if(line.empty() == false)
+		{
+			this->push_back(line);
+		}
+	}
+
+	return true;
+}
+
+bool Playlist::exportText(const std::string& fileName) const
+{
+	std::ofstream os;
+	os.open(fileName.c_str());
+
+	if(os.is_open() == false)
+	{
+		return false;
+	}
+
+	this->forEach(
+		[&os](const std::string& entry)
+		{
+			os << entry << "\n";
+		});
+
+	return os.fail() == false;
+}
+
+void Playlist::clear()
+{
+	this->file.close();
+	this->fileName.clear();
+	memset(&this->header, 0, sizeof(this->header));
+	this->pool.clear();
+	this->offsets.clear();
+	this->last.clear();
+}
+
+void Playlist::push_back(const std::string& fileName)
+{
+	this->detach();
+
+	size_t shared = 0;
+
+	if(this->header.count % BlockSize == 0)
+	{
+		this->offsets.push_back(this->pool.size());
+		this->header.blockCount++;
+	}
+	else
+	{
+		auto limit = std::min(fileName.size(), this->last.size());
+
+		while(shared < limit && fileName[shared] == this->last[shared])
+		{
+			shared++;
+		}
+	}
+
+	writeVarint(this->pool, shared);
+	writeVarint(this->pool, fileName.size() - shared);
+	this->pool.insert(std::end(this->pool), std::begin(fileName) + shared, std::end(fileName));
+
+	this->last = fileName;
+	this->header.count++;
+	this->header.poolBytes = this->pool.size();
+}
+
+size_t Playlist::size() const
+{
+	return static_cast<size_t>(this->header.count);
+}
+
+bool Playlist::empty() const
+{
+	return this->header.count == 0;
+}
+
+size_t Playlist::getMemoryBytes() const
+{
+	return this->pool.capacity() + this->offsets.capacity() * sizeof(uint64_t) + this->last.capacity() + this->fileName.capacity();
+}
+
+std::string Playlist::operator[](size_t index) const
+{
+	std::string entry;
+	this->get(index, entry);
+	return entry;
+}
+
+void Playlist::get(size_t index, std::string& entry) const
+{
+	entry.clear();
+
+	if(index >= this->size())
+	{
+		return;
+	}
+
+	auto end = this->getPool() + this->header.poolBytes;
+	auto p = this->getPool() + this->getBlockOffset(index / BlockSize);
+
+	for(size_t i = 0; i <= index % BlockSize; i++)
+	{
+		p = Playlist::decode(p, end, entry);
+
+		if(p == nullptr)
+		{
+			entry.clear();
+			return;
+		}
+	}
+}
+
+void Playlist::forEach(const std::function<void(const std::string&)>& f) const
+{
+	std::string entry;
+	auto p = this->getPool();
+	auto end = p + this->header.poolBytes;
+
+	for(size_t i = 0; i < this->size(); i++)
+	{
+		p = Playlist::decode(p, end, entry);
+
+		if(p == nullptr)
+		{
+			return;
+		}
+
+		f(entry);
+	}
+}
+
+void Playlist::detach()
+{
+	if(this->file.isOpen() == false)
+	{
+		return;
+	}
+
+	auto pool = this->getPool();
+	this->pool.assign(pool, pool + this->header.poolBytes);
+
+	this->offsets.resize(static_cast<size_t>(this->header.blockCount));
+	for(size_t i = 0; i < this->offsets.size(); i++)
+	{
+		this->offsets[i] = this->getBlockOffset(i);
+	}
+
+	this->last = this->empty() == true ? std::string() : (*this)[this->size() - 1];
+
+	this->file.close();
+	this->fileName.clear();
+}
+
+const uint8_t* Playlist::getPool() const
+{
+	if(this->file.isOpen() == true)
+	{
+		return this->file.data() + sizeof(PlaylistHeader) + this->header.blockCount * sizeof(uint64_t);
+	}
+
+	return this->pool.data();
+}
+
+uint64_t Playlist::getBlockOffset(size_t block) const
+{
+	if(this->file.isOpen() == true)
+	{
+		// The table isn't necessarily aligned in the mapping.
+		uint64_t offset;
+		memcpy(&offset, this->file.data() + sizeof(PlaylistHeader) + block * sizeof(uint64_t), sizeof(offset));
+		return offset;
+	}
+
+	return this->offsets[block];
+}
+
+const uint8_t* Playlist::decode(const uint8_t* p, const uint8_t* end, std::string& entry)
+{
+	uint64_t shared = 0;
+	uint64_t length = 0;
+	p = readVarint(p, end, shared);
+	p = (p != nullptr) ? readVarint(p, end, length) : nullptr;
+
+	if(p == nullptr || length > static_cast<uint64_t>(end - p))
+	{
+		return nullptr;
+	}
+
+	entry.resize(std::min(static_cast<size_t>(shared), entry.size()));
+	entry.append(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+	return p + length;
+}
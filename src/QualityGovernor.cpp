@@ -0,0 +1,220 @@
+#include "QualityGovernor.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Weight of the newest frame in the running average.
+	const double Smoothing = 0.1;
+
+	// Drop a level after this many frames over target by more than 10%.
+	const double DropRatio = 1.1;
+	const int DropFrames = 15;
+
+	// Climb a level after this many frames under 75% of target.
+	const double ClimbRatio = 0.75;
+	const int ClimbFrames = 180;
+
+	// Frames to wait after any change before judging again.
+	const int HoldFrames = 60;
+
+	int percent(float fraction)
+	{
+		return static_cast<int>(fraction * 100.0f + 0.5f);
+	}
+}
+
+QualityBounds::QualityBounds() :
+	targetMs(14.0),
+	maxEmissionStride(4),
+	minPointPasses(1),
+	minWaveScale(0.25f),
+	minAgeScale(0.5f),
+	minRenderScale(0.5f)
+{
+}
+
+QualityLevel::QualityLevel() :
+	emissionStride(1),
+	pointPasses(3),
+	waveScale(1.0f),
+	ageScale(1.0f),
+	renderScale(1.0f)
+{
+}
+
+QualityGovernor::QualityGovernor() :
+	index(0),
+	enabled(false),
+	lastFrame(0),
+	averageMs(0),
+	overFrames(0),
+	underFrames(0),
+	holdFrames(0)
+{
+	this->configure(QualityBounds());
+}
+
+void QualityGovernor::configure(const QualityBounds& bounds)
+{
+	this->bounds = bounds;
+	this->levels.clear();
+
+	// Each round takes one notch off every setting that still has room, the
+	// cheapest-looking first, so the ladder degrades everything gradually.
+	QualityLevel level;
+	this->levels.push_back(level);
+
+	auto changed = true;
+
+	while(changed == true)
+	{
+		changed = false;
+
+		if(level.emissionStride < bounds.maxEmissionStride)
+		{
+			level.emissionStride++;
+			this->levels.push_back(level);
+			changed = true;
+		}
+
+		if(level.pointPasses > std::max(bounds.minPointPasses, 1))
+		{
+			level.pointPasses--;
+			this->levels.push_back(level);
+			changed = true;
+		}
+
+		if(level.ageScale > bounds.minAgeScale)
+		{
+			level.ageScale = std::max(level.ageScale * 0.75f, bounds.minAgeScale);
+			this->levels.push_back(level);
+			changed = true;
+		}
+
+		if(level.waveScale > bounds.minWaveScale)
+		{
+			level.waveScale = std::max(level.waveScale * 0.75f, bounds.minWaveScale);
+			this->levels.push_back(level);
+			changed = true;
+		}
+
+		if(level.renderScale > bounds.minRenderScale)
+		{
+			level.renderScale = std::max(level.renderScale - 0.125f, bounds.minRenderScale);
+			this->levels.push_back(level);
+			changed = true;
+		}
+	}
+
+	this->reset();
+}
+
+const QualityBounds& QualityGovernor::getBounds() const
+{
+	return this->bounds;
+}
+
+void QualityGovernor::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	this->reset();
+}
+
+bool QualityGovernor::isEnabled() const
+{
+	return this->enabled;
+}
+
+bool QualityGovernor::update(const FrameProfiler::Frame& frame)
+{
+	if(this->enabled == false || frame.index == this->lastFrame)
+	{
+		return false;
+	}
+
+	this->lastFrame = frame.index;
+
+	// Work the UI thread did; the swap is vsync and frame rate limiting, not load.
+	// A single stall (a window drag, a file dialog) shouldn't swing the average much.
+	auto work = static_cast<double>(frame.total - frame.phaseDuration[FrameProfiler::Phase_Swap]);
+	work = std::min(std::max(work, 0.0), this->bounds.targetMs * 4.0);
+
+	this->averageMs = (this->averageMs == 0) ? work : this->averageMs + (work - this->averageMs) * Smoothing;
+
+	if(this->holdFrames > 0)
+	{
+		this->holdFrames--;
+		return false;
+	}
+
+	this->overFrames = (this->averageMs > this->bounds.targetMs * DropRatio) ? this->overFrames + 1 : 0;
+	this->underFrames = (this->averageMs < this->bounds.targetMs * ClimbRatio) ? this->underFrames + 1 : 0;
+
+	auto previous = this->index;
+
+	if(this->overFrames >= DropFrames && this->index + 1 < this->levels.size())
+	{
+		this->index++;
+	}
+	else if(this->underFrames >= ClimbFrames && this->index > 0)
+	{
+		this->index--;
+	}
+
+	if(this->index == previous)
+	{
+		return false;
+	}
+
+	this->overFrames = 0;
+	this->underFrames = 0;
+	this->holdFrames = HoldFrames;
+	return true;
+}
+
+const QualityLevel& QualityGovernor::getLevel() const
+{
+	return this->levels[this->index];
+}
+
+size_t QualityGovernor::getLevelIndex() const
+{
+	return this->index;
+}
+
+size_t QualityGovernor::getLevelCount() const
+{
+	return this->levels.size();
+}
+
+double QualityGovernor::getAverageMs() const
+{
+	return this->averageMs;
+}
+
+std::string QualityGovernor::describe() const
+{
+	if(this->enabled == false)
+	{
+		return "Quality: full (governor off)";
+	}
+
+	const QualityLevel& level = this->getLevel();
+
+	return "Quality: level " + std::to_string(this->index) + " / " + std::to_string(this->levels.size() - 1)
+		+ ", " + std::to_string(this->averageMs) + " of " + std::to_string(this->bounds.targetMs) + " ms"
+		+ (this->holdFrames > 0 ? " (holding)" : "")
+		+ "; stride " + std::to_string(level.emissionStride) + ", passes " + std::to_string(level.pointPasses)
+		+ ", wave " + std::to_string(percent(level.waveScale)) + "%, age " + std::to_string(percent(level.ageScale))
+		+ "%, resolution " + std::to_string(percent(level.renderScale)) + "%";
+}
+
+void QualityGovernor::reset()
+{
+	this->index = 0;
+	this->averageMs = 0;
+	this->overFrames = 0;
+	this->underFrames = 0;
+	this->holdFrames = 0;
+}
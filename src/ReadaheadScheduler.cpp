@@ -0,0 +1,188 @@
+#include "ReadaheadScheduler.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Enough of the file for FMOD to open it and fill its first stream buffers.
+	const uint64_t HeadBytes = 2 * 1024 * 1024;
+
+	// Cancellation is checked between chunks.
+	const uint64_t ChunkBytes = 1024 * 1024;
+}
+
+ReadaheadScheduler::ReadaheadScheduler() :
+	hasSchedule(false),
+	busy(false),
+	budget(0),
+	generation(0),
+	warmedBytes(0),
+	warmedFiles(0),
+	running(false)
+{
+}
+
+ReadaheadScheduler::~ReadaheadScheduler()
+{
+	this->stop();
+}
+
+void ReadaheadScheduler::start(uint64_t budget)
+{
+	this->stop();
+
+	this->budget = budget;
+	this->running = true;
+	this->thread = std::thread(&ReadaheadScheduler::run, this);
+}
+
+void ReadaheadScheduler::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->running = false;
+		this->generation++;
+	}
+
+	this->condition.notify_all();
+
+	if(this->thread.joinable() == true)
+	{
+		this->thread.join();
+	}
+}
+
+void ReadaheadScheduler::schedule(const std::vector<std::string>& fileNames)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if(this->running == false)
+		{
+			return;
+		}
+
+		this->fileNames = fileNames;
+		this->hasSchedule = true;
+		this->generation++;
+	}
+
+	this->condition.notify_one();
+}
+
+void ReadaheadScheduler::cancel()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->fileNames.clear();
+	this->hasSchedule = false;
+	this->generation++;
+}
+
+bool ReadaheadScheduler::isBusy() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->busy == true || this->hasSchedule == true;
+}
+
+uint64_t ReadaheadScheduler::getWarmedBytes() const
+{
+	return this->warmedBytes;
+}
+
+size_t ReadaheadScheduler::getWarmedFiles() const
+{
+	return this->warmedFiles;
+}
+
+void ReadaheadScheduler::run()
+{
+	while(true)
+	{
+		std::vector<std::string> files;
+		unsigned int scheduleGeneration = 0;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->busy = false;
+
+			while(this->running == true && this->hasSchedule == false)
+			{
+				this->condition.wait(lock);
+			}
+
+			if(this->running == false)
+			{
+				break;
+			}
+
+			files.swap(this->fileNames);
+			this->hasSchedule = false;
+			this->busy = true;
+			scheduleGeneration = this->generation;
+		}
+
+		std::vector<uint64_t> sizes(files.size(), 0);
+		uint64_t remaining = this->budget;
+		auto current = true;
+
+		// First pass: the head of every track, so any of them can start without waiting on the disk.
+		for(size_t i = 0; i < files.size() && remaining > 0 && current == true; i++)
+		{
+			MappedFile file;
+
+			if(file.open(files[i], MappedFile::StreamWindow) == true)
+			{
+				sizes[i] = file.size();
+			}
+
+			auto count = std::min(std::min(sizes[i], HeadBytes), remaining);
+			current = this->warm(files[i], 0, count, scheduleGeneration);
+			remaining -= count;
+		}
+
+		// Second pass: the rest of each track, nearest first.
+		for(size_t i = 0; i < files.size() && remaining > 0 && current == true; i++)
+		{
+			if(sizes[i] > HeadBytes)
+			{
+				auto count = std::min(sizes[i] - HeadBytes, remaining);
+				current = this->warm(files[i], HeadBytes, count, scheduleGeneration);
+				remaining -= count;
+			}
+
+			if(current == true && sizes[i] > 0)
+			{
+				this->warmedFiles++;
+			}
+		}
+	}
+}
+
+bool ReadaheadScheduler::warm(const std::string& fileName, uint64_t offset, uint64_t count, unsigned int generation)
+{
+	if(count == 0)
+	{
+		return this->generation == generation;
+	}
+
+	MappedFile file;
+
+	if(file.open(fileName, MappedFile::StreamWindow) == false)
+	{
+		return this->generation == generation;
+	}
+
+	for(uint64_t done = 0; done < count; done += ChunkBytes)
+	{
+		if(this->generation != generation)
+		{
+			return false;
+		}
+
+		auto chunk = std::min(ChunkBytes, count - done);
+		file.prefetch(offset + done, chunk);
+		this->warmedBytes += chunk;
+	}
+
+	return this->generation == generation;
+}
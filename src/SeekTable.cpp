@@ -0,0 +1,255 @@
+#include "SeekTable.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	// Kilobits per second by [MPEG-1 ? 0 : 1][layer - 1][index].
+	const uint16_t Bitrates[2][3][15] =
+	{
+		{
+			{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+			{0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+			{0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320}
+		},
+		{
+			{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+			{0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+			{0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}
+		}
+	};
+
+	const uint32_t SampleRates[3] = {44100, 48000, 32000};
+
+	// More than the longest frame (MPEG-2 layer II at 8 kHz) plus the next frame's header.
+	const uint64_t MaxFrameBytes = 4096;
+
+	uint32_t readBigEndian(const uint8_t* p)
+	{
+		return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+	}
+
+	// Size of a leading ID3v2 tag, or zero.
+	uint64_t getId3Size(const uint8_t* data, uint64_t size)
+	{
+		if(size < 10 || memcmp(data, "ID3", 3) != 0)
+		{
+			return 0;
+		}
+
+		auto tagSize = (static_cast<uint64_t>(data[6] & 0x7f) << 21) | ((data[7] & 0x7f) << 14) | ((data[8] & 0x7f) << 7) | (data[9] & 0x7f);
+		auto footer = (data[5] & 0x10) != 0 ? 10 : 0;
+		return 10 + tagSize + footer;
+	}
+}
+
+SeekTable::SeekTable()
+{
+	memset(&this->header, 0, sizeof(this->header));
+}
+
+bool SeekTable::parseFrame(const uint8_t* p, Mp3Frame& frame)
+{
+	if(p[0] != 0xff || (p[1] & 0xe0) != 0xe0)
+	{
+		return false;
+	}
+
+	auto version = (p[1] >> 3) & 3;
+	auto layer = 4 - ((p[1] >> 1) & 3);
+	auto bitrateIndex = (p[2] >> 4) & 15;
+	auto sampleRateIndex = (p[2] >> 2) & 3;
+	auto padding = (p[2] >> 1) & 1;
+
+	// Reserved version or layer, free format or bad bitrate, reserved sample rate.
+	if(version == 1 || layer == 4 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+	{
+		return false;
+	}
+
+	frame.mpeg1 = (version == 3);
+	auto bitrate = Bitrates[frame.mpeg1 == true ? 0 : 1][layer - 1][bitrateIndex] * 1000;
+
+	// MPEG-2 halves the sample rates of MPEG-1, MPEG-2.5 quarters them.
+	frame.sampleRate = SampleRates[sampleRateIndex] >> (version == 3 ? 0 : (version == 2 ? 1 : 2));
+	frame.channels = ((p[3] >> 6) & 3) == 3 ? 1 : 2;
+
+	if(layer == 1)
+	{
+		frame.samples = 384;
+		frame.length = (12 * bitrate / frame.sampleRate + padding) * 4;
+	}
+	else
+	{
+		frame.samples = (layer == 3 && frame.mpeg1 == false) ? 576 : 1152;
+		frame.length = (frame.samples / 8) * bitrate / frame.sampleRate + padding;
+	}
+
+	return frame.length >= 4;
+}
+
+bool SeekTable::build(const std::string& mp3FileName, const std::string& cacheFileName, uint64_t key)
+{
+	// Read through a window; a long mix mapped whole would take its length in address space.
+	MappedFile mp3;
+
+	if(mp3.open(mp3FileName, MappedFile::StreamWindow) == false)
+	{
+		return false;
+	}
+
+	auto size = mp3.size();
+
+	// An ID3v1 tag at the end would otherwise look like trailing garbage.
+	if(size >= 128 && memcmp(mp3.view(size - 128, 3), "TAG", 3) == 0)
+	{
+		size -= 128;
+	}
+
+	SeekTableHeader fileHeader;
+	memset(&fileHeader, 0, sizeof(fileHeader));
+	memcpy(fileHeader.magic, "EPSK", 4);
+	fileHeader.version = SeekTable::Version;
+	fileHeader.key = key;
+
+	auto position = getId3Size(mp3.view(0, std::min<uint64_t>(size, 10)), size);
+	auto first = true;
+	Mp3Frame frame;
+
+	while(position + 4 <= size)
+	{
+		// Covers this frame and the next one's header.
+		auto data = mp3.view(position, std::min(MaxFrameBytes, size - position));
+
+		if(data == nullptr)
+		{
+			return false;
+		}
+
+		if(SeekTable::parseFrame(data, frame) == false || position + frame.length > size)
+		{
+			// Lost sync: look for the next header that is followed by another valid one.
+			position++;
+
+			while(position + 4 <= size)
+			{
+				Mp3Frame next;
+				data = mp3.view(position, std::min(MaxFrameBytes, size - position));
+
+				if(data == nullptr)
+				{
+					return false;
+				}
+
+				if(SeekTable::parseFrame(data, frame) == true && position + frame.length + 4 <= size
+					&& SeekTable::parseFrame(data + frame.length, next) == true && next.sampleRate == frame.sampleRate)
+				{
+					break;
+				}
+
+				position++;
+			}
+
+			continue;
+		}
+
+		if(first == true)
+		{
+			first = false;
+			fileHeader.sampleRate = frame.sampleRate;
+			fileHeader.channels = frame.channels;
+			fileHeader.samplesPerFrame = frame.samples;
+
+			// A Xing/Info frame carries no audio but may hold LAME's encoder delay and padding.
+			uint32_t sideInfo = frame.mpeg1 == true ? (frame.channels == 1 ? 17 : 32) : (frame.channels == 1 ? 9 : 17);
+			auto xing = data + 4 + sideInfo;
+
+			if(4 + sideInfo + 8 <= frame.length && (memcmp(xing, "Xing", 4) == 0 || memcmp(xing, "Info", 4) == 0))
+			{
+				auto flags = readBigEndian(xing + 4);
+				auto lame = xing + 8 + ((flags & 1) ? 4 : 0) + ((flags & 2) ? 4 : 0) + ((flags & 4) ? 100 : 0) + ((flags & 8) ? 4 : 0);
+
+				if(lame + 24 <= data + frame.length && memcmp(lame, "LAME", 4) == 0)
+				{
+					fileHeader.encoderDelay = (lame[21] << 4) | (lame[22] >> 4);
+					fileHeader.encoderPadding = ((lame[22] & 0x0f) << 8) | lame[23];
+				}
+
+				position += frame.length;
+				continue;
+			}
+		}
+
+		fileHeader.frameCount++;
+		position += frame.length;
+	}
+
+	if(fileHeader.frameCount == 0)
+	{
+		return false;
+	}
+
+	auto temporaryFileName = cacheFileName + ".tmp";
+	std::ofstream os;
+	os.open(temporaryFileName.c_str(), std::ios_base::binary | std::ios_base::trunc);
+
+	if(os.is_open() == false)
+	{
+		return false;
+	}
+
+	os.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+	os.close();
+
+	if(os.fail() == true)
+	{
+		std::remove(temporaryFileName.c_str());
+		return false;
+	}
+
+	std::remove(cacheFileName.c_str());
+	return std::rename(temporaryFileName.c_str(), cacheFileName.c_str()) == 0;
+}
+
+bool SeekTable::open(const std::string& cacheFileName, uint64_t key)
+{
+	std::ifstream is;
+	is.open(cacheFileName.c_str(), std::ios_base::binary);
+	is.read(reinterpret_cast<char*>(&this->header), sizeof(this->header));
+
+	if(is.fail() == true || memcmp(this->header.magic, "EPSK", 4) != 0 || this->header.version != SeekTable::Version
+		|| this->header.key != key || this->header.sampleRate == 0 || this->header.samplesPerFrame == 0)
+	{
+		memset(&this->header, 0, sizeof(this->header));
+		return false;
+	}
+
+	return true;
+}
+
+const SeekTableHeader& SeekTable::getHeader() const
+{
+	return this->header;
+}
+
+uint64_t SeekTable::getSampleCount() const
+{
+	return this->header.frameCount * this->header.samplesPerFrame;
+}
+
+uint64_t SeekTable::getLeadingSamples() const
+{
+	auto lame = (this->header.encoderDelay > 0 || this->header.encoderPadding > 0);
+	return lame == true ? static_cast<uint64_t>(this->header.encoderDelay) + DecoderDelay : 0;
+}
+
+uint64_t SeekTable::getGaplessSampleCount() const
+{
+	// LAME's padding already covers the decoder delay at the end.
+	auto trim = static_cast<uint64_t>(this->header.encoderDelay) + this->header.encoderPadding;
+	return this->getSampleCount() > trim ? this->getSampleCount() - trim : 0;
+}
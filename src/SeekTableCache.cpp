@@ -0,0 +1,214 @@
+#include "SeekTableCache.h"
+#include "FileIdentity.h"
+
+#include "cinder/Filesystem.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace
+{
+	// Number of mapped tables kept open; only the current and next track are ever needed.
+	const size_t ReadyCount = 8;
+
+	// Seconds before a track that failed is looked at again, in case the file was replaced.
+	const double RetrySeconds = 30.0;
+
+	bool isMp3(const std::string& fileName)
+	{
+		if(fileName.size() < 4)
+		{
+			return false;
+		}
+
+		auto extension = fileName.substr(fileName.size() - 4);
+		std::transform(std::begin(extension), std::end(extension), std::begin(extension), ::tolower);
+		return extension == ".mp3";
+	}
+}
+
+SeekTableCache::SeekTableCache() :
+	builtCount(0),
+	running(false)
+{
+}
+
+SeekTableCache::~SeekTableCache()
+{
+	this->stop();
+}
+
+void SeekTableCache::start(const std::string& directory)
+{
+	this->stop();
+
+	this->directory = directory;
+	this->timer.start();
+
+	try
+	{
+		ci::fs::create_directories(this->directory);
+	}
+	catch(...)
+	{
+		return;
+	}
+
+	this->running = true;
+	this->thread = std::thread(&SeekTableCache::run, this);
+}
+
+void SeekTableCache::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->running = false;
+	}
+
+	this->condition.notify_all();
+
+	if(this->thread.joinable() == true)
+	{
+		this->thread.join();
+	}
+}
+
+void SeekTableCache::request(const std::string& fileName)
+{
+	if(isMp3(fileName) == false)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if(this->running == false || this->pending.count(fileName) > 0)
+	{
+		return;
+	}
+
+	auto failure = this->failed.find(fileName);
+
+	if(failure != std::end(this->failed) && this->timer.getSeconds() - failure->second.time < RetrySeconds)
+	{
+		return;
+	}
+
+	auto isReady = std::find_if(std::begin(this->ready), std::end(this->ready),
+		[&fileName](const ReadyEntry& entry)
+		{
+			return entry.first == fileName;
+		}) != std::end(this->ready);
+
+	if(isReady == false)
+	{
+		this->pending.insert(fileName);
+		this->queue.push_back(fileName);
+		this->condition.notify_one();
+	}
+}
+
+std::shared_ptr<const SeekTable> SeekTableCache::get(const std::string& fileName)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		auto entry = std::find_if(std::begin(this->ready), std::end(this->ready),
+			[&fileName](const ReadyEntry& entry)
+			{
+				return entry.first == fileName;
+			});
+
+		if(entry != std::end(this->ready))
+		{
+			this->ready.splice(std::begin(this->ready), this->ready, entry);
+			return this->ready.front().second;
+		}
+	}
+
+	this->request(fileName);
+	return std::shared_ptr<const SeekTable>();
+}
+
+size_t SeekTableCache::getPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->pending.size();
+}
+
+uint64_t SeekTableCache::getBuiltCount() const
+{
+	return this->builtCount;
+}
+
+void SeekTableCache::run()
+{
+	while(true)
+	{
+		std::string fileName;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			while(this->running == true && this->queue.empty() == true)
+			{
+				this->condition.wait(lock);
+			}
+
+			if(this->running == false)
+			{
+				break;
+			}
+
+			fileName = this->queue.front();
+			this->queue.pop_front();
+		}
+
+		auto key = FileIdentity::getKey(fileName);
+		auto cacheFileName = this->getCacheFileName(key);
+
+		auto unchanged = false;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			auto failure = this->failed.find(fileName);
+			unchanged = (failure != std::end(this->failed) && failure->second.key == key);
+		}
+
+		auto table = std::make_shared<SeekTable>();
+		auto usable = (key != 0 && table->open(cacheFileName, key) == true);
+
+		// Only scan a file that failed before if it has changed since.
+		if(usable == false && key != 0 && unchanged == false && SeekTable::build(fileName, cacheFileName, key) == true)
+		{
+			table = std::make_shared<SeekTable>();
+			usable = table->open(cacheFileName, key);
+			this->builtCount++;
+		}
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->pending.erase(fileName);
+
+		if(usable == true)
+		{
+			this->failed.erase(fileName);
+			this->ready.push_front(ReadyEntry(fileName, table));
+
+			while(this->ready.size() > ReadyCount)
+			{
+				this->ready.pop_back();
+			}
+		}
+		else
+		{
+			Failure failure = {key, this->timer.getSeconds()};
+			this->failed[fileName] = failure;
+		}
+	}
+}
+
+std::string SeekTableCache::getCacheFileName(uint64_t key) const
+{
+	char name[32];
+	sprintf(name, "%016llx.eps", static_cast<unsigned long long>(key));
+	return (ci::fs::path(this->directory) / name).string();
+}
@@ -0,0 +1,230 @@
+#include "SessionLog.h"
+
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+	enum FrameFlag
+	{
+		FrameFlag_Controls = 1,
+		FrameFlag_Analysis = 2
+	};
+}
+
+SessionFrame::SessionFrame() :
+	width(0),
+	height(0),
+	hasControls(false),
+	hasAnalysis(false),
+	waveMax(0),
+	spectrumMax(0),
+	timeDomain(true),
+	greyscale(false),
+	paletteVelocityScale(1.0f),
+	checksum(0)
+{
+	memset(&this->controls, 0, sizeof(this->controls));
+}
+
+SessionRecorder::SessionRecorder() :
+	frameCount(0)
+{
+}
+
+SessionRecorder::~SessionRecorder()
+{
+	this->close();
+}
+
+bool SessionRecorder::open(const std::string& fileName, uint32_t seed)
+{
+	this->close();
+	this->os.open(fileName.c_str(), std::ios_base::binary | std::ios_base::trunc);
+
+	if(this->os.is_open() == false)
+	{
+		return false;
+	}
+
+	SessionHeader header;
+	memcpy(header.magic, "EPSL", 4);
+	header.version = SessionRecorder::Version;
+	header.seed = seed;
+	header.frameCount = 0;
+
+	this->os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	this->frameCount = 0;
+	return this->os.good();
+}
+
+void SessionRecorder::close()
+{
+	if(this->os.is_open() == true)
+	{
+		this->os.seekp(offsetof(SessionHeader, frameCount));
+		this->os.write(reinterpret_cast<const char*>(&this->frameCount), sizeof(this->frameCount));
+		this->os.close();
+	}
+}
+
+bool SessionRecorder::isOpen() const
+{
+	return this->os.is_open();
+}
+
+void SessionRecorder::write(const SessionFrame& frame)
+{
+	if(this->os.is_open() == false)
+	{
+		return;
+	}
+
+	uint8_t flags = (frame.hasControls == true ? FrameFlag_Controls : 0) | (frame.hasAnalysis == true ? FrameFlag_Analysis : 0);
+
+	this->os.write(reinterpret_cast<const char*>(&frame.width), sizeof(frame.width));
+	this->os.write(reinterpret_cast<const char*>(&frame.height), sizeof(frame.height));
+	this->os.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+
+	if(frame.hasControls == true)
+	{
+		this->os.write(reinterpret_cast<const char*>(&frame.controls), sizeof(frame.controls));
+	}
+
+	if(frame.hasAnalysis == true)
+	{
+		uint32_t waveCount = static_cast<uint32_t>(frame.wave.size());
+		uint32_t spectrumCount = static_cast<uint32_t>(frame.spectrum.size());
+		uint8_t palette = (frame.timeDomain == true ? 1 : 0) | (frame.greyscale == true ? 2 : 0);
+
+		this->os.write(reinterpret_cast<const char*>(&waveCount), sizeof(waveCount));
+		this->os.write(reinterpret_cast<const char*>(&spectrumCount), sizeof(spectrumCount));
+		this->os.write(reinterpret_cast<const char*>(frame.wave.data()), waveCount * sizeof(float));
+		this->os.write(reinterpret_cast<const char*>(frame.spectrum.data()), spectrumCount * sizeof(float));
+		this->os.write(reinterpret_cast<const char*>(&frame.waveMax), sizeof(frame.waveMax));
+		this->os.write(reinterpret_cast<const char*>(&frame.spectrumMax), sizeof(frame.spectrumMax));
+		this->os.write(reinterpret_cast<const char*>(&palette), sizeof(palette));
+		this->os.write(reinterpret_cast<const char*>(&frame.paletteVelocityScale), sizeof(frame.paletteVelocityScale));
+	}
+
+	this->os.write(reinterpret_cast<const char*>(&frame.checksum), sizeof(frame.checksum));
+	this->frameCount++;
+}
+
+uint32_t SessionRecorder::getFrameCount() const
+{
+	return this->frameCount;
+}
+
+SessionPlayer::SessionPlayer() :
+	position(0)
+{
+	memset(&this->header, 0, sizeof(this->header));
+}
+
+bool SessionPlayer::open(const std::string& fileName)
+{
+	if(this->file.open(fileName) == false || this->file.size() < sizeof(SessionHeader))
+	{
+		this->file.close();
+		return false;
+	}
+
+	memcpy(&this->header, this->file.data(), sizeof(this->header));
+
+	if(memcmp(this->header.magic, "EPSL", 4) != 0 || this->header.version != SessionRecorder::Version)
+	{
+		this->file.close();
+		return false;
+	}
+
+	this->rewind();
+	return true;
+}
+
+bool SessionPlayer::isOpen() const
+{
+	return this->file.isOpen();
+}
+
+bool SessionPlayer::next(SessionFrame& frame)
+{
+	uint8_t flags = 0;
+
+	if(this->read(&frame.width, sizeof(frame.width)) == false
+		|| this->read(&frame.height, sizeof(frame.height)) == false
+		|| this->read(&flags, sizeof(flags)) == false)
+	{
+		return false;
+	}
+
+	frame.hasControls = (flags & FrameFlag_Controls) != 0;
+	frame.hasAnalysis = (flags & FrameFlag_Analysis) != 0;
+
+	if(frame.hasControls == true && this->read(&frame.controls, sizeof(frame.controls)) == false)
+	{
+		return false;
+	}
+
+	if(frame.hasAnalysis == true)
+	{
+		uint32_t waveCount = 0;
+		uint32_t spectrumCount = 0;
+		uint8_t palette = 0;
+
+		if(this->read(&waveCount, sizeof(waveCount)) == false || this->read(&spectrumCount, sizeof(spectrumCount)) == false)
+		{
+			return false;
+		}
+
+		if(this->position + (static_cast<uint64_t>(waveCount) + spectrumCount) * sizeof(float) > this->file.size())
+		{
+			return false;
+		}
+
+		frame.wave.resize(waveCount);
+		frame.spectrum.resize(spectrumCount);
+
+		if(this->read(frame.wave.data(), waveCount * sizeof(float)) == false
+			|| this->read(frame.spectrum.data(), spectrumCount * sizeof(float)) == false
+			|| this->read(&frame.waveMax, sizeof(frame.waveMax)) == false
+			|| this->read(&frame.spectrumMax, sizeof(frame.spectrumMax)) == false
+			|| this->read(&palette, sizeof(palette)) == false
+			|| this->read(&frame.paletteVelocityScale, sizeof(frame.paletteVelocityScale)) == false)
+		{
+			return false;
+		}
+
+		frame.timeDomain = (palette & 1) != 0;
+		frame.greyscale = (palette & 2) != 0;
+	}
+
+	return this->read(&frame.checksum, sizeof(frame.checksum));
+}
+
+void SessionPlayer::rewind()
+{
+	this->position = sizeof(SessionHeader);
+}
+
+uint32_t SessionPlayer::getSeed() const
+{
+	return this->header.seed;
+}
+
+uint32_t SessionPlayer::getFrameCount() const
+{
+	return this->header.frameCount;
+}
+
+bool SessionPlayer::read(void* out, size_t size)
+{
+	if(this->position + size > this->file.size())
+	{
+		return false;
+	}
+
+	memcpy(out, this->file.data() + this->position, size);
+	this->position += size;
+	return true;
+}
@@ -0,0 +1,151 @@
+#include "SignalGenerator.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	const char* TypeNames[SignalGenerator::Type_End] =
+	{
+		"sine",
+		"sweep",
+		"noise",
+		"impulse"
+	};
+}
+
+SignalGenerator::SignalGenerator(Type type, int sampleRate, int channels) :
+	type(type),
+	sampleRate(sampleRate),
+	channels(channels),
+	position(0),
+	noiseState(0x9e3779b9),
+	sweepPhase(0)
+{
+}
+
+bool SignalGenerator::parseType(const std::string& name, Type& type)
+{
+	for(int i = 0; i < Type_End; i++)
+	{
+		if(name == TypeNames[i])
+		{
+			type = static_cast<Type>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char* SignalGenerator::getTypeName(Type type)
+{
+	return type < Type_End ? TypeNames[type] : "unknown";
+}
+
+SignalGenerator::Type SignalGenerator::getType() const
+{
+	return this->type;
+}
+
+void SignalGenerator::generate(float* out, size_t frames)
+{
+	for(size_t i = 0; i < frames; i++)
+	{
+		auto value = this->next();
+
+		for(int c = 0; c < this->channels; c++)
+		{
+			*out++ = value;
+		}
+	}
+}
+
+FMOD::Sound* SignalGenerator::createSound(FMOD::System* system)
+{
+	FMOD_CREATESOUNDEXINFO info;
+	memset(&info, 0, sizeof(info));
+	info.cbsize = sizeof(info);
+	info.format = FMOD_SOUND_FORMAT_PCMFLOAT;
+	info.numchannels = this->channels;
+	info.defaultfrequency = this->sampleRate;
+	info.decodebuffersize = 4096;
+	// The length only sets the loop point; the signal itself never repeats.
+	info.length = static_cast<unsigned int>(this->sampleRate * this->channels * sizeof(float) * 60);
+	info.pcmreadcallback = &SignalGenerator::readCallback;
+	info.pcmsetposcallback = &SignalGenerator::setPositionCallback;
+	info.userdata = this;
+
+	FMOD::Sound* sound = nullptr;
+
+	if(system->createSound(nullptr, FMOD_SOFTWARE | FMOD_OPENUSER | FMOD_CREATESTREAM | FMOD_LOOP_NORMAL, &info, &sound) != FMOD_OK)
+	{
+		return nullptr;
+	}
+
+	return sound;
+}
+
+FMOD_RESULT F_CALLBACK SignalGenerator::readCallback(FMOD_SOUND* sound, void* data, unsigned int length)
+{
+	void* userData = nullptr;
+	reinterpret_cast<FMOD::Sound*>(sound)->getUserData(&userData);
+
+	auto generator = static_cast<SignalGenerator*>(userData);
+
+	if(generator != nullptr)
+	{
+		generator->generate(static_cast<float*>(data), length / (sizeof(float) * generator->channels));
+	}
+
+	return FMOD_OK;
+}
+
+FMOD_RESULT F_CALLBACK SignalGenerator::setPositionCallback(FMOD_SOUND* sound, int subsound, unsigned int position, FMOD_TIMEUNIT unit)
+{
+	// Seeking (and looping) just carries on with the signal.
+	return FMOD_OK;
+}
+
+float SignalGenerator::next()
+{
+	auto t = static_cast<double>(this->position) / this->sampleRate;
+	auto value = 0.0;
+
+	switch(this->type)
+	{
+		case Type_Sine:
+			value = 0.3 * (sin(2.0 * Pi * 110.0 * t) + sin(2.0 * Pi * 440.0 * t) + sin(2.0 * Pi * 1760.0 * t));
+			break;
+
+		case Type_Sweep:
+			{
+				// Integrate the instantaneous frequency so the phase stays continuous when the sweep restarts.
+				const double period = 10.0;
+				auto frequency = 20.0 * pow(1000.0, fmod(t, period) / period);
+				this->sweepPhase = fmod(this->sweepPhase + 2.0 * Pi * frequency / this->sampleRate, 2.0 * Pi);
+				value = 0.8 * sin(this->sweepPhase);
+			}
+			break;
+
+		case Type_Noise:
+			// xorshift32
+			this->noiseState ^= this->noiseState << 13;
+			this->noiseState ^= this->noiseState >> 17;
+			this->noiseState ^= this->noiseState << 5;
+			value = 0.5 * (static_cast<double>(this->noiseState) / 2147483648.0 - 1.0);
+			break;
+
+		case Type_Impulse:
+			value = (this->position % (this->sampleRate / 4) == 0) ? 1.0 : 0.0;
+			break;
+
+		default:
+			break;
+	}
+
+	this->position++;
+	return static_cast<float>(value);
+}
@@ -0,0 +1,95 @@
+#include "SoakTest.h"
+
+#include <cmath>
+
+SoakSettings::SoakSettings() :
+	hours(4.0),
+	trackSeconds(60.0),
+	warmupMinutes(10.0),
+	maxSlope(512.0 * 1024.0)
+{
+}
+
+SoakTest::SoakTest() :
+	timer(false),
+	running(false),
+	nextTrack(0)
+{
+}
+
+void SoakTest::start(const SoakSettings& settings)
+{
+	this->settings = settings;
+	this->running = true;
+	this->nextTrack = settings.trackSeconds;
+	this->timer.start();
+}
+
+void SoakTest::stop()
+{
+	this->running = false;
+	this->timer.stop();
+}
+
+bool SoakTest::isRunning() const
+{
+	return this->running;
+}
+
+const SoakSettings& SoakTest::getSettings() const
+{
+	return this->settings;
+}
+
+bool SoakTest::isTrackDue()
+{
+	if(this->running == false || this->timer.getSeconds() < this->nextTrack)
+	{
+		return false;
+	}
+
+	this->nextTrack += this->settings.trackSeconds;
+	return true;
+}
+
+bool SoakTest::isComplete() const
+{
+	return this->running == true && this->timer.getSeconds() >= this->settings.hours * 3600.0;
+}
+
+bool SoakTest::evaluate(const MemoryMonitor& monitor, std::ostream& os) const
+{
+	// The monitor's clock started before ours; only judge samples from after the warmup.
+	auto since = monitor.getSeconds() - this->timer.getSeconds() + this->settings.warmupMinutes * 60.0;
+	auto passed = true;
+
+	os << "Soak test: " << this->timer.getSeconds() / 3600.0 << " h, judged after " << this->settings.warmupMinutes << " min warmup" << std::endl;
+
+	for(int i = 0; i < MemoryLedger::Subsystem_End; i++)
+	{
+		auto subsystem = static_cast<MemoryLedger::Subsystem>(i);
+		auto slope = monitor.getSlope(subsystem, since);
+		auto maxSlope = monitor.getMaxSlope(subsystem) > 0 ? monitor.getMaxSlope(subsystem) : this->settings.maxSlope;
+		auto peak = monitor.getStats(subsystem).peak;
+		auto budget = monitor.getBudget(subsystem);
+
+		auto slopeOk = (slope <= maxSlope);
+		auto budgetOk = (budget == 0 || peak <= budget);
+		auto ok = (slopeOk == true && budgetOk == true);
+
+		os << "  " << MemoryLedger::getSubsystemName(subsystem) << ": " << slope / 1024.0 << " KB/h (limit " << maxSlope / 1024.0 << ")" 
+			<< (slopeOk == true ? "" : " GROWING") << ", peak " << peak / 1024 << " KB";
+
+		if(budget > 0)
+		{
+			os << " (budget " << budget / 1024 << ")" << (budgetOk == true ? "" : " OVER BUDGET");
+		}
+
+		os << " " << (ok == true ? "ok" : "FAIL") << std::endl;
+
+		passed = passed && ok;
+	}
+
+	os << (passed == true ? "Soak test passed" : "Soak test failed") << std::endl;
+	return passed;
+}
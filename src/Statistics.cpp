@@ -0,0 +1,126 @@
+#include "Statistics.h"
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+
+Distribution::Distribution() :
+	count(0),
+	mean(0),
+	min(0),
+	max(0),
+	p50(0),
+	p95(0),
+	p99(0)
+{
+}
+
+SampleWindow::SampleWindow(size_t capacity) :
+	capacity(capacity)
+{
+}
+
+void SampleWindow::push(double value)
+{
+	this->samples.push_back(value);
+
+	while(this->samples.size() > this->capacity)
+	{
+		this->samples.pop_front();
+	}
+}
+
+void SampleWindow::clear()
+{
+	this->samples.clear();
+}
+
+bool SampleWindow::empty() const
+{
+	return this->samples.empty();
+}
+
+double SampleWindow::last() const
+{
+	return this->samples.empty() == true ? 0.0 : this->samples.back();
+}
+
+Distribution SampleWindow::summarize() const
+{
+	return Statistics::summarize(std::vector<double>(std::begin(this->samples), std::end(this->samples)));
+}
+
+double Statistics::percentileSorted(const std::vector<double>& sorted, double p)
+{
+	if(sorted.empty() == true)
+	{
+		return 0;
+	}
+
+	auto rank = (p / 100.0) * static_cast<double>(sorted.size() - 1);
+	auto lower = static_cast<size_t>(rank);
+	auto upper = std::min(lower + 1, sorted.size() - 1);
+	auto fraction = rank - static_cast<double>(lower);
+
+	return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+}
+
+Distribution Statistics::summarize(std::vector<double> samples)
+{
+	Distribution d;
+
+	if(samples.empty() == true)
+	{
+		return d;
+	}
+
+	std::sort(std::begin(samples), std::end(samples));
+
+	d.count = samples.size();
+	d.mean = std::accumulate(std::begin(samples), std::end(samples), 0.0) / static_cast<double>(samples.size());
+	d.min = samples.front();
+	d.max = samples.back();
+	d.p50 = Statistics::percentileSorted(samples, 50);
+	d.p95 = Statistics::percentileSorted(samples, 95);
+	d.p99 = Statistics::percentileSorted(samples, 99);
+
+	return d;
+}
+
+double Statistics::slope(const std::vector<double>& x, const std::vector<double>& y)
+{
+	auto n = std::min(x.size(), y.size());
+
+	if(n < 2)
+	{
+		return 0;
+	}
+
+	auto meanX = std::accumulate(std::begin(x), std::begin(x) + n, 0.0) / static_cast<double>(n);
+	auto meanY = std::accumulate(std::begin(y), std::begin(y) + n, 0.0) / static_cast<double>(n);
+	auto covariance = 0.0;
+	auto variance = 0.0;
+
+	for(size_t i = 0; i < n; i++)
+	{
+		covariance += (x[i] - meanX) * (y[i] - meanY);
+		variance += (x[i] - meanX) * (x[i] - meanX);
+	}
+
+	return variance > 0 ? covariance / variance : 0.0;
+}
+
+std::string Statistics::toString(const Distribution& d, const std::string& units)
+{
+	std::ostringstream os;
+	os.precision(3);
+	os << std::fixed;
+	os << "n=" << d.count
+		<< " mean=" << d.mean << units
+		<< " min=" << d.min << units
+		<< " p50=" << d.p50 << units
+		<< " p95=" << d.p95 << units
+		<< " p99=" << d.p99 << units
+		<< " max=" << d.max << units;
+	return os.str();
+}
@@ -0,0 +1,159 @@
+#include "Stft.h"
+
+#include <algorithm>
+
+StftColumn::StftColumn() :
+	clock(0)
+{
+}
+
+Stft::Stft() :
+	windowSize(0),
+	hop(0),
+	newest(0),
+	columnCount(0),
+	nextClock(0),
+	columnsProcessed(0)
+{
+	this->configure(2048, 512, 32);
+}
+
+void Stft::configure(size_t windowSize, size_t hop, size_t historySize)
+{
+	this->fft.resize(windowSize);
+	this->windowSize = this->fft.size();
+	this->hop = std::min(std::max(hop, static_cast<size_t>(1)), this->windowSize);
+	this->input.resize(this->windowSize);
+
+	this->history.resize(std::max(historySize, static_cast<size_t>(2)));
+	std::for_each(std::begin(this->history), std::end(this->history),
+		[this](StftColumn& column)
+		{
+			column.left.assign(this->windowSize / 2, 0.0f);
+			column.right.assign(this->windowSize / 2, 0.0f);
+		});
+
+	this->reset();
+}
+
+void Stft::reset()
+{
+	this->newest = 0;
+	this->columnCount = 0;
+	this->nextClock = 0;
+}
+
+size_t Stft::getWindowSize() const
+{
+	return this->windowSize;
+}
+
+size_t Stft::getHop() const
+{
+	return this->hop;
+}
+
+size_t Stft::getBinCount() const
+{
+	return this->windowSize / 2;
+}
+
+size_t Stft::getMemoryBytes() const
+{
+	auto bytes = this->history.capacity() * sizeof(StftColumn) + this->input.capacity() * sizeof(float);
+
+	std::for_each(std::begin(this->history), std::end(this->history),
+		[&bytes](const StftColumn& column)
+		{
+			bytes += (column.left.capacity() + column.right.capacity()) * sizeof(float);
+		});
+
+	return bytes;
+}
+
+uint64_t Stft::getColumnsProcessed() const
+{
+	return this->columnsProcessed;
+}
+
+const StftColumn& Stft::getColumn(size_t age) const
+{
+	return this->history[(this->newest + this->history.size() - age) % this->history.size()];
+}
+
+size_t Stft::process(const AudioCapture& capture)
+{
+	auto writeClock = capture.getWriteClock();
+
+	// The mixer was recreated and its clock restarted.
+	if(this->nextClock > writeClock + this->windowSize)
+	{
+		this->reset();
+	}
+
+	// Never spend time on more backlog than the history can hold.
+	auto backlog = static_cast<uint64_t>(this->hop) * this->history.size();
+	if(this->columnCount == 0 || this->nextClock + backlog < writeClock)
+	{
+		this->nextClock = writeClock > backlog ? writeClock - backlog : writeClock;
+	}
+
+	size_t processed = 0;
+
+	while(this->nextClock <= writeClock)
+	{
+		this->newest = (this->newest + 1) % this->history.size();
+		StftColumn& column = this->history[this->newest];
+		column.clock = this->nextClock;
+
+		capture.getWindow(column.clock, this->input.size(), 0, this->input.data());
+		this->fft.magnitudes(this->input.data(), column.left.data());
+
+		capture.getWindow(column.clock, this->input.size(), 1, this->input.data());
+		this->fft.magnitudes(this->input.data(), column.right.data());
+
+		this->columnCount = std::min(this->columnCount + 1, this->history.size());
+		this->nextClock += this->hop;
+		processed++;
+	}
+
+	this->columnsProcessed += processed;
+	return processed;
+}
+
+bool Stft::getSpectrum(uint64_t clock, int channel, bool interpolate, float* out, size_t count) const
+{
+	if(this->columnCount == 0)
+	{
+		std::fill(out, out + count, 0.0f);
+		return false;
+	}
+
+	// Find the newest column at or before the clock.
+	size_t age = 0;
+	while(age + 1 < this->columnCount && this->getColumn(age).clock > clock)
+	{
+		age++;
+	}
+
+	const StftColumn& before = this->getColumn(age);
+	const StftColumn& after = this->getColumn(age > 0 ? age - 1 : 0);
+
+	auto t = 0.0f;
+	if(interpolate == true && age > 0 && clock > before.clock)
+	{
+		t = std::min(static_cast<float>(clock - before.clock) / static_cast<float>(after.clock - before.clock), 1.0f);
+	}
+
+	const std::vector<float>& a = (channel == 0) ? before.left : before.right;
+	const std::vector<float>& b = (channel == 0) ? after.left : after.right;
+
+	auto bins = a.size();
+	for(size_t i = 0; i < count; i++)
+	{
+		auto bin = std::min((i * bins) / count, bins - 1);
+		out[i] = a[bin] + (b[bin] - a[bin]) * t;
+	}
+
+	return true;
+}
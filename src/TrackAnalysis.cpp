@@ -0,0 +1,98 @@
+#include "TrackAnalysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+TrackAnalysis::TrackAnalysis() :
+	recordSize(0)
+{
+	memset(&this->header, 0, sizeof(this->header));
+
+	for(int i = 0; i < 256; i++)
+	{
+		this->magnitudes[i] = pow(2.0f, static_cast<float>(i) / 255.0f) - 1.0f;
+	}
+}
+
+uint8_t TrackAnalysis::quantizeMagnitude(float magnitude)
+{
+	// Log scale, so quiet bins keep their resolution. 1.0 and above saturate.
+	auto q = static_cast<float>(log10(1.0f + std::max(magnitude, 0.0f)) / log10(2.0f));
+	return static_cast<uint8_t>(std::min(q, 1.0f) * 255.0f + 0.5f);
+}
+
+bool TrackAnalysis::open(const std::string& fileName, uint64_t contentHash)
+{
+	if(this->file.open(fileName) == false || this->file.size() < sizeof(TrackAnalysisHeader))
+	{
+		this->file.close();
+		return false;
+	}
+
+	memcpy(&this->header, this->file.data(), sizeof(this->header));
+	this->recordSize = this->header.hop + this->header.bins * 2;
+
+	auto valid = memcmp(this->header.magic, "EPTA", 4) == 0
+		&& this->header.version == TrackAnalysis::Version
+		&& this->header.contentHash == contentHash
+		&& this->header.hop > 0
+		&& this->header.columns > 0
+		&& this->file.size() >= sizeof(TrackAnalysisHeader) + this->header.columns * this->recordSize;
+
+	if(valid == false)
+	{
+		this->file.close();
+	}
+
+	return valid;
+}
+
+const TrackAnalysisHeader& TrackAnalysis::getHeader() const
+{
+	return this->header;
+}
+
+int TrackAnalysis::getSampleRate() const
+{
+	return static_cast<int>(this->header.sampleRate);
+}
+
+void TrackAnalysis::getWave(uint64_t position, float* out, size_t count) const
+{
+	auto records = this->file.data() + sizeof(TrackAnalysisHeader);
+	auto total = this->header.columns * this->header.hop;
+
+	for(size_t i = 0; i < count; i++)
+	{
+		if(position + i < count || position + i - count >= total)
+		{
+			out[i] = 0.0f;
+		}
+		else
+		{
+			auto sample = position + i - count;
+			auto record = records + (sample / this->header.hop) * this->recordSize;
+			out[i] = static_cast<float>(static_cast<int8_t>(record[sample % this->header.hop])) / 127.0f;
+		}
+	}
+}
+
+void TrackAnalysis::getSpectrum(uint64_t position, int channel, float* out, size_t count) const
+{
+	// Column c covers the window ending at (c + 1) * hop.
+	auto column = position / this->header.hop;
+	column = (column > 0) ? column - 1 : 0;
+	column = std::min(column, this->header.columns - 1);
+
+	auto record = this->file.data() + sizeof(TrackAnalysisHeader) + column * this->recordSize;
+	auto bins = record + this->header.hop + (channel == 0 ? 0 : this->header.bins);
+
+	auto stored = std::min(count, static_cast<size_t>(this->header.bins));
+	for(size_t i = 0; i < stored; i++)
+	{
+		out[i] = this->magnitudes[bins[i]];
+	}
+
+	std::fill(out + stored, out + count, 0.0f);
+}
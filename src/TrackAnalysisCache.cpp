@@ -0,0 +1,498 @@
+#include "TrackAnalysisCache.h"
+#include "FileIdentity.h"
+#include "Fft.h"
+
+#include "cinder/Filesystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	// Number of mapped analyses kept open for quick track switches.
+	const size_t ReadyCount = 8;
+
+	// Seconds before a track that failed is looked at again, in case it was locked or replaced.
+	const double RetrySeconds = 30.0;
+}
+
+TrackAnalysisCache::TrackAnalysisCache() :
+	system(nullptr),
+	maxBytes(0),
+	cacheBytes(0),
+	windowSize(2048),
+	hop(1024),
+	running(false)
+{
+}
+
+TrackAnalysisCache::~TrackAnalysisCache()
+{
+	this->stop();
+}
+
+void TrackAnalysisCache::start(const std::string& directory, uint64_t maxBytes, size_t windowSize, size_t hop)
+{
+	this->stop();
+
+	this->directory = directory;
+	this->maxBytes = maxBytes;
+	this->windowSize = windowSize;
+	this->hop = hop;
+	this->timer.start();
+
+	try
+	{
+		ci::fs::create_directories(this->directory);
+	}
+	catch(...)
+	{
+		return;
+	}
+
+	this->running = true;
+	this->thread = std::thread(&TrackAnalysisCache::run, this);
+}
+
+void TrackAnalysisCache::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->running = false;
+	}
+
+	this->condition.notify_all();
+
+	if(this->thread.joinable() == true)
+	{
+		this->thread.join();
+	}
+}
+
+void TrackAnalysisCache::request(const std::string& fileName)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if(this->running == false || this->pending.count(fileName) > 0)
+	{
+		return;
+	}
+
+	auto failure = this->failed.find(fileName);
+
+	if(failure != std::end(this->failed) && this->timer.getSeconds() - failure->second.time < RetrySeconds)
+	{
+		return;
+	}
+
+	auto isReady = std::find_if(std::begin(this->ready), std::end(this->ready),
+		[&fileName](const ReadyEntry& entry)
+		{
+			return entry.first == fileName;
+		}) != std::end(this->ready);
+
+	if(isReady == false)
+	{
+		this->pending.insert(fileName);
+		this->queue.push_back(fileName);
+		this->condition.notify_one();
+	}
+}
+
+std::shared_ptr<const TrackAnalysis> TrackAnalysisCache::get(const std::string& fileName)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		auto entry = std::find_if(std::begin(this->ready), std::end(this->ready),
+			[&fileName](const ReadyEntry& entry)
+			{
+				return entry.first == fileName;
+			});
+
+		if(entry != std::end(this->ready))
+		{
+			// Most recently used first.
+			this->ready.splice(std::begin(this->ready), this->ready, entry);
+			return this->ready.front().second;
+		}
+	}
+
+	this->request(fileName);
+	return std::shared_ptr<const TrackAnalysis>();
+}
+
+size_t TrackAnalysisCache::getPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->pending.size();
+}
+
+uint64_t TrackAnalysisCache::getCacheBytes() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->cacheBytes;
+}
+
+void TrackAnalysisCache::run()
+{
+	// A private, silent FMOD system just for decoding.
+	FMOD::System_Create(&this->system);
+	this->system->setOutput(FMOD_OUTPUTTYPE_NOSOUND);
+	this->system->init(1, FMOD_INIT_NORMAL, nullptr);
+
+	this->evict();
+
+	while(true)
+	{
+		std::string fileName;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			while(this->running == true && this->queue.empty() == true)
+			{
+				this->condition.wait(lock);
+			}
+
+			if(this->running == false)
+			{
+				break;
+			}
+
+			fileName = this->queue.front();
+			this->queue.pop_front();
+		}
+
+		auto key = FileIdentity::getKey(fileName);
+
+		auto unchanged = false;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			auto failure = this->failed.find(fileName);
+			unchanged = (failure != std::end(this->failed) && failure->second.key != 0 && failure->second.key == key);
+		}
+
+		// Only hash the contents the first time this version of the file is seen.
+		uint64_t contentHash = 0;
+		auto known = this->contentHashes.find(key);
+
+		if(known != std::end(this->contentHashes))
+		{
+			contentHash = known->second;
+		}
+		else if(key != 0)
+		{
+			contentHash = TrackAnalysisCache::hashFile(fileName);
+
+			if(contentHash != 0)
+			{
+				this->contentHashes[key] = contentHash;
+			}
+		}
+
+		auto cacheFileName = this->getCacheFileName(contentHash);
+
+		auto analysis = std::make_shared<TrackAnalysis>();
+		auto usable = contentHash != 0 && analysis->open(cacheFileName, contentHash)
+			&& analysis->getHeader().windowSize == this->windowSize
+			&& analysis->getHeader().hop == this->hop;
+
+		if(usable == true)
+		{
+			// Mark it as recently used for eviction.
+			try
+			{
+				ci::fs::last_write_time(cacheFileName, std::time(nullptr));
+			}
+			catch(...)
+			{
+			}
+		}
+		else
+		{
+			analysis = std::make_shared<TrackAnalysis>();
+
+			// A file that failed to decode before is only tried again once it has changed.
+			if(contentHash != 0 && unchanged == false && this->analyze(fileName, cacheFileName, contentHash) == true)
+			{
+				usable = analysis->open(cacheFileName, contentHash);
+				this->evict();
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->pending.erase(fileName);
+
+		if(usable == true)
+		{
+			this->failed.erase(fileName);
+			this->ready.push_front(ReadyEntry(fileName, analysis));
+
+			while(this->ready.size() > ReadyCount)
+			{
+				this->ready.pop_back();
+			}
+		}
+		else
+		{
+			Failure failure = {contentHash != 0 ? key : 0, this->timer.getSeconds()};
+			this->failed[fileName] = failure;
+		}
+	}
+
+	this->system->release();
+	this->system = nullptr;
+}
+
+bool TrackAnalysisCache::analyze(const std::string& fileName, const std::string& cacheFileName, uint64_t contentHash)
+{
+	FMOD::Sound* sound = nullptr;
+
+	if(this->system->createSound(fileName.c_str(), FMOD_SOFTWARE | FMOD_CREATESTREAM | FMOD_OPENONLY, nullptr, &sound) != FMOD_OK)
+	{
+		return false;
+	}
+
+	FMOD_SOUND_FORMAT format = FMOD_SOUND_FORMAT_NONE;
+	int channels = 0;
+	int bits = 0;
+	float frequency = 0;
+	sound->getFormat(nullptr, &format, &channels, &bits);
+	sound->getDefaults(&frequency, nullptr, nullptr, nullptr);
+
+	if(channels < 1 || (format != FMOD_SOUND_FORMAT_PCM8 && format != FMOD_SOUND_FORMAT_PCM16 && format != FMOD_SOUND_FORMAT_PCMFLOAT))
+	{
+		sound->release();
+		return false;
+	}
+
+	// Only the bins the mirrored dB view reads are kept.
+	TrackAnalysisHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "EPTA", 4);
+	header.version = TrackAnalysis::Version;
+	header.contentHash = contentHash;
+	header.sampleRate = static_cast<uint32_t>(frequency);
+	header.hop = static_cast<uint32_t>(this->hop);
+	header.windowSize = static_cast<uint32_t>(this->windowSize);
+	header.bins = static_cast<uint32_t>(this->windowSize / 4 + 1);
+
+	auto temporaryFileName = cacheFileName + ".tmp";
+	std::ofstream os;
+	os.open(temporaryFileName.c_str(), std::ios_base::binary | std::ios_base::trunc);
+
+	if(os.is_open() == false)
+	{
+		sound->release();
+		return false;
+	}
+
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	Fft fft(this->windowSize);
+	std::vector<float> windowLeft(this->windowSize, 0.0f);
+	std::vector<float> windowRight(this->windowSize, 0.0f);
+	std::vector<float> spectrum(this->windowSize / 2);
+	std::vector<uint8_t> record(header.hop + header.bins * 2);
+
+	auto bytesPerSample = bits / 8;
+	auto frameBytes = static_cast<unsigned int>(bytesPerSample * channels);
+	std::vector<uint8_t> buffer(frameBytes * 4096);
+
+	auto sampleAt = [&](const uint8_t* frame, int channel)->float
+	{
+		auto p = frame + channel * bytesPerSample;
+
+		if(format == FMOD_SOUND_FORMAT_PCM8)
+		{
+			return static_cast<float>(*reinterpret_cast<const int8_t*>(p)) / 128.0f;
+		}
+		else if(format == FMOD_SOUND_FORMAT_PCM16)
+		{
+			int16_t value;
+			memcpy(&value, p, sizeof(value));
+			return static_cast<float>(value) / 32768.0f;
+		}
+
+		float value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	};
+
+	size_t hopFill = 0;
+	auto offset = this->windowSize - this->hop;
+
+	auto writeRecord = [&]()
+	{
+		fft.magnitudes(windowLeft.data(), spectrum.data());
+		std::transform(std::begin(spectrum), std::begin(spectrum) + header.bins, std::begin(record) + header.hop, &TrackAnalysis::quantizeMagnitude);
+
+		fft.magnitudes(windowRight.data(), spectrum.data());
+		std::transform(std::begin(spectrum), std::begin(spectrum) + header.bins, std::begin(record) + header.hop + header.bins, &TrackAnalysis::quantizeMagnitude);
+
+		os.write(reinterpret_cast<const char*>(record.data()), record.size());
+		header.columns++;
+
+		// Slide both windows along by one hop.
+		std::copy(std::begin(windowLeft) + this->hop, std::end(windowLeft), std::begin(windowLeft));
+		std::copy(std::begin(windowRight) + this->hop, std::end(windowRight), std::begin(windowRight));
+		hopFill = 0;
+	};
+
+	auto aborted = false;
+
+	while(true)
+	{
+		if(this->running == false)
+		{
+			aborted = true;
+			break;
+		}
+
+		unsigned int read = 0;
+		auto result = sound->readData(buffer.data(), static_cast<unsigned int>(buffer.size()), &read);
+
+		for(unsigned int f = 0; f + frameBytes <= read; f += frameBytes)
+		{
+			auto left = sampleAt(buffer.data() + f, 0);
+			auto right = channels > 1 ? sampleAt(buffer.data() + f, 1) : left;
+
+			auto clamped = std::min(std::max(left, -1.0f), 1.0f);
+			record[hopFill] = static_cast<uint8_t>(static_cast<int8_t>(floor(clamped * 127.0f + 0.5f)));
+			windowLeft[offset + hopFill] = left;
+			windowRight[offset + hopFill] = right;
+
+			if(++hopFill == this->hop)
+			{
+				writeRecord();
+			}
+		}
+
+		if(result != FMOD_OK || read == 0)
+		{
+			break;
+		}
+	}
+
+	// Pad out the last partial hop with silence.
+	if(aborted == false && hopFill > 0)
+	{
+		for(; hopFill < this->hop; hopFill++)
+		{
+			record[hopFill] = 0;
+			windowLeft[offset + hopFill] = 0.0f;
+			windowRight[offset + hopFill] = 0.0f;
+		}
+
+		writeRecord();
+	}
+
+	sound->release();
+
+	os.seekp(0);
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	os.close();
+
+	if(aborted == true || header.columns == 0 || os.fail() == true)
+	{
+		std::remove(temporaryFileName.c_str());
+		return false;
+	}
+
+	std::remove(cacheFileName.c_str());
+	return std::rename(temporaryFileName.c_str(), cacheFileName.c_str()) == 0;
+}
+
+void TrackAnalysisCache::evict()
+{
+	struct Entry
+	{
+		std::string fileName;
+		uint64_t size;
+		std::time_t lastUsed;
+	};
+
+	std::vector<Entry> entries;
+	uint64_t total = 0;
+
+	try
+	{
+		for(ci::fs::directory_iterator i(this->directory), end; i != end; ++i)
+		{
+			if(i->path().extension().string() == ".epa")
+			{
+				Entry entry;
+				entry.fileName = i->path().string();
+				entry.size = static_cast<uint64_t>(ci::fs::file_size(i->path()));
+				entry.lastUsed = ci::fs::last_write_time(i->path());
+				entries.push_back(entry);
+				total += entry.size;
+			}
+		}
+	}
+	catch(...)
+	{
+	}
+
+	std::sort(std::begin(entries), std::end(entries),
+		[](const Entry& a, const Entry& b)
+		{
+			return a.lastUsed < b.lastUsed;
+		});
+
+	// Oldest first. Files still mapped for playback can't be removed and are skipped.
+	for(size_t i = 0; i < entries.size() && total > this->maxBytes; i++)
+	{
+		if(std::remove(entries[i].fileName.c_str()) == 0)
+		{
+			total -= entries[i].size;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->cacheBytes = total;
+}
+
+uint64_t TrackAnalysisCache::hashFile(const std::string& fileName)
+{
+	MappedFile file;
+
+	if(file.open(fileName, MappedFile::StreamWindow) == false)
+	{
+		return 0;
+	}
+
+	// FNV-1a over the whole file, so renamed or moved tracks still hit.
+	uint64_t hash = 14695981039346656037ULL;
+
+	for(uint64_t offset = 0; offset < file.size(); offset += MappedFile::StreamWindow)
+	{
+		auto count = std::min(MappedFile::StreamWindow, file.size() - offset);
+		auto data = file.view(offset, count);
+
+		if(data == nullptr)
+		{
+			return 0;
+		}
+
+		for(uint64_t i = 0; i < count; i++)
+		{
+			hash ^= data[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	return hash;
+}
+
+std::string TrackAnalysisCache::getCacheFileName(uint64_t contentHash) const
+{
+	char name[32];
+	sprintf(name, "%016llx.epa", static_cast<unsigned long long>(contentHash));
+	return (ci::fs::path(this->directory) / name).string();
+}
@@ -0,0 +1,202 @@
+#include "TrackMetadataLoader.h"
+
+#include "cinder/Buffer.h"
+#include "cinder/DataSource.h"
+#include "cinder/ImageIo.h"
+#include "cinder/ip/Resize.h"
+
+#define TAGLIB_STATIC 
+
+#include "tag.h"
+#include <id3v2tag.h>
+#include <mpegfile.h>
+#include <attachedpictureframe.h>
+
+#include <algorithm>
+
+TrackMetadata::TrackMetadata() :
+	year(0),
+	duration(0),
+	hasAlbumArt(false)
+{
+}
+
+TrackMetadataLoader::TrackMetadataLoader() :
+	requestArtSize(0),
+	hasRequest(false),
+	hasResult(false),
+	running(false)
+{
+}
+
+TrackMetadataLoader::~TrackMetadataLoader()
+{
+	this->stop();
+}
+
+void TrackMetadataLoader::start()
+{
+	this->stop();
+
+	this->running = true;
+	this->thread = std::thread(&TrackMetadataLoader::run, this);
+}
+
+void TrackMetadataLoader::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->running = false;
+	}
+
+	this->condition.notify_all();
+
+	if(this->thread.joinable() == true)
+	{
+		this->thread.join();
+	}
+}
+
+void TrackMetadataLoader::request(const std::string& fileName, int artSize)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->requestFileName = fileName;
+		this->requestArtSize = std::max(artSize, 1);
+		this->hasRequest = true;
+		this->hasResult = false;
+	}
+
+	this->condition.notify_one();
+}
+
+bool TrackMetadataLoader::poll(TrackMetadata& metadata)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if(this->hasResult == false)
+	{
+		return false;
+	}
+
+	metadata = this->result;
+	this->result = TrackMetadata();
+	this->hasResult = false;
+	return true;
+}
+
+void TrackMetadataLoader::run()
+{
+	while(true)
+	{
+		std::string fileName;
+		int artSize = 0;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			while(this->running == true && this->hasRequest == false)
+			{
+				this->condition.wait(lock);
+			}
+
+			if(this->running == false)
+			{
+				break;
+			}
+
+			fileName = this->requestFileName;
+			artSize = this->requestArtSize;
+			this->hasRequest = false;
+		}
+
+		TrackMetadata metadata;
+		TrackMetadataLoader::load(fileName, artSize, metadata);
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			// A newer request supersedes this one.
+			if(this->hasRequest == false && this->requestFileName == fileName)
+			{
+				this->result = metadata;
+				this->hasResult = true;
+			}
+		}
+	}
+}
+
+void TrackMetadataLoader::load(const std::string& fileName, int artSize, TrackMetadata& metadata)
+{
+	metadata.fileName = fileName;
+
+	TagLib::MPEG::File f(fileName.c_str());
+
+	if(f.isValid() == false)
+	{
+		return;
+	}
+
+	if(f.audioProperties() != nullptr)
+	{
+		metadata.duration = f.audioProperties()->length();
+	}
+
+	auto tag = f.ID3v2Tag();
+
+	if(tag == nullptr)
+	{
+		return;
+	}
+
+	metadata.artist = std::string(tag->artist().toCString());
+	metadata.album = std::string(tag->album().toCString());
+	metadata.year = tag->year();
+	metadata.title = std::string(tag->title().toCString());
+
+	TagLib::ID3v2::FrameList l = tag->frameList("APIC");
+
+	if(l.isEmpty() == true)
+	{
+		return;
+	}
+
+	auto apf = static_cast<TagLib::ID3v2::AttachedPictureFrame*>(l.front());
+
+	if(apf == nullptr)
+	{
+		return;
+	}
+
+	TagLib::ByteVector picture = apf->picture();
+
+	if(picture.data() == nullptr || picture.size() == 0)
+	{
+		return;
+	}
+
+	std::string extension = std::string(apf->mimeType().toCString());
+
+	if(extension.find('/') != std::string::npos)
+	{
+		extension = extension.substr(extension.find_last_of("/") + 1);
+	}
+
+	try
+	{
+		// Decode straight from the tag's bytes; 'picture' outlives the buffer.
+		ci::Buffer buffer(picture.data(), picture.size());
+		ci::Surface8u image(ci::loadImage(ci::DataSourceBuffer::create(buffer), ci::ImageSource::Options(), extension));
+
+		if(image.getWidth() > artSize || image.getHeight() > artSize)
+		{
+			image = ci::ip::resize(image, image.getBounds(), ci::Vec2i(artSize, artSize));
+		}
+
+		metadata.albumArt = image;
+		metadata.hasAlbumArt = true;
+	}
+	catch(...)
+	{
+		metadata.hasAlbumArt = false;
+	}
+}